@@ -0,0 +1,197 @@
+#include "datagen.h"
+
+#include <QFile>
+#include <QByteArray>
+
+namespace {
+
+struct Rng {
+    quint64 state;
+    // splitmix64
+    quint64 next()
+    {
+        quint64 z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    quint64 below(quint64 n) { return next() % n; }
+    double uniform() { return double(next() >> 11) * (1.0 / 9007199254740992.0); }
+    bool chance(double p) { return uniform() < p; }
+    template <typename T, size_t N>
+    const T &pick(const T (&items)[N]) { return items[below(N)]; }
+};
+
+// Buffered writer, one write() per MiB
+class Output
+{
+public:
+    explicit Output(const QString &path) : file(path) {}
+    bool open() { return file.open(QIODevice::WriteOnly); }
+    QByteArray &line() { return buffer; }
+    bool endLine()
+    {
+        buffer.append('\n');
+        if (buffer.size() >= (1 << 20))
+            return flush();
+        return true;
+    }
+    bool flush()
+    {
+        bool ok = file.write(buffer) == buffer.size();
+        buffer.clear();
+        return ok;
+    }
+    bool close()
+    {
+        bool ok = flush();
+        file.close();
+        return ok;
+    }
+private:
+    QFile file;
+    QByteArray buffer;
+};
+
+bool writeFile(const QString &path, const QByteArray &content)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    bool ok = file.write(content) == content.size();
+    file.close();
+    return ok;
+}
+
+// "7.2500" -> "7.25", "8.0000" -> "8"
+QByteArray decimal(double v, int precision)
+{
+    QByteArray s = QByteArray::number(v, 'f', precision);
+    while (s.endsWith('0')) s.chop(1);
+    if (s.endsWith('.')) s.chop(1);
+    return s;
+}
+
+const char *const lastNames[] = {
+    "Braund", "Cumings", "Heikkinen", "Futrelle", "Allen", "Moran", "McCarthy",
+    "Palsson", "Johnson", "Nasser", "Sandstrom", "Bonnell", "Saundercock",
+    "Andersson", "Vestrom", "Hewlett", "Rice", "Williams", "Vander Planke",
+    "Masselmani", "Fynney", "Beesley", "McGowan", "Sloper", "Asplund", "Emir",
+    "Fortune", "O'Dwyer", "Todoroff", "Uruchurtu", "Spencer", "Glynn", "Wheadon",
+    "Meyer", "Holverson", "Mamee", "Cann", "Nicola-Yarred", "Ahlin", "Turpin"
+};
+const char *const maleNames[] = {
+    "Owen Harris", "William Henry", "James", "Timothy J", "Gosta Leonard",
+    "Charles Alexander", "Lawrence", "Joseph J", "Harry", "Thomas", "John",
+    "George", "Frederick", "Edward", "Arthur", "Albert", "Walter", "Ernest"
+};
+const char *const femaleNames[] = {
+    "John Bradley (Florence Briggs Thayer)", "Laina", "Jacques Heath (Lily May Peel)",
+    "Oscar W (Elisabeth Vilhelmina Berg)", "Nicholas (Adele Achem)", "Marguerite Rut",
+    "Elizabeth", "Anna", "Mary", "Margaret", "Helen", "Alice", "Emily", "Ellen"
+};
+const char *const ticketPrefixes[] = {
+    "A/5", "PC", "STON/O2.", "C.A.", "SOTON/OQ", "W./C.", "SC/PARIS", "CA"
+};
+
+} // namespace
+
+bool DataGen::titanic(const QString &csvPath, const QString &schemaPath, qint64 rows, quint64 seed)
+{
+    if (!writeFile(schemaPath, "int,boolean,char(1),varchar(100),char(6),float,tinyint,"
+                               "tinyint,varchar(25),float,varchar(25),char(1)"))
+        return false;
+    Output out(csvPath);
+    if (!out.open())
+        return false;
+    out.line() = "PassengerId,Survived,Pclass,Name,Sex,Age,SibSp,Parch,Ticket,Fare,Cabin,Embarked";
+    out.endLine();
+
+    Rng rng{seed};
+    for (qint64 i = 0; i < rows; ++i) {
+        QByteArray &l = out.line();
+        int pclass = rng.chance(0.24) ? 1 : (rng.chance(0.28) ? 2 : 3);
+        bool male = rng.chance(0.65);
+        // PassengerId, Survived, Pclass
+        l.append(QByteArray::number(i + 1)).append(',');
+        l.append(rng.chance(male ? 0.19 : 0.74) ? "1," : "0,");
+        l.append(QByteArray::number(pclass)).append(',');
+        // Name: "Last, Title. First"
+        const char *title = male ? (rng.chance(0.9) ? "Mr." : "Master.")
+                                 : (rng.chance(0.5) ? "Miss." : "Mrs.");
+        l.append('"').append(rng.pick(lastNames)).append(", ").append(title).append(' ')
+         .append(male ? rng.pick(maleNames) : rng.pick(femaleNames)).append("\",");
+        l.append(male ? "male," : "female,");
+        // Age, ~20% unknown
+        if (!rng.chance(0.2)) {
+            double age = (rng.uniform() + rng.uniform()) * 30.0;
+            l.append(age < 1 ? decimal(age, 2) : QByteArray::number(int(age)));
+        }
+        l.append(',');
+        // SibSp, Parch
+        l.append(QByteArray::number(rng.chance(0.68) ? 0 : (rng.chance(0.7) ? 1 : 2 + int(rng.below(7))))).append(',');
+        l.append(QByteArray::number(rng.chance(0.76) ? 0 : (rng.chance(0.55) ? 1 : 2 + int(rng.below(5))))).append(',');
+        // Ticket
+        if (rng.chance(0.25))
+            l.append(rng.pick(ticketPrefixes)).append(' ');
+        l.append(QByteArray::number(1000 + rng.below(3000000))).append(',');
+        // Fare by class
+        double fare = pclass == 1 ? 26 + rng.uniform() * 486
+                    : pclass == 2 ? 10 + rng.uniform() * 63
+                                  : 4 + rng.uniform() * 66;
+        l.append(decimal(fare, 4)).append(',');
+        // Cabin, mostly known for 1st class only
+        if (rng.chance(pclass == 1 ? 0.8 : 0.05))
+            l.append(char('A' + rng.below(7))).append(QByteArray::number(1 + rng.below(148)));
+        l.append(',');
+        // Embarked
+        double e = rng.uniform();
+        l.append(e < 0.72 ? "S" : e < 0.91 ? "C" : e < 0.998 ? "Q" : "");
+        if (!out.endLine())
+            return false;
+    }
+    return out.close();
+}
+
+bool DataGen::movieRatings(const QString &csvPath, const QString &schemaPath, qint64 rows, quint64 seed)
+{
+    static const char *const users[] = {
+        "Patrick C", "Heather", "Bryan", "Patrick T", "Thomas", "aaron", "vanessa",
+        "greg", "brian", "ben", "Katherine", "Jonathan", "Zwe", "Erin", "Chris", "Zak",
+        "Matt", "Chris", "Josh", "Amy", "Valerie", "Gary", "Stephen", "Jessica", "Jeff"
+    };
+    static const char *const words[] = {
+        "Alien", "Avatar", "Blade", "Runner", "Braveheart", "Dodgeball", "Forrest",
+        "Gump", "Gravity", "Inception", "Jaws", "Matrix", "Memento", "Return", "Star",
+        "Wars", "Titanic", "Up", "Wall-E", "Zoolander"
+    };
+    QByteArray schema = "char(100)";
+    QByteArray header;
+    for (const char *u : users) {
+        schema.append(",int");
+        header.append(",\"").append(u).append('"');
+    }
+    if (!writeFile(schemaPath, schema))
+        return false;
+    Output out(csvPath);
+    if (!out.open())
+        return false;
+    out.line() = header;
+    out.endLine();
+
+    Rng rng{seed};
+    for (qint64 i = 0; i < rows; ++i) {
+        QByteArray &l = out.line();
+        l.append('"').append(rng.pick(words)).append(' ').append(rng.pick(words))
+         .append(' ').append(QByteArray::number(i + 1)).append('"');
+        // ~40% of users didn't rate a given movie
+        for (size_t u = 0; u < sizeof(users) / sizeof(users[0]); ++u) {
+            l.append(',');
+            if (!rng.chance(0.4))
+                l.append(char('1' + rng.below(5)));
+        }
+        if (!out.endLine())
+            return false;
+    }
+    return out.close();
+}
@@ -0,0 +1,19 @@
+#ifndef DATAGEN_H
+#define DATAGEN_H
+
+#include <QString>
+
+// Synthetic datasets with the header and schema of resources/tests, scaled
+// to any number of rows. Output only depends on (rows, seed): values come
+// from a self-contained splitmix64 generator, not from <random>, whose
+// distributions differ between standard libraries.
+
+namespace DataGen
+{
+    // titanic.csv + titanic-schema.csv
+    bool titanic(const QString &csvPath, const QString &schemaPath, qint64 rows, quint64 seed);
+    // Movie_Ratings.csv + movie-ratings.schema.csv
+    bool movieRatings(const QString &csvPath, const QString &schemaPath, qint64 rows, quint64 seed);
+}
+
+#endif // DATAGEN_H
@@ -0,0 +1,761 @@
+// megatron_bench: engine benchmarks on synthetic data, results as JSON
+//
+//   megatron_bench --rows 1000000 --iterations 5 --out results.json
+//   megatron_bench --rows 100000000 --filter '^(load|scan)/' --dir /mnt/scratch
+//
+// Every benchmark runs --warmup untimed then --iterations timed repetitions
+// and reports items/s, MB/s and latency percentiles over the repetitions.
+// Same --rows and --seed always generate the same data.
+
+#include "datagen.h"
+#include "systemcatalog.h"
+#include "queryplan.h"
+#include "executor.h"
+#include "loader.h"
+#include "tablefile.h"
+#include "exportsink.h"
+#include "materializedview.h"
+#include "partitioning.h"
+#include "coveringindex.h"
+#include "resultset.h"
+#include "memorygovernor.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+// Counts what an Executor produces, touching every projected field
+class CountingSink : public RowSink
+{
+public:
+    qint64 rows = 0;
+    qint64 bytes = 0;
+    void begin(const QStringList &headers) override { Q_UNUSED(headers) rows = bytes = 0; }
+    void row(const Row &fields) override
+    {
+        rows++;
+        for (const auto& f : fields) bytes += f.size();
+    }
+};
+
+// Keeps the rows, as the results table does
+class BufferingSink : public RowSink
+{
+public:
+    explicit BufferingSink(ResultSet &results) : results(results) {}
+    void begin(const QStringList &headers) override { results.reset(headers); }
+    void row(const Row &fields) override { results.append(fields); }
+private:
+    ResultSet &results;
+};
+
+struct Measure {
+    qint64 items = 0;                   // rows, lines, plans... handled per iteration
+    qint64 bytes = 0;                   // input bytes per iteration, 0 if meaningless
+};
+
+class Bench
+{
+public:
+    QRegularExpression filter;
+    int iterations = 5;
+    int warmup = 1;
+    QJsonArray results;
+    bool failed = false;
+
+    bool selected(const QString &name) const { return filter.match(name).hasMatch(); }
+
+    // fn returns false on error, filling 'error'
+    void run(const QString &name, const std::function<bool(int, Measure &, QString &)> &fn)
+    {
+        if (!selected(name))
+            return;
+        QTextStream err(stderr);
+        err << name << " ... " << Qt::flush;
+        Measure m;
+        QString error;
+        QList<double> ms;
+        int n = 0;
+        for (int i = 0; i < warmup + iterations; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            bool ok = fn(n++, m, error);
+            qint64 ns = timer.nsecsElapsed();
+            if (!ok) {
+                err << "FAILED: " << error << Qt::endl;
+                failed = true;
+                return;
+            }
+            if (i >= warmup)
+                ms.append(ns / 1e6);
+        }
+        std::sort(ms.begin(), ms.end());
+        auto percentile = [&ms](double p) {
+            // nearest rank
+            qsizetype rank = qsizetype(p / 100.0 * ms.size() + 0.999999);
+            return ms.at(qBound<qsizetype>(0, rank - 1, ms.size() - 1));
+        };
+        double total = 0;
+        for (double v : ms) total += v;
+        double mean = total / ms.size();
+        double seconds = mean / 1e3;
+
+        QJsonObject latency;
+        latency["min"] = ms.first();
+        latency["p50"] = percentile(50);
+        latency["p90"] = percentile(90);
+        latency["p99"] = percentile(99);
+        latency["max"] = ms.last();
+        latency["mean"] = mean;
+        QJsonObject r;
+        r["name"] = name;
+        r["iterations"] = iterations;
+        r["items"] = m.items;
+        r["bytes"] = m.bytes;
+        r["items_per_s"] = seconds > 0 ? m.items / seconds : 0.0;
+        r["mb_per_s"] = seconds > 0 ? m.bytes / seconds / (1024.0 * 1024.0) : 0.0;
+        r["latency_ms"] = latency;
+        results.append(r);
+        err << QString::number(mean, 'f', 3) << " ms" << Qt::endl;
+    }
+};
+
+// Same steps as Megatron::createRelation, minus the UI
+bool createRelation(const QString &relName, const QString &csvPath, const QString &schemaPath,
+                    QString &error)
+{
+    SystemCatalog &sysCat = SystemCatalog::getInstance();
+    QFile data(csvPath);
+    if (!data.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = QStringLiteral("can't open %1").arg(csvPath);
+        return false;
+    }
+    QTextStream in(&data);
+    QString header = in.readLine();
+    if (sysCat.parseSchemaPath(relName, header, schemaPath) != Types::Success) {
+        error = QStringLiteral("can't parse %1").arg(schemaPath);
+        return false;
+    }
+    sysCat.writeToSchema(relName);
+    Loader loader(relName);
+    bool ok = loader.load(in);
+    data.close();
+    if (!ok)
+        error = loader.errorString();
+    return ok;
+}
+
+// Same steps as Megatron::appendRelation
+bool appendRelation(const QString &relName, const QString &csvPath, QString &error)
+{
+    QFile data(csvPath);
+    if (!data.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = QStringLiteral("can't open %1").arg(csvPath);
+        return false;
+    }
+    QTextStream in(&data);
+    QString header = in.readLine();
+    Loader loader(relName);
+    bool ok = loader.append(header, in);
+    data.close();
+    if (!ok)
+        error = loader.errorString();
+    return ok;
+}
+
+// Data files of a benchmark-made table, its catalog entry stays
+void dropTableFiles(const QString &relName)
+{
+    QDir db(SystemCatalog::getInstance().getDbDirPath());
+    for (const char *ext : {".txt", ".codec", ".zmp", ".tri", ".inv", ".bmx", ".view", ".part", ".clu", ".cov"})
+        QFile::remove(db.filePath(relName + ext));
+}
+
+qint64 tableSize(const QString &relName)
+{
+    SystemCatalog &sysCat = SystemCatalog::getInstance();
+    QDir db(sysCat.getDbDirPath());
+    qint64 size = QFileInfo(db.filePath(relName + ".txt")).size();
+    for (int id : sysCat.getPartitioning(relName).getPartitions())
+        size += QFileInfo(db.filePath(Partitioning::partitionName(relName, id) + ".txt")).size();
+    return size;
+}
+
+struct Query {
+    QString name;
+    QuerySpec spec;
+    QueryParams params;
+};
+
+// intoOutput: SELECT INTO rows also go to the sink, else the fast paths run
+bool runQuery(const Query &q, const QueryParams &params, Measure &m, QString &error,
+              bool intoOutput = true)
+{
+    QueryPlan plan = QueryPlan::prepare(q.spec, &error);
+    if (!plan.isValid())
+        return false;
+    CountingSink sink;
+    Executor executor(plan, params);
+    executor.setIntoOutput(intoOutput);
+    if (!executor.run(sink)) {
+        error = executor.errorString();
+        return false;
+    }
+    m.items = intoOutput ? sink.rows : executor.getIntoRows();
+    m.bytes = tableSize(q.spec.tableName);
+    return true;
+}
+
+Query where(const QString &name, const QString &table, const QString &field, int optor,
+            const QString &c1 = QString(), const QString &c2 = QString())
+{
+    Query q;
+    q.name = name;
+    q.spec.attributes = QStringList{"*"};
+    q.spec.tableName = table;
+    q.spec.where = true;
+    q.spec.conditions.append({field, optor, false});
+    q.params.conditions.append({c1, c2});
+    return q;
+}
+
+// q with one more WHERE condition, AND or OR
+Query also(Query q, bool orPrevious, const QString &field, int optor,
+           const QString &c1 = QString(), const QString &c2 = QString())
+{
+    q.spec.conditions.append({field, optor, orPrevious});
+    q.params.conditions.append({c1, c2});
+    return q;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("megatron_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("MegatronDBMS engine benchmarks on synthetic data");
+    parser.addHelpOption();
+    QCommandLineOption rowsOption("rows", "Rows per generated table.", "n", "1000000");
+    QCommandLineOption iterationsOption("iterations", "Timed repetitions per benchmark.", "n", "5");
+    QCommandLineOption warmupOption("warmup", "Untimed repetitions per benchmark.", "n", "1");
+    QCommandLineOption dirOption("dir", "Working directory (default: a temporary one).", "path");
+    QCommandLineOption outOption("out", "JSON output file (default: stdout).", "file");
+    QCommandLineOption filterOption("filter", "Only run benchmarks matching this regex.", "regex", ".");
+    QCommandLineOption datasetOption("dataset", "titanic, movies or all.", "name", "all");
+    QCommandLineOption seedOption("seed", "Data generator seed.", "n", "42");
+    QCommandLineOption labelOption("label", "Free text stored with the results.", "text");
+    QCommandLineOption keepOption("keep", "Keep the working directory.");
+    parser.addOptions({rowsOption, iterationsOption, warmupOption, dirOption, outOption,
+                       filterOption, datasetOption, seedOption, labelOption, keepOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    qint64 rows = parser.value(rowsOption).toLongLong();
+    quint64 seed = parser.value(seedOption).toULongLong();
+    QString dataset = parser.value(datasetOption);
+    if (rows <= 0 || !QStringList{"titanic", "movies", "all"}.contains(dataset)) {
+        err << "invalid --rows or --dataset" << Qt::endl;
+        return 2;
+    }
+    Bench bench;
+    bench.iterations = qMax(1, parser.value(iterationsOption).toInt());
+    bench.warmup = qMax(0, parser.value(warmupOption).toInt());
+    bench.filter.setPattern(parser.value(filterOption));
+    if (!bench.filter.isValid()) {
+        err << "invalid --filter: " << bench.filter.errorString() << Qt::endl;
+        return 2;
+    }
+
+    QTemporaryDir tempDir;
+    QString workDir = parser.isSet(dirOption) ? parser.value(dirOption) : tempDir.path();
+    tempDir.setAutoRemove(!parser.isSet(keepOption));
+    QDir work(workDir);
+    if (!work.mkpath("db")) {
+        err << "can't create " << work.filePath("db") << Qt::endl;
+        return 2;
+    }
+    // First call decides the database directory
+    SystemCatalog &sysCat = SystemCatalog::getInstance(work.filePath("db"));
+    sysCat.initSchema();
+
+    // Datasets, generated and loaded once for the query benchmarks
+    struct Dataset {
+        QString name;
+        QString csv;
+        QString schema;
+    };
+    QList<Dataset> datasets;
+    if (dataset != "movies")
+        datasets.append({"titanic", work.filePath("titanic.csv"), work.filePath("titanic-schema.csv")});
+    if (dataset != "titanic")
+        datasets.append({"movies", work.filePath("movies.csv"), work.filePath("movies-schema.csv")});
+    for (const auto& d : datasets) {
+        err << "generating " << d.name << " (" << rows << " rows) ... " << Qt::flush;
+        bool ok = d.name == "titanic" ? DataGen::titanic(d.csv, d.schema, rows, seed)
+                                      : DataGen::movieRatings(d.csv, d.schema, rows, seed);
+        QString error;
+        if (ok && !sysCat.getTableNames().contains(d.name))
+            ok = createRelation(d.name, d.csv, d.schema, error);
+        if (!ok) {
+            err << "FAILED " << error << Qt::endl;
+            return 1;
+        }
+        err << "done" << Qt::endl;
+    }
+
+    // CSV load (createRelation), a new relation per repetition
+    for (const auto& d : datasets) {
+        qint64 csvBytes = QFileInfo(d.csv).size();
+        bench.run("load/" + d.name, [&](int n, Measure &m, QString &error) {
+            QString relName = QStringLiteral("%1_load_%2").arg(d.name).arg(n);
+            if (sysCat.getTableNames().contains(relName))
+                relName += "_" + QString::number(QDateTime::currentMSecsSinceEpoch());
+            bool ok = createRelation(relName, d.csv, d.schema, error);
+            dropTableFiles(relName);
+            m.items = rows;
+            m.bytes = csvBytes;
+            return ok;
+        });
+    }
+
+    // CSV append to one relation, growing by the same file each repetition:
+    // should cost the same every time
+    for (const auto& d : datasets) {
+        QString relName = d.name + "_append";
+        if (!bench.selected("append/" + d.name))
+            continue;
+        QString setupError;
+        if (!sysCat.getTableNames().contains(relName) &&
+            !createRelation(relName, d.csv, d.schema, setupError)) {
+            err << "FAILED " << setupError << Qt::endl;
+            return 1;
+        }
+        qint64 csvBytes = QFileInfo(d.csv).size();
+        bench.run("append/" + d.name, [&](int, Measure &m, QString &error) {
+            m.items = rows;
+            m.bytes = csvBytes;
+            return appendRelation(relName, d.csv, error);
+        });
+        dropTableFiles(relName);
+    }
+
+    // Same, with a materialized view over the relation: maintaining it
+    // costs the appended rows, not the view's
+    for (const auto& d : datasets) {
+        QString relName = d.name + "_append_view";
+        if (!bench.selected("append_view/" + d.name))
+            continue;
+        QString setupError;
+        if (!sysCat.getTableNames().contains(relName) &&
+            !createRelation(relName, d.csv, d.schema, setupError)) {
+            err << "FAILED " << setupError << Qt::endl;
+            return 1;
+        }
+        QuerySpec spec;
+        spec.attributes = QStringList{"*"};
+        spec.tableName = relName;
+        spec.into = true;
+        QueryParams params;
+        params.newTableName = relName + "_mv";
+        if (sysCat.getTableNames().contains(params.newTableName))
+            params.newTableName += "_" + QString::number(QDateTime::currentMSecsSinceEpoch());
+        if (!MaterializedView::create(spec, params, &setupError)) {
+            err << "FAILED " << setupError << Qt::endl;
+            return 1;
+        }
+        qint64 csvBytes = QFileInfo(d.csv).size();
+        bench.run("append_view/" + d.name, [&](int, Measure &m, QString &error) {
+            m.items = rows;
+            m.bytes = csvBytes;
+            return appendRelation(relName, d.csv, error);
+        });
+        dropTableFiles(params.newTableName);
+        dropTableFiles(relName);
+    }
+
+    bench.run("catalog/startup", [&](int, Measure &m, QString &error) {
+        if (!sysCat.initSchema()) {
+            error = "can't read " + sysCat.getSchemaPath();
+            return false;
+        }
+        m.items = sysCat.getTableNames().size();
+        m.bytes = QFileInfo(sysCat.getSchemaPath()).size();
+        return true;
+    });
+
+    QList<Query> queries;
+    if (dataset != "movies") {
+        Query full;
+        full.name = "scan/full";
+        full.spec.attributes = QStringList{"*"};
+        full.spec.tableName = "titanic";
+        queries.append(full);
+        Query project = full;
+        project.name = "scan/project";
+        project.spec.attributes = QStringList{"Name", "Age", "Fare"};
+        queries.append(project);
+        // One WHERE per operator family
+        queries.append(where("where/numeric_lt", "titanic", "Age", 0, "10"));
+        queries.append(where("where/numeric_between", "titanic", "Fare", 16, "50", "100"));
+        queries.append(where("where/equal_encoded", "titanic", "Sex", 3, "female"));
+        queries.append(where("where/equal_plain", "titanic", "Ticket", 3, "1234567"));
+        queries.append(where("where/contains", "titanic", "Name", 6, "Mrs."));
+        queries.append(where("where/begins_with", "titanic", "Name", 7, "Allen"));
+        queries.append(where("where/ends_with", "titanic", "Name", 8, "Mary"));
+        queries.append(where("where/not_contains", "titanic", "Name", 9, "Mr."));
+        // no match: blocks skipped by the trigram index on large tables
+        queries.append(where("where/contains_absent", "titanic", "Name", 6, "Xanthippe"));
+        // a rare surname: only its rows are read, through the inverted index
+        queries.append(where("where/contains_word", "titanic", "Name", 6, "Sage,"));
+        queries.append(where("where/is_null", "titanic", "Age", 12));
+        queries.append(where("where/is_not_empty", "titanic", "Cabin", 15));
+        // Compound, the costly predicate first: the filter has to reorder them
+        queries.append(also(also(where("where/and_3", "titanic", "Name", 6, "Mrs."),
+                                 false, "Sex", 3, "female"), false, "Age", 0, "10"));
+        queries.append(also(also(where("where/or_and", "titanic", "Name", 8, "Mary"),
+                                 true, "Pclass", 3, "1"), false, "Fare", 1, "100"));
+        // Categorical columns only: row bitmaps ANDed, no other row read
+        queries.append(also(also(where("bitmap/and_categorical", "titanic", "Sex", 3, "female"),
+                                 false, "Pclass", 3, "1"), false, "Embarked", 3, "S"));
+        queries.append(also(where("bitmap/or_not", "titanic", "Survived", 2, "1"),
+                            true, "Pclass", 3, "3"));
+
+        // Copy of titanic range partitioned on Age: scanned in parallel,
+        // or only the partition a WHERE clause leaves
+        if (bench.selected("partition/scan") || bench.selected("partition/range_pruned")) {
+            QString setupError;
+            bool ok = sysCat.getTableNames().contains("titanic_parts");
+            if (!ok && createRelation("titanic_parts", work.filePath("titanic.csv"),
+                                      work.filePath("titanic-schema.csv"), setupError)) {
+                QList<SystemCatalog::attrMeta> meta = sysCat.values("titanic_parts");
+                std::reverse(meta.begin(), meta.end());
+                QStringList columns;
+                QByteArray types;
+                for (const auto& m : meta) {
+                    columns.append(m.attributeName);
+                    types.append(m.type);
+                }
+                Partitioning partitioning = Partitioning::parse(
+                    "RANGE (Age) 10, 20, 30, 40, 50, 60", columns, types, &setupError);
+                Loader loader("titanic_parts");
+                ok = partitioning.isPartitioned() && loader.partition(partitioning);
+                if (!ok && setupError.isEmpty())
+                    setupError = loader.errorString();
+            }
+            if (!ok) {
+                err << "FAILED " << setupError << Qt::endl;
+                return 1;
+            }
+            Query parts;
+            parts.name = "partition/scan";
+            parts.spec.attributes = QStringList{"*"};
+            parts.spec.tableName = "titanic_parts";
+            queries.append(parts);
+            queries.append(where("partition/range_pruned", "titanic_parts", "Age", 0, "10"));
+        }
+        // Copy of titanic clustered on Fare: the range is one run of blocks
+        if (bench.selected("clustered/range")) {
+            QString setupError;
+            bool ok = sysCat.getTableNames().contains("titanic_sorted");
+            if (!ok && createRelation("titanic_sorted", work.filePath("titanic.csv"),
+                                      work.filePath("titanic-schema.csv"), setupError)) {
+                QList<SystemCatalog::attrMeta> meta = sysCat.values("titanic_sorted");
+                std::reverse(meta.begin(), meta.end());
+                int fare = -1;
+                for (const auto& m : meta)
+                    if (m.attributeName == "Fare")
+                        fare = m.position;
+                Loader loader("titanic_sorted");
+                ok = loader.cluster(fare);
+                if (!ok)
+                    setupError = loader.errorString();
+            }
+            if (!ok) {
+                err << "FAILED " << setupError << Qt::endl;
+                return 1;
+            }
+            queries.append(where("clustered/range", "titanic_sorted", "Fare", 16, "50", "100"));
+        }
+        // Copy of titanic with an index on Fare holding Name: the narrow
+        // lookup never reads a table row, the wide one can't use it
+        if (bench.selected("index/covering") || bench.selected("index/not_covering")) {
+            QString setupError;
+            bool ok = sysCat.getTableNames().contains("titanic_indexed");
+            if (!ok && createRelation("titanic_indexed", work.filePath("titanic.csv"),
+                                      work.filePath("titanic-schema.csv"), setupError))
+                ok = CoveringIndex::create("titanic_indexed", "Fare", {"Name"}, &setupError);
+            if (!ok) {
+                err << "FAILED " << setupError << Qt::endl;
+                return 1;
+            }
+            Query covering = where("index/covering", "titanic_indexed", "Fare", 16, "50", "100");
+            covering.spec.attributes = QStringList{"Name", "Fare"};
+            queries.append(covering);
+            queries.append(where("index/not_covering", "titanic_indexed", "Fare", 16, "50", "100"));
+        }
+    }
+    if (dataset != "titanic") {
+        Query full;
+        full.name = "scan/movies_full";
+        full.spec.attributes = QStringList{"*"};
+        full.spec.tableName = "movies";
+        queries.append(full);
+        queries.append(where("where/movies_numeric_ge", "movies", "Zak", 5, "4"));
+    }
+    for (const auto& q : queries) {
+        bench.run(q.name, [&](int, Measure &m, QString &error) {
+            return runQuery(q, q.params, m, error);
+        });
+    }
+
+    // COUNT(*) from bitmap cardinalities, items are the rows counted
+    if (dataset != "movies") {
+        Query counted = also(where("bitmap/count", "titanic", "Sex", 3, "female"), false, "Pclass", 3, "1");
+        bench.run(counted.name, [&](int, Measure &m, QString &error) {
+            QueryPlan plan = QueryPlan::prepare(counted.spec, &error);
+            if (!plan.isValid())
+                return false;
+            Executor executor(plan, counted.params);
+            if (!executor.count(m.items)) {
+                error = executor.errorString();
+                return false;
+            }
+            m.bytes = tableSize("titanic");
+            return true;
+        });
+    }
+
+    // Approximate aggregates from 1% of titanic, items are the rows read
+    if (dataset != "movies") {
+        for (auto method : {TableSample::Bernoulli, TableSample::Block}) {
+            QString name = method == TableSample::Bernoulli ? "sample/bernoulli_1pct" : "sample/block_1pct";
+            Query sampled = where(name, "titanic", "Sex", 3, "female");
+            sampled.spec.attributes = QStringList{"Age", "Fare"};
+            bench.run(name, [&](int iteration, Measure &m, QString &error) {
+                QueryPlan plan = QueryPlan::prepare(sampled.spec, &error);
+                if (!plan.isValid())
+                    return false;
+                TableSample sample;
+                sample.method = method;
+                sample.percent = 1;
+                sample.seed = quint32(iteration);
+                Executor executor(plan, sampled.params);
+                executor.setSample(sample);
+                SampleEstimate estimate;
+                if (!executor.estimate(estimate)) {
+                    error = executor.errorString();
+                    return false;
+                }
+                m.items = estimate.getScannedRows();
+                m.bytes = tableSize("titanic");
+                return true;
+            });
+        }
+    }
+
+    // Whole table buffered like the results table, within the query budget
+    // or spilling past a 1 MiB one
+    if (dataset != "movies") {
+        for (qint64 limit : {MemoryGovernor::getInstance().getQueryLimit(), qint64(1024 * 1024)}) {
+            QString name = limit == MemoryGovernor::getInstance().getQueryLimit() ? "result/in_memory"
+                                                                                  : "result/spilled";
+            bench.run(name, [&](int, Measure &m, QString &error) {
+                QuerySpec spec;
+                spec.attributes = QStringList{"*"};
+                spec.tableName = "titanic";
+                QueryPlan plan = QueryPlan::prepare(spec, &error);
+                if (!plan.isValid())
+                    return false;
+                MemoryBudget budget(limit);
+                ResultSet results;
+                results.setBudget(&budget);
+                BufferingSink sink(results);
+                Executor executor(plan, QueryParams());
+                if (!executor.run(sink)) {
+                    error = executor.errorString();
+                    return false;
+                }
+                if (!results.errorString().isEmpty()) {
+                    error = results.errorString();
+                    return false;
+                }
+                // read back, the spilled rows from their file
+                qint64 bytes = 0;
+                for (qsizetype r = 0; r < results.rowCount(); ++r)
+                    bytes += results.cell(r, 0).size();
+                Q_UNUSED(bytes)
+                m.items = results.rowCount();
+                m.bytes = tableSize("titanic");
+                return true;
+            });
+        }
+    }
+
+    // Whole table streamed to a file, bytes are those written
+    if (dataset != "movies") {
+        for (auto format : {ExportSink::Csv, ExportSink::Binary}) {
+            QString name = format == ExportSink::Csv ? "export/csv" : "export/binary";
+            bench.run(name, [&](int, Measure &m, QString &error) {
+                QuerySpec spec;
+                spec.attributes = QStringList{"*"};
+                spec.tableName = "titanic";
+                QueryPlan plan = QueryPlan::prepare(spec, &error);
+                if (!plan.isValid())
+                    return false;
+                QByteArray types;
+                for (int p : plan.projection) types.append(plan.meta.at(p).type);
+                QString path = work.filePath(name.section('/', 1) + ".export");
+                ExportSink sink(path, format, types);
+                Executor executor(plan, QueryParams());
+                bool ok = sink.open() && executor.run(sink) && sink.errorString().isEmpty();
+                if (!ok)
+                    error = sink.errorString().isEmpty() ? executor.errorString() : sink.errorString();
+                m.items = sink.getRowCount();
+                m.bytes = QFileInfo(path).size();
+                QFile::remove(path);
+                return ok;
+            });
+        }
+    }
+
+    // SELECT INTO, a new table per repetition
+    if (dataset != "movies") {
+        Query all;
+        all.name = "select_into/all";
+        all.spec.attributes = QStringList{"*"};
+        all.spec.tableName = "titanic";
+        all.spec.into = true;
+        Query filtered = where("select_into/filtered", "titanic", "Age", 0, "10");
+        filtered.spec.attributes = QStringList{"PassengerId", "Name", "Age"};
+        filtered.spec.into = true;
+        // through the pipeline with the rows shown, then file copy / parallel writers
+        for (bool rows : {true, false}) {
+            for (const auto& q : {all, filtered}) {
+                QString name = rows ? q.name + "_rows" : q.name;
+                bench.run(name, [&](int n, Measure &m, QString &error) {
+                    QueryParams params = q.params;
+                    params.newTableName = QStringLiteral("%1_%2")
+                        .arg(name.section('/', 1)).arg(n);
+                    if (sysCat.getTableNames().contains(params.newTableName))
+                        params.newTableName += "_" + QString::number(QDateTime::currentMSecsSinceEpoch());
+                    bool ok = runQuery(q, params, m, error, rows);
+                    dropTableFiles(params.newTableName);
+                    return ok;
+                });
+            }
+        }
+    }
+
+    // Micro benchmarks
+    if (dataset != "movies") {
+        if (bench.selected("micro/csv_parse_record")) {
+            QStringList lines;
+            QFile csv(work.filePath("titanic.csv"));
+            if (csv.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                QTextStream in(&csv);
+                in.readLine();
+                while (!in.atEnd() && lines.size() < 100000)
+                    lines.append(in.readLine());
+            }
+            qint64 bytes = 0;
+            for (const auto& l : lines) bytes += l.toUtf8().size();
+            bench.run("micro/csv_parse_record", [&](int, Measure &m, QString &) {
+                qint64 fields = 0;
+                for (const auto& l : lines)
+                    fields += Loader::parseRecord(l).size();
+                m.items = lines.size();
+                m.bytes = bytes;
+                return fields > 0;
+            });
+        }
+
+        bench.run("micro/split", [&](int, Measure &m, QString &error) {
+            TableFile file(QDir(sysCat.getDbDirPath()).filePath("titanic.txt"));
+            if (!file.open(TableFile::Sequential)) {
+                error = file.errorString();
+                return false;
+            }
+            QByteArrayView line;
+            Row fields;
+            qint64 lines = 0;
+            while (file.readLine(line)) {
+                TableFile::split(line, fields);
+                lines++;
+            }
+            m.items = lines;
+            m.bytes = file.size();
+            file.close();
+            return true;
+        });
+
+        Query q = where("plan/prepare", "titanic", "Fare", 16, "50", "100");
+        bench.run("plan/prepare", [&](int, Measure &m, QString &error) {
+            const int count = 10000;
+            for (int i = 0; i < count; ++i) {
+                if (!QueryPlan::prepare(q.spec, &error).isValid())
+                    return false;
+            }
+            m.items = count;
+            return true;
+        });
+    }
+
+    QJsonObject build;
+    build["qt"] = QString::fromLatin1(qVersion());
+    build["os"] = QSysInfo::prettyProductName();
+    build["cpu"] = QSysInfo::currentCpuArchitecture();
+    build["abi"] = QSysInfo::buildAbi();
+    build["threads"] = QThread::idealThreadCount();
+#ifdef QT_DEBUG
+    build["type"] = "debug";
+#else
+    build["type"] = "release";
+#endif
+    QJsonObject config;
+    config["rows"] = rows;
+    config["seed"] = QString::number(seed);
+    config["iterations"] = bench.iterations;
+    config["warmup"] = bench.warmup;
+    config["dataset"] = dataset;
+    QJsonObject root;
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["label"] = parser.value(labelOption);
+    root["build"] = build;
+    root["config"] = config;
+    root["benchmarks"] = bench.results;
+    QByteArray json = QJsonDocument(root).toJson();
+
+    if (parser.isSet(outOption)) {
+        QFile out(parser.value(outOption));
+        if (!out.open(QIODevice::WriteOnly) || out.write(json) != json.size()) {
+            err << "can't write " << out.fileName() << Qt::endl;
+            return 1;
+        }
+        out.close();
+    } else {
+        QTextStream(stdout) << json;
+    }
+    if (parser.isSet(keepOption))
+        err << "working directory kept: " << workDir << Qt::endl;
+    return bench.failed ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+#include "bitmapindex.h"
+
+#include <QFile>
+#include <QDataStream>
+
+static constexpr quint32 magic = 0x4D424D58;           // "MBMX"
+static constexpr qint32 formatVersion = 1;
+
+void BitmapIndex::Container::add(int offset)
+{
+    if (words.isEmpty() && offsets.size() < arrayLimit) {
+        offsets.append(quint16(offset));
+        return;
+    }
+    if (words.isEmpty()) {
+        words.fill(0, ZoneMap::wordsPerBlock);
+        for (quint16 o : std::as_const(offsets))
+            words[o / 64] |= quint64(1) << (o % 64);
+        offsets.clear();
+    }
+    words[offset / 64] |= quint64(1) << (offset % 64);
+}
+
+void BitmapIndex::Container::uniteInto(quint64 *rows) const
+{
+    if (!words.isEmpty()) {
+        for (qsizetype w = 0; w < ZoneMap::wordsPerBlock; ++w)
+            rows[w] |= words.at(w);
+        return;
+    }
+    for (quint16 o : offsets)
+        rows[o / 64] |= quint64(1) << (o % 64);
+}
+
+bool BitmapIndex::isValid(qint64 fileSize) const
+{
+    return !columns.isEmpty() && bytes == fileSize;
+}
+
+bool BitmapIndex::isEmpty() const
+{
+    return columns.isEmpty();
+}
+
+const BitmapIndex::Column *BitmapIndex::column(int position) const
+{
+    for (const auto& c : columns)
+        if (c.position == position)
+            return &c;
+    return nullptr;
+}
+
+bool BitmapIndex::hasColumn(int position) const
+{
+    return column(position) != nullptr;
+}
+
+QList<int> BitmapIndex::getColumns() const
+{
+    QList<int> result;
+    for (const auto& c : columns)
+        result.append(c.position);
+    return result;
+}
+
+qsizetype BitmapIndex::getBlockCount() const
+{
+    return qsizetype((rows + ZoneMap::rowsPerBlock - 1) / ZoneMap::rowsPerBlock);
+}
+
+QList<QByteArray> BitmapIndex::getValues(int position) const
+{
+    const Column *c = column(position);
+    return c ? c->values : QList<QByteArray>();
+}
+
+void BitmapIndex::extend(TableFile &file, int columnCount, qint64 from)
+{
+    if (from == 0 || bytes != from) {
+        columns.clear();
+        for (int p = 0; p < columnCount; ++p) {
+            Column c;
+            c.position = p;
+            columns.append(c);
+        }
+        rows = 0;
+        from = 0;
+    }
+    file.seek(from);
+    QByteArrayView line;
+    Row fields;
+    while (file.readLine(line)) {
+        TableFile::split(line, fields);
+        qsizetype block = qsizetype(rows / ZoneMap::rowsPerBlock);
+        int offset = int(rows % ZoneMap::rowsPerBlock);
+        for (auto& c : columns) {
+            if (c.dropped || c.position >= fields.size() || fields.at(c.position).isEmpty())
+                continue;
+            QByteArrayView value = fields.at(c.position);
+            // no copy to look it up
+            int id = c.ids.value(QByteArray::fromRawData(value.data(), value.size()), -1);
+            if (id < 0) {
+                if (c.values.size() == maxValues) {
+                    c.dropped = true;
+                    continue;
+                }
+                id = int(c.values.size());
+                c.values.append(value.toByteArray());
+                c.ids.insert(c.values.last(), id);
+                c.containers.append(QList<Container>());
+            }
+            QList<Container> &blocks = c.containers[id];
+            if (blocks.size() <= block)
+                blocks.resize(block + 1);
+            blocks[block].add(offset);
+        }
+        rows++;
+    }
+    columns.removeIf([](const Column &c) { return c.dropped; });
+    bytes = file.pos();
+}
+
+void BitmapIndex::unite(qsizetype block, int position, const QList<int> &ids, QList<quint64> &rows) const
+{
+    const Column *c = column(position);
+    if (!c)
+        return;
+    for (int id : ids) {
+        const QList<Container> &blocks = c->containers.at(id);
+        if (block < blocks.size())
+            blocks.at(block).uniteInto(rows.data());
+    }
+}
+
+bool BitmapIndex::read(const QString &path)
+{
+    columns.clear();
+    rows = 0;
+    bytes = -1;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    quint32 m;
+    qint32 version;
+    qint32 count;
+    in >> m >> version;
+    if (m != magic || version != formatVersion)
+        return false;
+    in >> bytes >> rows >> count;
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        Column c;
+        qint32 position;
+        in >> position >> c.values;
+        c.position = position;
+        for (qsizetype id = 0; id < c.values.size() && in.status() == QDataStream::Ok; ++id) {
+            c.ids.insert(c.values.at(id), int(id));
+            qint64 blockCount;
+            in >> blockCount;
+            QList<Container> blocks(qMax(qint64(0), blockCount));
+            for (auto& b : blocks)
+                in >> b.offsets >> b.words;
+            c.containers.append(blocks);
+        }
+        columns.append(c);
+    }
+    // a truncated file is no index
+    if (in.status() != QDataStream::Ok || columns.size() != count) {
+        columns.clear();
+        rows = 0;
+        bytes = -1;
+        return false;
+    }
+    return true;
+}
+
+bool BitmapIndex::write(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out << magic << formatVersion << bytes << rows << qint32(columns.size());
+    for (const auto& c : columns) {
+        out << qint32(c.position) << c.values;
+        for (const auto& blocks : c.containers) {
+            out << qint64(blocks.size());
+            for (const auto& b : blocks)
+                out << b.offsets << b.words;
+        }
+    }
+    file.close();
+    return out.status() == QDataStream::Ok;
+}
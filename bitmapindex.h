@@ -0,0 +1,70 @@
+#ifndef BITMAPINDEX_H
+#define BITMAPINDEX_H
+
+#include "tablefile.h"
+#include "zonemap.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QHash>
+
+// Rows holding each value of the low cardinality columns (Survived,
+// Pclass, Sex, Embarked...), one container per value and zone map block,
+// Roaring style: the row offsets while they are few, a bitmap of the block
+// after. Values are kept as stored in the table file (dictionary codes,
+// frame-of-reference offsets or plain text); a column is dropped once it
+// shows more than maxValues of them. Empty values are left to the zone
+// map's null bitmaps. Built by the Loader, extended when rows are
+// appended, stored in <table>.bmx.
+
+class BitmapIndex
+{
+public:
+    static constexpr int maxValues = 64;
+
+    BitmapIndex() = default;
+    // Values of the lines from 'from' to the end of the file (load,
+    // append), of every one of 'columnCount' columns when (re)building
+    void extend(TableFile &file, int columnCount, qint64 from = 0);
+    // Only usable if it covers exactly the current table file
+    bool isValid(qint64 fileSize) const;
+    bool isEmpty() const;
+    bool hasColumn(int position) const;
+    QList<int> getColumns() const;
+    qsizetype getBlockCount() const;
+    // Distinct values of the column at 'position', as stored, by value id
+    QList<QByteArray> getValues(int position) const;
+    // ORs into 'rows' (ZoneMap::wordsPerBlock words) the rows of block
+    // 'block' holding one of the values 'ids' at 'position'
+    void unite(qsizetype block, int position, const QList<int> &ids, QList<quint64> &rows) const;
+
+    // binary, QDataStream: header, then per column its values and containers
+    bool read(const QString &path);
+    bool write(const QString &path) const;
+
+private:
+    // as many offsets take the bytes of a block's bitmap
+    static constexpr qsizetype arrayLimit = ZoneMap::wordsPerBlock * 4;
+    struct Container {
+        QList<quint16> offsets;             // rows in the block, ascending, while few
+        QList<quint64> words;               // wordsPerBlock words once not
+        void add(int offset);
+        void uniteInto(quint64 *rows) const;
+    };
+    struct Column {
+        int position = -1;
+        QList<QByteArray> values;           // by value id
+        QHash<QByteArray, int> ids;
+        QList<QList<Container>> containers; // [value id][block]
+        bool dropped = false;               // too many values
+    };
+    QList<Column> columns;
+    qint64 rows = 0;
+    qint64 bytes = -1;                      // file size covered, -1: empty index
+
+    const Column *column(int position) const;
+};
+
+#endif // BITMAPINDEX_H
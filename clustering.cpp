@@ -0,0 +1,74 @@
+#include "clustering.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+
+#include <cmath>
+
+Clustering::Clustering(int position)
+    : position(position)
+{
+}
+
+bool Clustering::isClustered() const
+{
+    return position >= 0;
+}
+
+int Clustering::getPosition() const
+{
+    return position;
+}
+
+qint64 Clustering::getSortedRows() const
+{
+    return sortedRows;
+}
+
+void Clustering::setSortedRows(qint64 rows)
+{
+    sortedRows = rows;
+}
+
+bool Clustering::needsRecluster(qint64 rows) const
+{
+    return isClustered() && (rows - sortedRows) * reclusterFraction > rows;
+}
+
+bool Clustering::isNumeric(char type)
+{
+    return QByteArray("ifdt").contains(type);
+}
+
+double Clustering::numericKey(QByteArrayView value)
+{
+    // empty is 0, NaN matches no comparison and would break the ordering
+    double key = value.toDouble();
+    return std::isnan(key) ? 0 : key;
+}
+
+bool Clustering::read(const QString &path)
+{
+    position = -1;
+    sortedRows = 0;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QStringList parts = QTextStream(&file).readLine().split('#');
+    if (parts.size() < 2)
+        return false;
+    position = parts.at(0).toInt();
+    sortedRows = parts.at(1).toLongLong();
+    return true;
+}
+
+bool Clustering::write(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    out << position << "#" << sortedRows << "\n";
+    return true;
+}
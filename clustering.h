@@ -0,0 +1,46 @@
+#ifndef CLUSTERING_H
+#define CLUSTERING_H
+
+#include <QString>
+#include <QByteArray>
+#include <QByteArrayView>
+
+// Clustering key of a table, stored in <table>.clu: the table file is kept
+// sorted on one column, empty values where the WHERE operators see them (0
+// for numbers, first for text), so its zone map blocks hold
+// disjoint, ascending ranges of the key. A range predicate on it then reads
+// one contiguous run of blocks, and a plain scan returns the rows in key
+// order. Appended rows land unsorted after the first 'sortedRows' ones,
+// Loader sorts the table again once they are more than 1/reclusterFraction
+// of it.
+
+class Clustering
+{
+public:
+    static constexpr qint64 reclusterFraction = 8;
+
+    Clustering() = default;
+    explicit Clustering(int position);
+
+    bool isClustered() const;
+    int getPosition() const;
+    // Rows, counted from the start of the file, in key order
+    qint64 getSortedRows() const;
+    void setSortedRows(qint64 rows);
+    // The table, now 'rows' long, is worth sorting again
+    bool needsRecluster(qint64 rows) const;
+    // Numeric keys (zone map types) are ordered by value, others by bytes
+    static bool isNumeric(char type);
+    // Value of a decoded field as the comparison operators read it
+    static double numericKey(QByteArrayView value);
+
+    // <position>#<sortedRows>
+    bool read(const QString &path);
+    bool write(const QString &path) const;
+
+private:
+    int position = -1;
+    qint64 sortedRows = 0;
+};
+
+#endif // CLUSTERING_H
@@ -0,0 +1,181 @@
+#include "columncodec.h"
+
+#include <QFile>
+#include <QTextStream>
+
+#include <charconv>
+
+bool TableCodec::isPlain() const
+{
+    return columns.isEmpty();
+}
+
+TableCodec::Encoding TableCodec::encoding(int position) const
+{
+    auto it = columns.constFind(position);
+    return it == columns.cend() ? Plain : it->encoding;
+}
+
+const TableCodec::Column &TableCodec::column(int position) const
+{
+    static const Column plain;
+    auto it = columns.constFind(position);
+    return it == columns.cend() ? plain : *it;
+}
+
+void TableCodec::setColumn(int position, const Column &column)
+{
+    if (column.encoding == Plain) {
+        columns.remove(position);
+        return;
+    }
+    Column &c = columns[position];
+    c = column;
+    c.utf8.clear();
+    for (const auto& v : std::as_const(c.dictionary))
+        c.utf8.append(v.toUtf8());
+}
+
+int TableCodec::addValue(int position, const QString &value)
+{
+    auto it = columns.find(position);
+    if (it == columns.end() || it->encoding != Dictionary)
+        return -1;
+    auto code = it->codes.constFind(value);
+    if (code != it->codes.cend())
+        return *code;
+    int next = int(it->dictionary.size());
+    it->dictionary.append(value);
+    it->codes.insert(value, next);
+    it->utf8.append(value.toUtf8());
+    return next;
+}
+
+QString TableCodec::encode(int position, const QString &value) const
+{
+    if (value.isEmpty())
+        return value;
+    const Column &c = column(position);
+    switch (c.encoding) {
+    case Dictionary:
+        return QString::number(c.codes.value(value, -1));
+    case FrameOfReference:
+        return QString::number(value.toLongLong() - c.base);
+    default:
+        return value;
+    }
+}
+
+QString TableCodec::decode(int position, const QString &value) const
+{
+    if (value.isEmpty())
+        return value;
+    const Column &c = column(position);
+    switch (c.encoding) {
+    case Dictionary:
+        return c.dictionary.value(value.toInt());
+    case FrameOfReference:
+        return QString::number(value.toLongLong() + c.base);
+    default:
+        return value;
+    }
+}
+
+QByteArrayView TableCodec::decode(int position, QByteArrayView value, QByteArray &buffer) const
+{
+    if (value.isEmpty())
+        return value;
+    const Column &c = column(position);
+    switch (c.encoding) {
+    case Dictionary:
+    {
+        qsizetype code = value.toInt();
+        return code >= 0 && code < c.utf8.size() ? QByteArrayView(c.utf8.at(code)) : QByteArrayView();
+    }
+    case FrameOfReference:
+    {
+        // no locale nor allocation, once per decoded row
+        buffer.resize(24);
+        auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value.toLongLong() + c.base);
+        buffer.resize(result.ptr - buffer.data());
+        return buffer;
+    }
+    default:
+        return value;
+    }
+}
+
+void TableCodec::decode(QStringList &fields, const QList<int> &positions) const
+{
+    if (isPlain())
+        return;
+    for (qsizetype i = 0; i < fields.size() && i < positions.size(); ++i)
+        if (columns.contains(positions.at(i)))
+            fields[i] = decode(positions.at(i), fields.at(i));
+}
+
+TableCodec TableCodec::project(const QList<int> &positions) const
+{
+    TableCodec projected;
+    for (qsizetype i = 0; i < positions.size(); ++i)
+        projected.setColumn(i, column(positions.at(i)));
+    return projected;
+}
+
+bool TableCodec::read(const QString &path)
+{
+    columns.clear();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QStringList parts = in.readLine().split('#');
+        if (parts.size() < 2 || parts.at(1).isEmpty())
+            continue;
+        int position = parts.takeFirst().toInt();
+        Column c;
+        c.encoding = Encoding(parts.takeFirst().at(0).toLatin1());
+        switch (c.encoding) {
+        case Dictionary:
+        {
+            c.dictionary = parts;
+            for (qsizetype i = 0; i < parts.size(); ++i)
+                c.codes.insert(parts.at(i), i);
+            break;
+        }
+        case FrameOfReference:
+        {
+            c.base = parts.value(0).toLongLong();
+            break;
+        }
+        default:
+            continue;
+        }
+        setColumn(position, c);
+    }
+    file.close();
+    return true;
+}
+
+bool TableCodec::write(const QString &path) const
+{
+    if (isPlain()) {
+        QFile::remove(path);
+        return true;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    for (auto it = columns.cbegin(), end = columns.cend(); it != end; ++it) {
+        out << it.key() << "#" << char(it->encoding);
+        if (it->encoding == Dictionary)
+            out << "#" << it->dictionary.join('#');
+        else if (it->encoding == FrameOfReference)
+            out << "#" << it->base;
+        out << Qt::endl;
+    }
+    file.close();
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef COLUMNCODEC_H
+#define COLUMNCODEC_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QByteArrayView>
+
+// Per-column encodings of a table file, chosen by the Loader and stored in
+// <table>.codec next to <table>.txt. Columns not listed are Plain.
+// Empty values (nulls) are never encoded.
+//  - Dictionary: low cardinality strings, the field holds the entry index
+//    (most frequent values get the shortest codes)
+//  - FrameOfReference: clustered integers, the field holds value - base
+
+class TableCodec
+{
+public:
+    enum Encoding : char {
+        Plain = 'p',
+        Dictionary = 'd',
+        FrameOfReference = 'r'
+    };
+    struct Column {
+        Encoding encoding = Plain;
+        QStringList dictionary;             // code -> value
+        QHash<QString, int> codes;          // value -> code
+        QByteArrayList utf8;                // dictionary as stored in table files
+        qint64 base = 0;
+    };
+
+    bool isPlain() const;
+    Encoding encoding(int position) const;
+    const Column &column(int position) const;
+    void setColumn(int position, const Column &column);
+    // Dictionary column: code of 'value', a new value gets the next code
+    // (existing codes stay valid, appended rows can use it), -1 otherwise
+    int addValue(int position, const QString &value);
+
+    QString encode(int position, const QString &value) const;
+    QString decode(int position, const QString &value) const;
+    // Decodes fields in place, fields.at(i) belongs to column positions.at(i)
+    void decode(QStringList &fields, const QList<int> &positions) const;
+    // Zero-copy variant for mapped rows: dictionary values view the codec,
+    // frame-of-reference values are formatted into 'buffer'
+    QByteArrayView decode(int position, QByteArrayView value, QByteArray &buffer) const;
+    // Codec for a table made of the given columns (SELECT INTO), renumbered 0..n-1
+    TableCodec project(const QList<int> &positions) const;
+
+    // <position>#<encoding>[#base | #value0#value1...] per line
+    bool read(const QString &path);
+    bool write(const QString &path) const;
+
+private:
+    QHash<int, Column> columns;
+};
+
+#endif // COLUMNCODEC_H
@@ -0,0 +1,284 @@
+#include "coveringindex.h"
+#include "systemcatalog.h"
+#include "materializedview.h"
+#include "executor.h"
+#include "loader.h"
+#include "megatron_types.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+
+#include <algorithm>
+
+QString CoveringIndex::indexName(const QString &tableName, const QString &key)
+{
+    return tableName + ".ix_" + key;
+}
+
+QString CoveringIndex::definitionPath(const QString &name)
+{
+    return SystemCatalog::getInstance().getDbDirPath() + "/" + name + ".cov";
+}
+
+bool CoveringIndex::isIndex(const QString &tableName)
+{
+    return QFile::exists(definitionPath(tableName));
+}
+
+QStringList CoveringIndex::indexesOf(const QString &tableName)
+{
+    QStringList indexes;
+    QDir dir(SystemCatalog::getInstance().getDbDirPath());
+    for (const auto& file : dir.entryInfoList({"*.cov"}, QDir::Files)) {
+        Definition index;
+        if (read(file.completeBaseName(), index) && index.tableName == tableName)
+            indexes.append(index.name);
+    }
+    return indexes;
+}
+
+QString CoveringIndex::describe(const QString &indexName)
+{
+    Definition index;
+    if (!read(indexName, index))
+        return QString();
+    if (index.include.isEmpty())
+        return index.key;
+    return QString("%1 INCLUDE (%2)").arg(index.key, index.include.join(", "));
+}
+
+bool CoveringIndex::read(const QString &name, Definition &index)
+{
+    QFile file(definitionPath(name));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QJsonObject o = QJsonDocument::fromJson(file.readAll()).object();
+    if (o.isEmpty())
+        return false;
+    index = Definition();
+    index.name = name;
+    index.tableName = o["table"].toString();
+    index.key = o["key"].toString();
+    for (const auto& c : o["include"].toArray())
+        index.include.append(c.toString());
+    index.bytes = o["bytes"].toString().toLongLong();
+    index.rows = o["rows"].toString().toLongLong();
+    return !index.tableName.isEmpty() && !index.key.isEmpty();
+}
+
+bool CoveringIndex::write(const Definition &index)
+{
+    QJsonObject o;
+    o["table"] = index.tableName;
+    o["key"] = index.key;
+    o["include"] = QJsonArray::fromStringList(index.include);
+    // as strings, JSON numbers are doubles
+    o["bytes"] = QString::number(index.bytes);
+    o["rows"] = QString::number(index.rows);
+    QFile file(definitionPath(index.name));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    QByteArray json = QJsonDocument(o).toJson();
+    return file.write(json) == json.size();
+}
+
+QuerySpec CoveringIndex::specOf(const Definition &index)
+{
+    // SELECT key, include... INTO index FROM table
+    QuerySpec spec;
+    spec.attributes = QStringList{index.key} + index.include;
+    spec.tableName = index.tableName;
+    spec.into = true;
+    return spec;
+}
+
+bool CoveringIndex::create(const QString &tableName, const QString &key, const QStringList &include,
+                           QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error) *error = message;
+        return false;
+    };
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    if (sysCat->find(tableName) == sysCat->end())
+        return fail(tr("Table: %1 not found in schema.").arg(tableName));
+    if (isIndex(tableName))
+        return fail(tr("Table: %1 is an index.").arg(tableName));
+    // an index follows the table file, partitions have files of their own
+    if (sysCat->getPartitioning(tableName).isPartitioned())
+        return fail(tr("Table: %1 is partitioned, indexes over it aren't supported.").arg(tableName));
+    Definition index;
+    index.name = indexName(tableName, key);
+    index.tableName = tableName;
+    index.key = key;
+    for (const auto& c : include)
+        if (c != key && !index.include.contains(c))
+            index.include.append(c);
+    if (sysCat->find(index.name) != sysCat->end())
+        return fail(tr("Index: %1 already exists.").arg(index.name));
+    QString planError;
+    QueryPlan plan = QueryPlan::prepare(specOf(index), &planError);
+    if (!plan.isValid())
+        return fail(planError);
+    // what the scan below sees, nothing appends meanwhile
+    index.bytes = QFileInfo(sysCat->getDbDirPath() + "/" + tableName + ".txt").size();
+    index.rows = MaterializedView::rowCount(tableName, index.bytes);
+
+    QueryParams params;
+    params.newTableName = index.name;
+    Executor executor(plan, params);
+    executor.setIntoOutput(false);
+    DiscardSink sink;
+    if (!executor.run(sink))
+        return fail(executor.errorString());
+    Loader loader(index.name);
+    if (!loader.cluster(0)) {
+        sysCat->removeTable(index.name);
+        return fail(loader.errorString());
+    }
+    if (!write(index)) {
+        sysCat->removeTable(index.name);
+        return fail(tr("Error while writing Index file: %1").arg(definitionPath(index.name)));
+    }
+    return true;
+}
+
+bool CoveringIndex::drop(const QString &indexName, QString *error)
+{
+    if (!isIndex(indexName)) {
+        if (error) *error = tr("Index: %1 doesn't exist.").arg(indexName);
+        return false;
+    }
+    // the definition goes with the index's files
+    if (!SystemCatalog::getInstance().removeTable(indexName)) {
+        if (error) *error = tr("Error while removing the files of Index: %1").arg(indexName);
+        return false;
+    }
+    return true;
+}
+
+bool CoveringIndex::refresh(Definition &index, QString *error)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    qint64 size = QFileInfo(sysCat->getDbDirPath() + "/" + index.tableName + ".txt").size();
+    if (size == index.bytes)
+        return true;
+    if (size < index.bytes)
+        return drop(index.name, error) && create(index.tableName, index.key, index.include, error);
+    QString planError;
+    QueryPlan plan = QueryPlan::prepare(specOf(index), &planError);
+    if (!plan.isValid()) {
+        if (error) *error = planError;
+        return false;
+    }
+    // only the rows appended since, at the end of the index
+    QueryParams params;
+    params.newTableName = index.name;
+    Executor executor(plan, params);
+    executor.setIntoOutput(false);
+    executor.setIntoAppend(true);
+    executor.setScanFrom(index.bytes, index.rows);
+    DiscardSink sink;
+    if (!executor.run(sink)) {
+        if (error) *error = executor.errorString();
+        return false;
+    }
+    index.bytes = size;
+    index.rows = MaterializedView::rowCount(index.tableName, size);
+    if (!write(index)) {
+        if (error) *error = tr("Error while writing Index file: %1").arg(definitionPath(index.name));
+        return false;
+    }
+    // sorted again once the unsorted tail has grown enough
+    Clustering clustering = sysCat->getClustering(index.name);
+    if (clustering.needsRecluster(sysCat->getZoneMap(index.name).getRowCount())) {
+        Loader loader(index.name);
+        if (!loader.cluster(0)) {
+            if (error) *error = loader.errorString();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CoveringIndex::refreshIndexesOf(const QString &tableName, QString *error)
+{
+    for (const auto& name : indexesOf(tableName)) {
+        Definition index;
+        if (!read(name, index)) {
+            if (error) *error = tr("Error while reading Index file: %1").arg(definitionPath(name));
+            return false;
+        }
+        if (!refresh(index, error))
+            return false;
+    }
+    return true;
+}
+
+bool CoveringIndex::rebuildIndexesOf(const QString &tableName, QString *error)
+{
+    for (const auto& name : indexesOf(tableName)) {
+        Definition index;
+        if (!read(name, index)) {
+            if (error) *error = tr("Error while reading Index file: %1").arg(definitionPath(name));
+            return false;
+        }
+        if (!drop(index.name, error) || !create(index.tableName, index.key, index.include, error))
+            return false;
+    }
+    return true;
+}
+
+QString CoveringIndex::covering(const QueryPlan &plan)
+{
+    if (!plan.hasClause(Types::Where))
+        return QString();
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    QSet<QString> columns;
+    for (int p : plan.projection)
+        columns.insert(plan.meta.at(p).attributeName);
+    for (const auto& p : plan.predicates)
+        columns.insert(plan.meta.at(p.fieldPosition).attributeName);
+    for (const auto& p : plan.predicates) {
+        // catalog lookups only, the table has an index on the column or not
+        QString name = indexName(plan.tableName, plan.meta.at(p.fieldPosition).attributeName);
+        if (sysCat->find(name) == sysCat->end())
+            continue;
+        QSet<QString> covered;
+        for (const auto& m : sysCat->values(name))
+            covered.insert(m.attributeName);
+        Definition index;
+        if (!covered.contains(columns) || !read(name, index))
+            continue;
+        // an index missing appended rows would miss their matches
+        if (QFileInfo(sysCat->getDbDirPath() + "/" + plan.tableName + ".txt").size() == index.bytes)
+            return name;
+    }
+    return QString();
+}
+
+QueryPlan CoveringIndex::indexPlan(const QueryPlan &plan, const QString &indexName)
+{
+    QueryPlan indexPlan = plan;
+    indexPlan.tableName = indexName;
+    indexPlan.meta = SystemCatalog::getInstance().values(indexName);
+    std::reverse(indexPlan.meta.begin(), indexPlan.meta.end());
+    auto positionOf = [&indexPlan](const QString &name) {
+        for (const auto& m : std::as_const(indexPlan.meta))
+            if (m.attributeName == name)
+                return m.position;
+        return -1;
+    };
+    // '*' names the table's columns, in the table's order
+    indexPlan.clauses.replace(QChar(char(Types::SelectAll)), QChar(char(Types::SelectCustom)));
+    for (int &p : indexPlan.projection)
+        p = positionOf(plan.meta.at(p).attributeName);
+    for (auto &p : indexPlan.predicates)
+        p.fieldPosition = positionOf(plan.meta.at(p.fieldPosition).attributeName);
+    return indexPlan;
+}
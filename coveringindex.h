@@ -0,0 +1,62 @@
+#ifndef COVERINGINDEX_H
+#define COVERINGINDEX_H
+
+#include "queryplan.h"
+
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+
+// CREATE INDEX ON table (key) INCLUDE (columns): a copy of the key and the
+// included columns of every row, kept in a relation of its own,
+// <table>.ix_<key>, clustered on the key. A query whose columns (selected
+// and in WHERE) it all holds and whose WHERE clause reads the key runs on
+// the index instead of the table: the key's range is one run of its sorted
+// blocks and no wider row is ever read. <index>.cov keeps the definition
+// and how much of the table (bytes, rows) the index holds; one that
+// doesn't hold all of it is stale and left alone, so rows are never seen
+// without the table having them. Appended rows are added like a
+// materialized view's, rows moved by clustering the table rebuild it.
+
+class CoveringIndex
+{
+    Q_DECLARE_TR_FUNCTIONS(CoveringIndex)
+public:
+    static QString indexName(const QString &tableName, const QString &key);
+    static bool create(const QString &tableName, const QString &key, const QStringList &include,
+                       QString *error = nullptr);
+    static bool drop(const QString &indexName, QString *error = nullptr);
+    // Adds the rows appended to 'tableName' to its indexes
+    static bool refreshIndexesOf(const QString &tableName, QString *error = nullptr);
+    // Builds the indexes of 'tableName' again, its rows moved
+    static bool rebuildIndexesOf(const QString &tableName, QString *error = nullptr);
+    static bool isIndex(const QString &tableName);
+    // Names of the indexes on 'tableName'
+    static QStringList indexesOf(const QString &tableName);
+    // "key INCLUDE (a, b)", empty if 'indexName' isn't one
+    static QString describe(const QString &indexName);
+
+    // Up to date index holding every column the plan reads, one of its
+    // WHERE columns being the key, empty if none
+    static QString covering(const QueryPlan &plan);
+    // 'plan' over the columns of the index
+    static QueryPlan indexPlan(const QueryPlan &plan, const QString &indexName);
+
+private:
+    struct Definition {
+        QString name;
+        QString tableName;
+        QString key;
+        QStringList include;
+        qint64 bytes = 0;                       // of the table already in the index
+        qint64 rows = 0;
+    };
+
+    static QString definitionPath(const QString &name);
+    static bool read(const QString &name, Definition &index);
+    static bool write(const Definition &index);
+    static bool refresh(Definition &index, QString *error);
+    static QuerySpec specOf(const Definition &index);
+};
+
+#endif // COVERINGINDEX_H
@@ -0,0 +1,1418 @@
+#include "executor.h"
+#include "coveringindex.h"
+#include "metrics.h"
+#include "resultset.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 33)
+#include <malloc.h>
+#define HAVE_MALLINFO2
+#endif
+#endif
+
+static qint64 clockNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Bytes handed out by malloc, -1 if unknown
+static qint64 heapInUse()
+{
+#ifdef HAVE_MALLINFO2
+    return qint64(mallinfo2().uordblks);
+#else
+    return -1;
+#endif
+}
+
+Executor::Executor(const QueryPlan &plan, const QueryParams &params)
+    : plan(plan)
+    , params(params)
+{
+}
+
+QString Executor::errorString() const
+{
+    return error;
+}
+
+void Executor::setProfile(QueryProfile *p)
+{
+    profile = p;
+}
+
+void Executor::setAnalyze(bool a)
+{
+    analyze = a;
+}
+
+void Executor::setIntoOutput(bool rows)
+{
+    intoOutput = rows;
+}
+
+void Executor::setIntoAppend(bool append)
+{
+    intoAppend = append;
+}
+
+void Executor::setScanFrom(qint64 offset, qint64 firstRow)
+{
+    scanFrom = offset;
+    scanFromRow = firstRow;
+}
+
+void Executor::setSample(const TableSample &s)
+{
+    sample = s;
+}
+
+qint64 Executor::getIntoRows() const
+{
+    return intoRows;
+}
+
+bool Executor::open(TableFile &tableFile, TableFile::Access access)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    codec = sysCat->getCodec(plan.tableName);
+    if (!tableFile.open(access)) {
+        error = tableFile.errorString();
+        return false;
+    }
+    zoneMap = sysCat->getZoneMap(plan.tableName);
+    if (!zoneMap.isValid(tableFile.size()))
+        zoneMap = ZoneMap();
+    const ZoneMap *validZoneMap = zoneMap.getBlocks().isEmpty() ? nullptr : &zoneMap;
+    // rows and blocks are drawn by their numbers in the zone map
+    if (sample.isSampling() && !validZoneMap && tableFile.size() > 0) {
+        error = tr("Table: %1 has no up to date zone map, it can't be sampled.").arg(plan.tableName);
+        tableFile.close();
+        return false;
+    }
+    // built over the same blocks as the zone map
+    trigramIndex = sysCat->getTrigramIndex(plan.tableName);
+    if (!trigramIndex.isValid(tableFile.size()) || trigramIndex.getBlockCount() != zoneMap.getBlocks().size())
+        trigramIndex = TrigramIndex();
+    const TrigramIndex *validIndex = trigramIndex.isEmpty() ? nullptr : &trigramIndex;
+    invertedIndex = sysCat->getInvertedIndex(plan.tableName);
+    if (!invertedIndex.isValid(tableFile.size()))
+        invertedIndex = InvertedIndex();
+    const InvertedIndex *validInverted = invertedIndex.isEmpty() ? nullptr : &invertedIndex;
+    // same blocks as the zone map too
+    bitmapIndex = sysCat->getBitmapIndex(plan.tableName);
+    if (!bitmapIndex.isValid(tableFile.size()) || bitmapIndex.getBlockCount() != zoneMap.getBlocks().size())
+        bitmapIndex = BitmapIndex();
+    const BitmapIndex *validBitmaps = bitmapIndex.isEmpty() ? nullptr : &bitmapIndex;
+    clustering = sysCat->getClustering(plan.tableName);
+    if (clustering.getSortedRows() > zoneMap.getRowCount())
+        clustering = Clustering();
+    if (plan.hasClause(Types::Where) &&
+        !rowFilter.bind(plan, params, codec, validZoneMap, validIndex, validInverted, validBitmaps)) {
+        error = rowFilter.errorString();
+        return false;
+    }
+    return true;
+}
+
+QList<Executor::ScanRange> Executor::scanRanges(const TableFile &tableFile)
+{
+    QList<ScanRange> ranges;
+    blocks = blocksSkipped = 0;
+    bitmapRows = indexRows = -1;
+    clusteredScan = false;
+    // a delta: few rows, all of them filtered
+    if (scanFrom >= 0) {
+        ScanRange range;
+        range.begin = qMin(scanFrom, tableFile.size());
+        range.end = tableFile.size();
+        range.firstRow = scanFromRow;
+        ranges.append(range);
+        return ranges;
+    }
+    // Contains on indexed terms: only the lines of the candidate rows
+    QList<qint64> candidates;
+    if (!sample.isSampling() && plan.hasClause(Types::Where) && rowFilter.candidates(candidates) &&
+        qint64(candidates.size()) <= invertedIndex.getRowCount() / indexedFraction) {
+        for (qint64 row : std::as_const(candidates)) {
+            qint64 begin, end;
+            invertedIndex.rowSpan(row, begin, end);
+            // consecutive rows make one read
+            if (!ranges.isEmpty() && ranges.last().end == begin) {
+                ranges.last().end = end;
+                continue;
+            }
+            ScanRange range;
+            range.begin = begin;
+            range.end = end;
+            range.firstRow = row;
+            ranges.append(range);
+        }
+        indexRows = candidates.size();
+        return ranges;
+    }
+    // clustered: the key's range is one run of the sorted blocks
+    qsizetype firstBlock = 0, lastBlock = 0, sortedBlocks = 0;
+    clusteredScan = plan.hasClause(Types::Where) &&
+                    clusteredBlocks(tableFile, firstBlock, lastBlock, sortedBlocks);
+    if ((plan.hasClause(Types::Where) && (rowFilter.usesZoneMap() || clusteredScan)) || sample.isSampling()) {
+        const QList<ZoneMap::Block> &zoneBlocks = zoneMap.getBlocks();
+        blocks = zoneBlocks.size();
+        bool bitmaps = true;
+        qint64 selectedRows = 0;
+        qint64 row = 0;
+        QList<quint64> selection;
+        for (qsizetype i = 0; i < zoneBlocks.size(); row += zoneBlocks.at(i).rows, ++i) {
+            const ZoneMap::Block &b = zoneBlocks.at(i);
+            if ((sample.method == TableSample::Block && !sample.draws(i)) ||
+                (clusteredScan && i < sortedBlocks && (i < firstBlock || i >= lastBlock)) ||
+                !rowFilter.mayMatch(i)) {
+                blocksSkipped++;
+                continue;
+            }
+            // the null bitmaps pick rows before they are split
+            bool exact = false;
+            qint64 selected = rowFilter.select(i, selection, exact);
+            bitmaps = bitmaps && selected >= 0;
+            // rows not drawn are skipped like those the bitmaps leave out
+            if (sample.method == TableSample::Bernoulli) {
+                if (selected < 0) {
+                    selection.resize(ZoneMap::wordsPerBlock);
+                    for (qsizetype w = 0; w < ZoneMap::wordsPerBlock; ++w) {
+                        qint64 present = qBound(qint64(0), b.rows - w * 64, qint64(64));
+                        selection[w] = present == 64 ? ~quint64(0) : (quint64(1) << present) - 1;
+                    }
+                    exact = false;
+                }
+                selected = sample.drawRows(row, selection);
+            }
+            selectedRows += qMax(qint64(0), selected);
+            if (selected == 0) {
+                blocksSkipped++;
+                continue;
+            }
+            bool whole = selected < 0 || selected == b.rows;
+            bool filter = selected < 0 || !exact;
+            // merge consecutive blocks into one sequential read
+            if (whole && !ranges.isEmpty() && ranges.last().selection.isEmpty() &&
+                ranges.last().filter == filter && ranges.last().end == b.offset) {
+                ranges.last().end = b.end;
+                continue;
+            }
+            ScanRange range;
+            range.begin = b.offset;
+            range.end = b.end;
+            range.firstRow = row;
+            range.filter = filter;
+            if (!whole)
+                range.selection = selection;
+            ranges.append(range);
+        }
+        if (bitmaps)
+            bitmapRows = selectedRows;
+        return ranges;
+    }
+    ScanRange range;
+    range.end = tableFile.size();
+    ranges.append(range);
+    return ranges;
+}
+
+bool Executor::clusteredBlocks(const TableFile &tableFile, qsizetype &first, qsizetype &last,
+                               qsizetype &sorted) const
+{
+    const QList<ZoneMap::Block> &zoneBlocks = zoneMap.getBlocks();
+    if (!clustering.isClustered() || zoneBlocks.isEmpty())
+        return false;
+    int key = clustering.getPosition();
+    bool numeric = Clustering::isNumeric(plan.meta.at(key).type);
+    // bounds of the key: numbers for the comparisons, bytes for isEqualTo
+    // and BeginsWith on text
+    double lower = -std::numeric_limits<double>::infinity();
+    double upper = std::numeric_limits<double>::infinity();
+    QByteArray text;
+    bool prefix = false;
+    bool bounded = false;
+    for (qsizetype i = 0; i < plan.predicates.size(); ++i) {
+        const QueryPlan::Predicate &p = plan.predicates.at(i);
+        // any OR group may match anywhere
+        if (i > 0 && p.orPrevious)
+            return false;
+        if (p.fieldPosition != key)
+            continue;
+        QueryParams::Operands operands = params.conditions.value(i);
+        bool ok, upperOk = true;
+        if (numeric) {
+            double x = operands.condition1.toDouble(&ok);
+            double y = p.optor == 16 ? operands.condition2.toDouble(&upperOk) : x;
+            if (!ok || !upperOk)
+                continue;
+            switch (p.optor) {
+            case 0: case 4: upper = qMin(upper, x); break;                  // <, <=
+            case 1: case 5: lower = qMax(lower, x); break;                  // >, >=
+            case 3: case 16: lower = qMax(lower, x); upper = qMin(upper, y); break;
+            default: continue;
+            }
+        }
+        else {
+            // rows satisfy every AND predicate, any one of them bounds them
+            if (p.optor != 3 && p.optor != 7)
+                continue;
+            text = operands.condition1.toUtf8();
+            prefix = p.optor == 7;
+        }
+        bounded = true;
+    }
+    if (!bounded)
+        return false;
+
+    // only whole blocks of sorted rows, the rest is read as usual
+    sorted = 0;
+    for (qint64 rows = 0; sorted < zoneBlocks.size() &&
+         rows + zoneBlocks.at(sorted).rows <= clustering.getSortedRows(); ++sorted)
+        rows += zoneBlocks.at(sorted).rows;
+    QByteArray buffer;
+    Row fields;
+    auto firstKey = [&](qsizetype block) {
+        QByteArrayView line = tableFile.data().sliced(zoneBlocks.at(block).offset);
+        qsizetype end = line.indexOf('\n');
+        if (end >= 0)
+            line.truncate(end);
+        if (line.endsWith('\r'))
+            line.chop(1);
+        TableFile::split(line, fields);
+        return codec.decode(key, key < fields.size() ? fields.at(key) : QByteArrayView(), buffer);
+    };
+    auto below = [&](qsizetype block) {                 // starts below the lower bound
+        QByteArrayView k = firstKey(block);
+        return numeric ? Clustering::numericKey(k) < lower : k < QByteArrayView(text);
+    };
+    auto above = [&](qsizetype block) {                 // starts past the upper bound
+        QByteArrayView k = firstKey(block);
+        if (numeric)
+            return Clustering::numericKey(k) > upper;
+        return k > QByteArrayView(text) && !(prefix && k.startsWith(text));
+    };
+    // first block starting at the lower bound or more, the one before may hold it too
+    qsizetype lo = 0, hi = sorted;
+    while (lo < hi) {
+        qsizetype mid = (lo + hi) / 2;
+        if (below(mid)) lo = mid + 1; else hi = mid;
+    }
+    first = qMax(qsizetype(0), lo - 1);
+    lo = first;
+    hi = sorted;
+    while (lo < hi) {
+        qsizetype mid = (lo + hi) / 2;
+        if (above(mid)) hi = mid; else lo = mid + 1;
+    }
+    last = lo;
+    return true;
+}
+
+QString Executor::filterDetail() const
+{
+    QString detail = rowFilter.describe(plan, params);
+    if (bitmapRows >= 0)
+        detail += tr(", bitmaps select rows before splitting");
+    return detail;
+}
+
+void Executor::describe(QueryProfile &profile, const TableFile &tableFile) const
+{
+    auto &ops = profile.operators;
+    ops[QueryProfile::Scan].name = tr("Scan");
+    if (scanFrom >= 0)
+        ops[QueryProfile::Scan].detail = tr("%1 (%2 bytes), rows from byte %3 on")
+            .arg(plan.tableName).arg(tableFile.size()).arg(scanFrom);
+    else if (indexRows >= 0)
+        ops[QueryProfile::Scan].detail = tr("%1 (%2 bytes), inverted index: %3 of %4 rows read")
+            .arg(plan.tableName).arg(tableFile.size()).arg(indexRows).arg(invertedIndex.getRowCount());
+    else if (bitmapRows >= 0)
+        ops[QueryProfile::Scan].detail = tr("%1 (%2 bytes), %3: %4 rows selected, %5 of %6 blocks skipped")
+            .arg(plan.tableName).arg(tableFile.size())
+            .arg(rowFilter.usesBitmapIndex() ? tr("bitmap index") : tr("null bitmaps"))
+            .arg(bitmapRows).arg(blocksSkipped).arg(blocks);
+    else if (clusteredScan)
+        ops[QueryProfile::Scan].detail = tr("%1 (%2 bytes), clustered on %3: %4 of %5 blocks skipped")
+            .arg(plan.tableName).arg(tableFile.size()).arg(plan.meta.at(clustering.getPosition()).attributeName)
+            .arg(blocksSkipped).arg(blocks);
+    else if (blocks > 0)
+        ops[QueryProfile::Scan].detail = tr("%1 (%2 bytes), zone map: %3 of %4 blocks skipped")
+            .arg(plan.tableName).arg(tableFile.size()).arg(blocksSkipped).arg(blocks);
+    else
+        ops[QueryProfile::Scan].detail = tr("%1 (%2 bytes), full scan").arg(plan.tableName).arg(tableFile.size());
+    if (sample.isSampling())
+        ops[QueryProfile::Scan].detail += tr(", TABLESAMPLE %1").arg(sample.describe());
+    profile.blocks = blocks;
+    profile.blocksSkipped = blocksSkipped;
+
+    ops[QueryProfile::Split].name = tr("Split");
+    ops[QueryProfile::Split].detail = tr("'#' separated, %1 columns").arg(plan.meta.size());
+
+    if (plan.hasClause(Types::Where)) {
+        ops[QueryProfile::Filter].name = tr("Filter");
+        ops[QueryProfile::Filter].detail = filterDetail();
+    }
+
+    QStringList attributes;
+    QStringList decoded;
+    for (int p : plan.projection) {
+        attributes.append(plan.meta.at(p).attributeName);
+        if (codec.encoding(p) != TableCodec::Plain)
+            decoded.append(plan.meta.at(p).attributeName);
+    }
+    ops[QueryProfile::Project].name = tr("Project");
+    ops[QueryProfile::Project].detail = attributes.join(", ");
+    if (!decoded.isEmpty())
+        ops[QueryProfile::Project].detail += tr(", decodes %1").arg(decoded.join(", "));
+
+    if (plan.hasClause(Types::SelectInto)) {
+        ops[QueryProfile::Into].name = tr("Into");
+        switch (intoPath()) {
+        case IntoCopy:
+            ops[QueryProfile::Into].detail = tr("new table %1, file copy").arg(params.newTableName);
+            break;
+        case IntoParallel:
+            ops[QueryProfile::Into].detail = tr("new table %1, %2 parallel writers")
+                .arg(params.newTableName).arg(intoWriters);
+            break;
+        default:
+            ops[QueryProfile::Into].detail = tr("new table %1").arg(params.newTableName);
+        }
+    }
+    ops[QueryProfile::Output].name = tr("Output");
+}
+
+bool Executor::explain(QueryProfile &profile)
+{
+    Partitioning partitioning = SystemCatalog::getInstance().getPartitioning(plan.tableName);
+    if (partitioning.isPartitioned())
+        return explainPartitions(profile, partitioning);
+    QString index = scanFrom < 0 && !sample.isSampling() ? CoveringIndex::covering(plan) : QString();
+    if (!index.isEmpty())
+        return explainIndex(profile, index);
+    TableFile tableFile(SystemCatalog::getInstance().getDbDirPath() + "/" + plan.tableName + ".txt");
+    if (!open(tableFile, TableFile::Random))
+        return false;
+    intoWriters = writerCount(scanRanges(tableFile));
+    describe(profile, tableFile);
+    tableFile.close();
+    return true;
+}
+
+Executor::Batch::Batch()
+    : lines(RowFilter::batchRows)
+    , rowNumbers(RowFilter::batchRows)
+    , rows(RowFilter::batchRows)
+    , selection(RowFilter::batchRows)
+    , filtered(RowFilter::batchRows)
+    , passed(RowFilter::batchRows)
+{
+}
+
+bool Executor::readBatch(TableFile &tableFile, const QList<ScanRange> &ranges,
+                         ScanCursor &cursor, Batch &batch)
+{
+    // filled across ranges, the inverted index makes many short ones
+    QByteArrayView line;
+    batch.size = 0;
+    readAhead(tableFile, ranges, cursor);
+    while (batch.size < RowFilter::batchRows) {
+        const ScanRange *range = cursor.range;
+        if (!range || tableFile.pos() >= range->end || !tableFile.readLine(line)) {
+            if (cursor.nextRange == ranges.size())
+                return false;
+            if (range)
+                cursor.consumed += range->end - range->begin;
+            cursor.range = &ranges.at(cursor.nextRange++);
+            tableFile.seek(cursor.range->begin);
+            cursor.row = cursor.range->firstRow;
+            continue;
+        }
+        cursor.scanned++;
+        qint64 r = cursor.row++ - range->firstRow;
+        if (!range->selection.isEmpty()) {
+            quint64 word = range->selection.at(r / 64) >> (r % 64);
+            if (!(word & 1)) {
+                // nothing left selected in this word: skip its lines at once
+                for (qint64 skip = word ? 0 : 63 - r % 64; skip > 0; --skip) {
+                    if (tableFile.pos() >= range->end || !tableFile.readLine(line))
+                        break;
+                    cursor.scanned++;
+                    cursor.row++;
+                }
+                continue;
+            }
+        }
+        batch.lines[batch.size] = line;
+        batch.rowNumbers[batch.size] = cursor.row - 1;
+        batch.filtered[batch.size] = range->filter;
+        batch.size++;
+    }
+    return true;
+}
+
+void Executor::readAhead(const TableFile &tableFile, const QList<ScanRange> &ranges,
+                         ScanCursor &cursor)
+{
+    static Metrics::Counter &readAheadBytes = Metrics::getInstance().counter(
+        "megatron_readahead_bytes_total", "Table file bytes requested ahead of scans");
+    qint64 read = cursor.consumed + (cursor.range ? tableFile.pos() - cursor.range->begin : 0);
+    if (cursor.aheadRange == ranges.size() || cursor.aheadBytes - read > cursor.window / 2)
+        return;
+    // one request per run of close ranges, however many ranges the window holds
+    qint64 budget = cursor.window;
+    qint64 begin = -1, end = -1;
+    auto request = [&]() {
+        if (tableFile.prefetch(begin, end))
+            readAheadBytes.add(end - begin);
+    };
+    while (budget > 0 && cursor.aheadRange < ranges.size()) {
+        const ScanRange &range = ranges.at(cursor.aheadRange);
+        qint64 from = qMax(range.begin, cursor.ahead);
+        qint64 to = qMin(range.end, from + budget);
+        if (end >= 0 && from - end > readAheadGap) {
+            request();
+            begin = -1;
+        }
+        if (begin < 0)
+            begin = from;
+        end = to;
+        budget -= to - from;
+        cursor.aheadBytes += to - from;
+        cursor.ahead = to;
+        if (to == range.end) {
+            cursor.aheadRange++;
+            cursor.ahead = 0;
+        }
+    }
+    if (begin >= 0)
+        request();
+    // still scanning after a whole window: a long scan, ask for more next time
+    cursor.window = qMin(cursor.window * 2, readAheadMax);
+}
+
+void Executor::filterBatch(RowFilter *filter, Batch &batch)
+{
+    int n = batch.size;
+    int kept = 0;
+    if (filter)
+        for (int i = 0; i < n; ++i)
+            if (batch.filtered.at(i))
+                batch.selection[kept++] = i;
+    if (kept == 0) {
+        for (int i = 0; i < n; ++i)
+            batch.selection[i] = i;
+        batch.kept = n;
+        return;
+    }
+    bool decided = kept < n;
+    kept = filter->apply(batch.rows.constData(), batch.rowNumbers.constData(), batch.selection.data(), kept);
+    if (decided) {
+        // back in row order with the rows the bitmaps already decided
+        for (int i = 0; i < n; ++i)
+            batch.passed[i] = !batch.filtered.at(i);
+        for (int k = 0; k < kept; ++k)
+            batch.passed[batch.selection.at(k)] = true;
+        kept = 0;
+        for (int i = 0; i < n; ++i)
+            if (batch.passed.at(i))
+                batch.selection[kept++] = i;
+    }
+    batch.kept = kept;
+}
+
+Executor::IntoPath Executor::intoPath() const
+{
+    // both fast paths need the zone map: copied along, or telling where
+    // segments start; EXPLAIN ANALYZE times the pipeline
+    if (!plan.hasClause(Types::SelectInto) || intoOutput || analyze || zoneMap.getBlocks().isEmpty())
+        return IntoRows;
+    if (plan.hasClause(Types::SelectAll) && !plan.hasClause(Types::Where) && !intoAppend && scanFrom < 0 &&
+        !sample.isSampling())
+        return IntoCopy;
+    return IntoParallel;
+}
+
+int Executor::writerCount(const QList<ScanRange> &ranges) const
+{
+    qint64 bytes = 0;
+    for (const auto& range : ranges)
+        bytes += range.end - range.begin;
+    return int(qBound(qint64(1), bytes / segmentBytes, qint64(qMax(1, QThread::idealThreadCount()))));
+}
+
+bool Executor::copyInto(const TableFile &tableFile, QFile &newTableFile)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    const QString &newTableName = params.newTableName;
+    if (!TableFile::append(newTableFile, tableFile.fileName())) {
+        error = tr("Error while copying Table file: %1").arg(tableFile.fileName());
+        return false;
+    }
+    for (const auto& b : zoneMap.getBlocks())
+        intoRows += b.rows;
+    // same bytes: the sidecars of the table hold for the copy
+    if (!sysCat->setZoneMap(newTableName, zoneMap)) {
+        error = tr("Error while writing Zone Map file for: %1").arg(newTableName);
+        return false;
+    }
+    sysCat->setTrigramIndex(newTableName, trigramIndex);
+    sysCat->setInvertedIndex(newTableName, invertedIndex);
+    sysCat->setBitmapIndex(newTableName, bitmapIndex);
+    return true;
+}
+
+bool Executor::writeInto(const TableFile &tableFile, const QList<ScanRange> &ranges, QFile &newTableFile,
+                         QList<QPair<qint64, int>> &blanks, qint64 &scanned)
+{
+    // ranges cut at zone map blocks, so that each piece knows its first row
+    const QList<ZoneMap::Block> &zoneBlocks = zoneMap.getBlocks();
+    QList<ScanRange> pieces;
+    qint64 bytes = 0;
+    for (const auto& range : ranges) {
+        bytes += range.end - range.begin;
+        auto b = std::lower_bound(zoneBlocks.cbegin(), zoneBlocks.cend(), range.begin,
+                                  [](const ZoneMap::Block &block, qint64 offset) { return block.offset < offset; });
+        if (!range.selection.isEmpty() || b == zoneBlocks.cend() || b->offset != range.begin) {
+            pieces.append(range);
+            continue;
+        }
+        qint64 row = range.firstRow;
+        for (; b != zoneBlocks.cend() && b->offset < range.end; row += b->rows, ++b) {
+            ScanRange piece = range;
+            piece.begin = b->offset;
+            piece.end = qMin(b->end, range.end);
+            piece.firstRow = row;
+            pieces.append(piece);
+        }
+    }
+    // consecutive pieces of about the same size per writer
+    QList<Segment> segments(intoWriters);
+    qint64 perWriter = bytes / intoWriters + 1;
+    qint64 assigned = 0;
+    for (const auto& piece : std::as_const(pieces)) {
+        segments[qMin(qsizetype(assigned / perWriter), segments.size() - 1)].ranges.append(piece);
+        assigned += piece.end - piece.begin;
+    }
+    QList<QThread *> threads;
+    for (qsizetype i = 0; i < segments.size(); ++i) {
+        Segment *segment = &segments[i];
+        segment->source = tableFile.fileName();
+        segment->path = newTableFile.fileName() + QString(".part%1").arg(i);
+        segment->filter = rowFilter;
+        QThread *thread = QThread::create([this, segment] { writeSegment(*segment); });
+        thread->start();
+        threads.append(thread);
+    }
+    for (QThread *thread : std::as_const(threads)) {
+        thread->wait();
+        delete thread;
+    }
+    // stitched in order, by the kernel where it can
+    bool ok = true;
+    for (const auto& segment : std::as_const(segments)) {
+        if (ok && !segment.error.isEmpty()) {
+            error = segment.error;
+            ok = false;
+        }
+        if (ok && !TableFile::append(newTableFile, segment.path)) {
+            error = tr("Error while copying Table file: %1").arg(segment.path);
+            ok = false;
+        }
+        for (const auto& cell : segment.blanks)
+            blanks.append({intoRows + cell.first, cell.second});
+        intoRows += segment.rows;
+        scanned += segment.scanned;
+        QFile::remove(segment.path);
+    }
+    return ok;
+}
+
+void Executor::writeSegment(Segment &segment) const
+{
+    // own mapping of the table file, reading needs its own position
+    TableFile tableFile(segment.source);
+    if (!tableFile.open(TableFile::Sequential)) {
+        segment.error = tableFile.errorString();
+        return;
+    }
+    QFile out(segment.path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        segment.error = tr("Error while creating Table file: %1").arg(segment.path);
+        return;
+    }
+    bool selectAll = plan.hasClause(Types::SelectAll);
+    bool where = plan.hasClause(Types::Where);
+    bool blanks = zoneMap.hasBlanks();
+    Batch batch;
+    ScanCursor cursor;
+    QByteArray buffer;
+    bool more = true;
+    while (more) {
+        more = readBatch(tableFile, segment.ranges, cursor, batch);
+        for (int i = 0; i < batch.size; ++i)
+            TableFile::split(batch.lines.at(i), batch.rows[i]);
+        filterBatch(where ? &segment.filter : nullptr, batch);
+        for (int k = 0; k < batch.kept; ++k) {
+            int i = batch.selection.at(k);
+            const Row &fields = batch.rows.at(i);
+            if (selectAll)
+                buffer.append(batch.lines.at(i));
+            for (qsizetype f = 0; !selectAll && f < plan.projection.size(); ++f) {
+                int p = plan.projection.at(f);
+                if (f) buffer.append('#');
+                if (p < fields.size())
+                    buffer.append(fields.at(p));
+            }
+            buffer.append('\n');
+            if (blanks)
+                for (qsizetype f = 0; f < plan.projection.size(); ++f) {
+                    int p = plan.projection.at(f);
+                    if ((p >= fields.size() || fields.at(p).isEmpty()) && zoneMap.isBlank(batch.rowNumbers.at(i), p))
+                        segment.blanks.append({segment.rows, int(f)});
+                }
+            segment.rows++;
+        }
+        // written a batch at a time, at least segmentBuffer bytes
+        if (buffer.size() >= segmentBuffer || !more) {
+            if (out.write(buffer) != buffer.size()) {
+                segment.error = tr("Error while writing Table file: %1").arg(segment.path);
+                return;
+            }
+            buffer.resize(0);
+        }
+    }
+    segment.scanned = cursor.scanned;
+}
+
+bool Executor::createIntoTable(QFile &newTableFile)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    const QString &newTableName = params.newTableName;
+    newTableFile.setFileName(sysCat->getDbDirPath() + "/" + newTableName + ".txt");
+    if (intoAppend) {
+        if (newTableName == plan.tableName || sysCat->find(newTableName) == sysCat->end()) {
+            error = tr("Table: %1 does not exist.").arg(newTableName);
+            return false;
+        }
+        if (!newTableFile.open(QIODevice::ReadWrite | QIODevice::Text)
+                || !newTableFile.seek(newTableFile.size())) {
+            error = tr("Error while opening Table file: %1").arg(newTableFile.fileName());
+            return false;
+        }
+        intoFrom = newTableFile.size();
+        // dictionaries of the source may have grown since, old codes stay
+        sysCat->setCodec(newTableName, codec.project(plan.projection));
+        return true;
+    }
+    intoFrom = 0;
+    if (newTableName == plan.tableName || sysCat->find(newTableName) != sysCat->end()) {
+        error = tr("Table: %1 already exists.").arg(newTableName);
+        return false;
+    }
+    if (!newTableFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        error = tr("Error while creating Table file: %1").arg(newTableFile.fileName());
+        return false;
+    }
+    // Write schema, projected attributes get consecutive positions
+    for (int i = 0; i < plan.projection.size(); ++i) {
+        SystemCatalog::attrMeta m = plan.meta.at(plan.projection.at(i));
+        m.position = i;
+        sysCat->insertTableMetadata(newTableName, m);
+    }
+    sysCat->writeToSchema(newTableName);
+    // rows are copied encoded, so is the codec
+    sysCat->setCodec(newTableName, codec.project(plan.projection));
+    return true;
+}
+
+bool Executor::buildZoneMap(const QString &newTableName, const QList<QPair<qint64, int>> &blanks)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    QByteArray types;
+    for (int p : plan.projection) types.append(plan.meta.at(p).type);
+    ZoneMap newZoneMap(types);
+    // appended rows extend the zone map of what was there
+    qint64 from = 0;
+    if (intoFrom > 0) {
+        ZoneMap oldZoneMap = sysCat->getZoneMap(newTableName);
+        if (oldZoneMap.isValid(intoFrom)) {
+            newZoneMap = oldZoneMap;
+            from = intoFrom;
+        }
+    }
+    TableFile newTable(sysCat->getDbDirPath() + "/" + newTableName + ".txt");
+    if (!newTable.open(TableFile::Sequential)) {
+        error = newTable.errorString();
+        return false;
+    }
+    newZoneMap.extend(newTable, sysCat->getCodec(newTableName), from);
+    newTable.close();
+    // rebuilt: the blanks of the rows before are lost, they read as NULL
+    qint64 firstRow = newZoneMap.getRowCount() - intoRows;
+    for (const auto& cell : blanks)
+        newZoneMap.markBlank(firstRow + cell.first, cell.second);
+    if (!sysCat->setZoneMap(newTableName, newZoneMap)) {
+        error = tr("Error while writing Zone Map file for: %1").arg(newTableName);
+        return false;
+    }
+    // no text indexes for SELECT INTO tables, drops stale ones
+    sysCat->setTrigramIndex(newTableName, TrigramIndex());
+    sysCat->setInvertedIndex(newTableName, InvertedIndex());
+    return true;
+}
+
+bool Executor::run(RowSink &sink)
+{
+    qint64 started = profile ? clockNanos() : 0;
+    qint64 heapBefore = profile ? heapInUse() : -1;
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    Partitioning partitioning = sysCat->getPartitioning(plan.tableName);
+    if (partitioning.isPartitioned())
+        return runPartitions(sink, partitioning);
+    // a delta is read from the table, the index doesn't have it yet
+    QString index = scanFrom < 0 && !sample.isSampling() ? CoveringIndex::covering(plan) : QString();
+    if (!index.isEmpty())
+        return runIndex(sink, index);
+    TableFile tableFile(sysCat->getDbDirPath() + "/" + plan.tableName + ".txt");
+    if (!open(tableFile, TableFile::Sequential))
+        return false;
+
+    bool selectAll = plan.hasClause(Types::SelectAll);
+    bool where = plan.hasClause(Types::Where);
+    bool into = plan.hasClause(Types::SelectInto);
+
+    QFile newTableFile;
+    if (into && !createIntoTable(newTableFile))
+        return false;
+
+    QStringList headers;
+    for (int p : plan.projection) headers.append(plan.meta.at(p).attributeName);
+    sink.begin(headers);
+
+    QList<int> decoded;                 // indexes in 'fields' of encoded columns
+    for (qsizetype i = 0; i < plan.projection.size(); ++i)
+        if (codec.encoding(plan.projection.at(i)) != TableCodec::Plain)
+            decoded.append(i);
+    decodeBuffers.resize(plan.projection.size());
+
+    static Metrics::Counter &rowsScanned = Metrics::getInstance().counter(
+        "megatron_rows_scanned_total", "Table rows read by query scans");
+    static Metrics::Counter &bytesScanned = Metrics::getInstance().counter(
+        "megatron_scan_bytes_total", "Table file bytes read by query scans");
+    const QList<ScanRange> ranges = scanRanges(tableFile);
+    intoWriters = writerCount(ranges);
+    intoRows = 0;
+    QList<QPair<qint64, int>> newBlanks;
+    IntoPath path = intoPath();
+    if (path != IntoRows) {
+        qint64 scanned = 0;
+        bool ok = path == IntoCopy ? copyInto(tableFile, newTableFile)
+                                   : writeInto(tableFile, ranges, newTableFile, newBlanks, scanned);
+        if (ok && profile) {
+            // no operator to time apart: the whole run goes to Into
+            int sampleEvery = profile->sampleEvery;
+            *profile = QueryProfile();
+            profile->sampleEvery = sampleEvery;
+            describe(*profile, tableFile);
+            OperatorStats &intoOp = profile->operators[QueryProfile::Into];
+            intoOp.rowsIn = intoOp.rowsOut = intoRows;
+            intoOp.bytes = newTableFile.size();
+            intoOp.nanos = clockNanos() - started;
+            profile->operators[QueryProfile::Scan].rowsOut = scanned;
+            profile->nanos = intoOp.nanos;
+            profile->analyzed = true;
+        }
+        tableFile.close();
+        newTableFile.close();
+        sink.end();
+        if (!ok)
+            return false;
+        rowsScanned.add(scanned);
+        if (path == IntoParallel) {
+            for (const auto& range : ranges)
+                bytesScanned.add(range.end - range.begin);
+            if (!buildZoneMap(params.newTableName, newBlanks))
+                return false;
+        }
+        sysCat->bumpTableVersion(params.newTableName);
+        return true;
+    }
+    // '' values of the source rows stay '' in the new table
+    bool intoBlanks = into && zoneMap.hasBlanks();
+    OperatorStats *ops = nullptr;
+    qint64 sampleEvery = 1;
+    if (profile) {
+        sampleEvery = qMax(1, profile->sampleEvery);
+        *profile = QueryProfile();
+        profile->sampleEvery = int(sampleEvery);
+        describe(*profile, tableFile);
+        ops = profile->operators;
+        // before reading, afterwards every page is resident
+        qint64 resident = 0, total = 0, hit = 0, missed = 0;
+        bool known = true;
+        for (const auto& range : ranges) {
+            known = known && tableFile.residency(range.begin, range.end, resident, total);
+            hit += resident;
+            missed += total - resident;
+        }
+        if (known) {
+            profile->pagesHit = hit;
+            profile->pagesMissed = missed;
+        }
+    }
+    // time spent since the previous lap goes to operator 'op'
+    qint64 lapStart = 0;
+    auto lap = [&](int op) {
+        qint64 now = clockNanos();
+        ops[op].nanos += now - lapStart;
+        lapStart = now;
+    };
+
+    Batch batch;
+    ScanCursor cursor;
+    Row fields;
+    QByteArray outLine;
+    qint64 splitRows = 0;
+    qint64 produced = 0;
+    qint64 timed = 0;                   // rows whose output operators were timed
+    bool more = true;
+    while (more) {
+        if (ops) lapStart = clockNanos();
+        more = readBatch(tableFile, ranges, cursor, batch);
+        if (ops) lap(QueryProfile::Scan);
+        for (int i = 0; i < batch.size; ++i)
+            TableFile::split(batch.lines.at(i), batch.rows[i]);
+        splitRows += batch.size;
+        if (ops) lap(QueryProfile::Split);
+        filterBatch(where ? &rowFilter : nullptr, batch);
+        if (ops && where) {
+            lap(QueryProfile::Filter);
+            ops[QueryProfile::Filter].rowsOut += batch.kept;
+        }
+
+        for (int k = 0; k < batch.kept; ++k) {
+            int i = batch.selection.at(k);
+            const Row &dataList = batch.rows.at(i);
+            // only 1 row out of sampleEvery is timed, counts are exact
+            bool timing = ops && produced % sampleEvery == 0;
+            if (timing) {
+                lapStart = clockNanos();
+                timed++;
+            }
+            produced++;
+            fields.clear();
+            for (int p : plan.projection)
+                fields.append(p < dataList.size() ? dataList.at(p) : QByteArrayView());
+            if (into) {
+                // fields are still encoded, as the new table's codec expects
+                if (timing) lap(QueryProfile::Project);
+                if (selectAll) {
+                    newTableFile.write(batch.lines.at(i).data(), batch.lines.at(i).size());
+                }
+                else {
+                    outLine.clear();
+                    for (qsizetype f = 0; f < fields.size(); ++f) {
+                        if (f) outLine.append('#');
+                        outLine.append(fields.at(f));
+                    }
+                    newTableFile.write(outLine);
+                }
+                newTableFile.write("\n", 1);
+                if (intoBlanks)
+                    for (qsizetype f = 0; f < fields.size(); ++f)
+                        if (fields.at(f).isEmpty() && zoneMap.isBlank(batch.rowNumbers.at(i), plan.projection.at(f)))
+                            newBlanks.append({intoRows, int(f)});
+                intoRows++;
+                if (timing) lap(QueryProfile::Into);
+            }
+            for (int d : std::as_const(decoded))
+                fields[d] = codec.decode(plan.projection.at(d), fields.at(d), decodeBuffers[d]);
+            if (timing) lap(QueryProfile::Project);
+            sink.row(fields);
+            if (timing) lap(QueryProfile::Output);
+        }
+    }
+    if (ops) {
+        // extrapolate the sampled times to every row
+        if (sampleEvery > 1 && timed > 0)
+            for (int op : {QueryProfile::Project, QueryProfile::Into, QueryProfile::Output})
+                ops[op].nanos = qint64(double(ops[op].nanos) * produced / timed);
+        lapStart = clockNanos();
+    }
+    sink.end();
+    if (ops) lap(QueryProfile::Output);
+
+    rowsScanned.add(cursor.scanned);
+    for (const auto& range : ranges)
+        bytesScanned.add(range.end - range.begin);
+
+    tableFile.close();
+    if (into) {
+        newTableFile.close();
+        if (!buildZoneMap(params.newTableName, newBlanks))
+            return false;
+        sysCat->bumpTableVersion(params.newTableName);
+    }
+    if (profile) {
+        // rows stopped by the filter were still read, and split unless
+        // a null bitmap dropped them first
+        for (const auto& range : ranges)
+            ops[QueryProfile::Scan].bytes += range.end - range.begin;
+        ops[QueryProfile::Scan].rowsIn = ops[QueryProfile::Scan].rowsOut = cursor.scanned;
+        ops[QueryProfile::Split].rowsIn = ops[QueryProfile::Split].rowsOut = splitRows;
+        ops[QueryProfile::Filter].rowsIn = cursor.scanned;
+        // predicates in the order they ended up, with their measures
+        if (where)
+            ops[QueryProfile::Filter].detail = filterDetail();
+        ops[QueryProfile::Project].rowsIn = ops[QueryProfile::Project].rowsOut = produced;
+        ops[QueryProfile::Output].rowsIn = ops[QueryProfile::Output].rowsOut = produced;
+        if (into) {
+            ops[QueryProfile::Into].rowsIn = ops[QueryProfile::Into].rowsOut = produced;
+            ops[QueryProfile::Into].bytes = newTableFile.size();
+            lap(QueryProfile::Into);            // zone map of the new table
+        }
+        qint64 heapAfter = heapInUse();
+        if (heapBefore >= 0 && heapAfter >= 0)
+            profile->heapBytes = qMax(qint64(0), heapAfter - heapBefore);
+        profile->nanos = clockNanos() - started;
+        profile->analyzed = true;
+    }
+    return true;
+}
+
+namespace {
+
+// Rows of every partition to the one sink, begun and ended once
+class PartitionSink : public RowSink
+{
+public:
+    explicit PartitionSink(RowSink &sink) : sink(sink) {}
+    void row(const Row &fields) override { sink.row(fields); }
+private:
+    RowSink &sink;
+};
+
+// Rows of a partition run on another thread, until their turn comes
+class ResultSetSink : public RowSink
+{
+public:
+    explicit ResultSetSink(ResultSet &results) : results(results) {}
+    void begin(const QStringList &headers) override { results.reset(headers); }
+    void row(const Row &fields) override { results.append(fields); }
+private:
+    ResultSet &results;
+};
+
+// COUNT(*) the bitmaps couldn't answer
+class CountSink : public RowSink
+{
+public:
+    void row(const Row &fields) override { Q_UNUSED(fields) rows++; }
+    qint64 rows = 0;
+};
+
+}
+
+bool Executor::count(qint64 &rows)
+{
+    static Metrics::Counter &bitmapCounts = Metrics::getInstance().counter(
+        "megatron_bitmap_counts_total", "COUNT(*) answered from bitmap cardinalities");
+    rows = 0;
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    // counted, not written anywhere
+    if (plan.hasClause(Types::SelectInto)) {
+        QueryPlan counted = plan;
+        counted.clauses.remove(QChar(char(Types::SelectInto)));
+        Executor executor(counted, params);
+        bool ok = executor.count(rows);
+        error = executor.errorString();
+        return ok;
+    }
+    Partitioning partitioning = sysCat->getPartitioning(plan.tableName);
+    if (partitioning.isPartitioned()) {
+        for (const auto& p : partitionPlans(partitioning)) {
+            Executor partition(p, params);
+            qint64 partitionRows;
+            if (!partition.count(partitionRows)) {
+                error = partition.errorString();
+                return false;
+            }
+            rows += partitionRows;
+        }
+        return true;
+    }
+    TableFile tableFile(sysCat->getDbDirPath() + "/" + plan.tableName + ".txt");
+    if (!open(tableFile, TableFile::Random))
+        return false;
+    if (!plan.hasClause(Types::Where) && !zoneMap.getBlocks().isEmpty()) {
+        rows = zoneMap.getRowCount();
+        return true;
+    }
+    // the bitmaps decided every row: their cardinalities are the count
+    const QList<ScanRange> ranges = scanRanges(tableFile);
+    bool exact = plan.hasClause(Types::Where) && bitmapRows >= 0 && indexRows < 0;
+    for (const auto& r : ranges)
+        exact = exact && !r.filter;
+    tableFile.close();
+    if (exact) {
+        bitmapCounts.add();
+        rows = bitmapRows;
+        return true;
+    }
+    CountSink sink;
+    if (!run(sink))
+        return false;
+    rows = sink.rows;
+    return true;
+}
+
+bool Executor::estimate(SampleEstimate &result)
+{
+    static Metrics::Counter &estimates = Metrics::getInstance().counter(
+        "megatron_sample_estimates_total", "Approximate aggregates answered from a table sample");
+    if (!estimateSample(result))
+        return false;
+    estimates.add();
+    return true;
+}
+
+bool Executor::estimateSample(SampleEstimate &result)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    // SUM and AVG of the selected columns holding numbers
+    QStringList columns;
+    QList<int> positions;
+    for (int p : plan.projection) {
+        if (Clustering::isNumeric(plan.meta.at(p).type)) {
+            columns.append(plan.meta.at(p).attributeName);
+            positions.append(p);
+        }
+    }
+    result = SampleEstimate(sample, columns);
+    Partitioning partitioning = sysCat->getPartitioning(plan.tableName);
+    if (partitioning.isPartitioned()) {
+        for (const auto& p : partitionPlans(partitioning)) {
+            Executor partition(p, params);
+            partition.setSample(sample.forPartition(Partitioning::partitionId(p.tableName)));
+            SampleEstimate partitionEstimate;
+            if (!partition.estimateSample(partitionEstimate)) {
+                error = partition.errorString();
+                return false;
+            }
+            result.merge(partitionEstimate);
+        }
+        return true;
+    }
+    TableFile tableFile(sysCat->getDbDirPath() + "/" + plan.tableName + ".txt");
+    if (!open(tableFile, TableFile::Sequential))
+        return false;
+    const QList<ScanRange> ranges = scanRanges(tableFile);
+    const QList<ZoneMap::Block> &zoneBlocks = zoneMap.getBlocks();
+    bool where = plan.hasClause(Types::Where);
+    bool blockUnits = sample.method == TableSample::Block;
+
+    // rows come in row number order: a unit is done once the next one starts
+    qint64 unit = -1;
+    qint64 unitRows = 0;
+    QList<double> unitSums(positions.size(), 0.0);
+    QList<qint64> unitValues(positions.size(), 0);
+    auto flush = [&]() {
+        if (unitRows > 0)
+            result.addUnit(unitRows, unitSums, unitValues);
+        unitRows = 0;
+        unitSums.fill(0.0);
+        unitValues.fill(0);
+    };
+    qsizetype block = 0;
+    qint64 blockEnd = zoneBlocks.isEmpty() ? 0 : zoneBlocks.first().rows;
+    QByteArray buffer;
+    Batch batch;
+    ScanCursor cursor;
+    bool more = true;
+    while (more) {
+        more = readBatch(tableFile, ranges, cursor, batch);
+        for (int i = 0; i < batch.size; ++i)
+            TableFile::split(batch.lines.at(i), batch.rows[i]);
+        filterBatch(where ? &rowFilter : nullptr, batch);
+        for (int k = 0; k < batch.kept; ++k) {
+            int i = batch.selection.at(k);
+            qint64 row = batch.rowNumbers.at(i);
+            while (blockUnits && row >= blockEnd && block + 1 < zoneBlocks.size())
+                blockEnd += zoneBlocks.at(++block).rows;
+            qint64 u = blockUnits ? block : row;
+            if (u != unit) {
+                flush();
+                unit = u;
+            }
+            unitRows++;
+            const Row &fields = batch.rows.at(i);
+            for (qsizetype c = 0; c < positions.size(); ++c) {
+                int p = positions.at(c);
+                QByteArrayView value = p < fields.size() ? fields.at(p) : QByteArrayView();
+                value = codec.decode(p, value, buffer);
+                // NULL and '': left out of SUM and AVG, not a 0
+                if (value.isEmpty())
+                    continue;
+                unitSums[c] += value.toDouble();
+                unitValues[c]++;
+            }
+        }
+    }
+    flush();
+    result.addScanned(cursor.scanned);
+    tableFile.close();
+    return true;
+}
+
+bool Executor::runIndex(RowSink &sink, const QString &indexName)
+{
+    static Metrics::Counter &indexOnlyScans = Metrics::getInstance().counter(
+        "megatron_index_only_scans_total", "Queries answered from a covering index");
+    indexOnlyScans.add();
+    // Executors only keep a reference to their plan
+    const QueryPlan indexPlan = CoveringIndex::indexPlan(plan, indexName);
+    Executor index(indexPlan, params);
+    index.setIntoOutput(intoOutput);
+    index.setIntoAppend(intoAppend);
+    index.setProfile(profile);
+    index.setAnalyze(analyze);
+    bool ok = index.run(sink);
+    intoRows = index.getIntoRows();
+    if (!ok) {
+        error = index.errorString();
+        return false;
+    }
+    if (profile) {
+        QString &detail = profile->operators[QueryProfile::Scan].detail;
+        detail = tr("%1 index-only, %2").arg(plan.tableName, detail);
+    }
+    return true;
+}
+
+bool Executor::explainIndex(QueryProfile &profile, const QString &indexName)
+{
+    const QueryPlan indexPlan = CoveringIndex::indexPlan(plan, indexName);
+    Executor index(indexPlan, params);
+    index.setIntoOutput(intoOutput);
+    index.setIntoAppend(intoAppend);
+    if (!index.explain(profile)) {
+        error = index.errorString();
+        return false;
+    }
+    QString &detail = profile.operators[QueryProfile::Scan].detail;
+    detail = tr("%1 index-only, %2").arg(plan.tableName, detail);
+    return true;
+}
+
+QList<QueryPlan> Executor::partitionPlans(const Partitioning &partitioning) const
+{
+    // Executors only keep a reference to their plan
+    QList<QueryPlan> plans;
+    for (int id : partitioning.prune(plan, params)) {
+        QueryPlan partitionPlan = plan;
+        partitionPlan.tableName = Partitioning::partitionName(plan.tableName, id);
+        plans.append(partitionPlan);
+    }
+    return plans;
+}
+
+QString Executor::partitionDetail(const Partitioning &partitioning, const QList<QueryPlan> &plans) const
+{
+    QString column = plan.meta.value(partitioning.getPosition()).attributeName;
+    QStringList read;
+    for (const auto& p : plans) {
+        if (read.size() == 4) {
+            read.append("...");
+            break;
+        }
+        read.append(partitioning.describe(Partitioning::partitionId(p.tableName), column));
+    }
+    return tr("%1: %2 of %3 partitions read (%4)").arg(plan.tableName).arg(plans.size())
+        .arg(partitioning.getPartitions().size()).arg(read.join("; "));
+}
+
+bool Executor::explainPartitions(QueryProfile &profile, const Partitioning &partitioning)
+{
+    const QList<QueryPlan> plans = partitionPlans(partitioning);
+    if (plans.isEmpty()) {
+        profile.operators[QueryProfile::Scan].name = tr("Scan");
+    }
+    else {
+        // the others run the same operators over their own files
+        Executor first(plans.first(), params);
+        first.setIntoOutput(intoOutput);
+        first.setSample(sample.forPartition(Partitioning::partitionId(plans.first().tableName)));
+        if (!first.explain(profile)) {
+            error = first.errorString();
+            return false;
+        }
+    }
+    profile.operators[QueryProfile::Scan].detail = partitionDetail(partitioning, plans);
+    return true;
+}
+
+bool Executor::runPartitions(RowSink &sink, const Partitioning &partitioning)
+{
+    static Metrics::Counter &partitionsPruned = Metrics::getInstance().counter(
+        "megatron_partitions_pruned_total", "Table partitions skipped by their WHERE clause");
+    qint64 started = clockNanos();
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    const QList<QueryPlan> plans = partitionPlans(partitioning);
+    partitionsPruned.add(partitioning.getPartitions().size() - plans.size());
+    // catalog caches filled here, the threads below only read them
+    for (const auto& p : plans) {
+        sysCat->getCodec(p.tableName);
+        sysCat->getZoneMap(p.tableName);
+        sysCat->getTrigramIndex(p.tableName);
+        sysCat->getInvertedIndex(p.tableName);
+        sysCat->getBitmapIndex(p.tableName);
+        sysCat->getPartitioning(p.tableName);
+        sysCat->getClustering(p.tableName);
+    }
+    QStringList headers;
+    for (int p : plan.projection) headers.append(plan.meta.at(p).attributeName);
+    sink.begin(headers);
+    PartitionSink partitionSink(sink);
+    intoRows = 0;
+    // the partitions' measures added up
+    QueryProfile total;
+    auto addProfile = [&total](const QueryProfile &partitionProfile) {
+        for (int op = 0; op < QueryProfile::OperatorCount; ++op) {
+            OperatorStats &to = total.operators[op];
+            const OperatorStats &from = partitionProfile.operators[op];
+            if (to.name.isEmpty()) {
+                to.name = from.name;
+                to.detail = from.detail;
+            }
+            to.nanos += from.nanos;
+            to.rowsIn += from.rowsIn;
+            to.rowsOut += from.rowsOut;
+            to.bytes += from.bytes;
+        }
+        total.blocks += partitionProfile.blocks;
+        total.blocksSkipped += partitionProfile.blocksSkipped;
+    };
+    auto finishProfile = [&]() {
+        if (!profile)
+            return;
+        total.operators[QueryProfile::Scan].name = tr("Scan");
+        total.operators[QueryProfile::Scan].detail = partitionDetail(partitioning, plans);
+        total.sampleEvery = profile->sampleEvery;
+        total.analyzed = true;
+        total.nanos = clockNanos() - started;
+        *profile = total;
+    };
+
+    // SELECT INTO fills one table, EXPLAIN ANALYZE times each partition
+    // alone: one partition after the other
+    bool into = plan.hasClause(Types::SelectInto);
+    if (into || analyze) {
+        for (qsizetype i = 0; i < plans.size(); ++i) {
+            Executor partition(plans.at(i), params);
+            partition.setIntoOutput(intoOutput);
+            partition.setIntoAppend(intoAppend || i > 0);
+            partition.setSample(sample.forPartition(Partitioning::partitionId(plans.at(i).tableName)));
+            QueryProfile partitionProfile;
+            if (profile) {
+                partitionProfile.sampleEvery = profile->sampleEvery;
+                partition.setProfile(&partitionProfile);
+                partition.setAnalyze(analyze);
+            }
+            if (!partition.run(partitionSink)) {
+                error = partition.errorString();
+                sink.end();
+                return false;
+            }
+            intoRows += partition.getIntoRows();
+            if (profile)
+                addProfile(partitionProfile);
+        }
+        sink.end();
+        // no partition left, the table still gets created
+        if (into && plans.isEmpty()) {
+            codec = sysCat->getCodec(plan.tableName);
+            QFile newTableFile;
+            if (!createIntoTable(newTableFile))
+                return false;
+            newTableFile.close();
+            if (!buildZoneMap(params.newTableName, {}))
+                return false;
+            sysCat->bumpTableVersion(params.newTableName);
+        }
+        finishProfile();
+        return true;
+    }
+
+    // Waves of as many partitions as cores: the first one streams to the
+    // sink on this thread, the others fill result sets meanwhile. A
+    // profile (slow query log) gets each partition's, added up after the wave
+    qsizetype wave = qMax(1, QThread::idealThreadCount());
+    // the buffered partitions are one query's memory, past it they spill
+    MemoryBudget budget;
+    for (qsizetype first = 0; first < plans.size(); first += wave) {
+        qsizetype count = qMin(wave, plans.size() - first);
+        std::unique_ptr<ResultSet[]> results(new ResultSet[count]);
+        for (qsizetype i = 0; i < count; ++i)
+            results[i].setBudget(&budget);
+        QList<Executor *> partitions;
+        QList<QThread *> threads;
+        std::vector<QString> errors(count);
+        std::vector<QueryProfile> profiles(count);
+        for (qsizetype i = 1; i < count; ++i) {
+            Executor *partition = new Executor(plans.at(first + i), params);
+            partition->setSample(sample.forPartition(Partitioning::partitionId(plans.at(first + i).tableName)));
+            if (profile) {
+                profiles[i].sampleEvery = profile->sampleEvery;
+                partition->setProfile(&profiles[i]);
+            }
+            partitions.append(partition);
+            QThread *thread = QThread::create([partition, &results, &errors, i] {
+                ResultSetSink resultSink(results[i]);
+                if (!partition->run(resultSink))
+                    errors[i] = partition->errorString();
+                else
+                    errors[i] = results[i].errorString();
+            });
+            threads.append(thread);
+            thread->start();
+        }
+        Executor partition(plans.at(first), params);
+        partition.setSample(sample.forPartition(Partitioning::partitionId(plans.at(first).tableName)));
+        if (profile) {
+            profiles[0].sampleEvery = profile->sampleEvery;
+            partition.setProfile(&profiles[0]);
+        }
+        if (!partition.run(partitionSink))
+            errors[0] = partition.errorString();
+        for (QThread *thread : std::as_const(threads))
+            thread->wait();
+        qDeleteAll(threads);
+        qDeleteAll(partitions);
+        for (qsizetype i = 0; profile && i < count; ++i)
+            addProfile(profiles[i]);
+        for (qsizetype i = 0; i < count; ++i) {
+            if (!errors[i].isEmpty()) {
+                error = errors[i];
+                sink.end();
+                return false;
+            }
+            if (i > 0)
+                results[i].replay(partitionSink);
+        }
+    }
+    sink.end();
+    finishProfile();
+    return true;
+}
@@ -0,0 +1,236 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include "queryplan.h"
+#include "columncodec.h"
+#include "tablefile.h"
+#include "zonemap.h"
+#include "rowfilter.h"
+#include "partitioning.h"
+#include "clustering.h"
+#include "sampling.h"
+
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QFile>
+#include <QPair>
+
+// Receives the rows produced by an Executor (QTableWidget, files, caches...)
+class RowSink
+{
+public:
+    virtual ~RowSink() = default;
+    virtual void begin(const QStringList &headers) { Q_UNUSED(headers) }
+    // fields are only valid during the call
+    virtual void row(const Row &fields) = 0;
+    virtual void end() {}
+};
+
+// Drops the rows, a SELECT INTO run for its table only
+class DiscardSink : public RowSink
+{
+public:
+    void row(const Row &fields) override { Q_UNUSED(fields) }
+};
+
+// One operator of an explained plan, the counters are only filled by
+// EXPLAIN ANALYZE (an Executor::run with a profile set)
+struct OperatorStats {
+    QString name;                               // empty: operator not part of the plan
+    QString detail;
+    qint64 nanos = 0;                           // wall time spent in the operator
+    qint64 rowsIn = 0;
+    qint64 rowsOut = 0;
+    qint64 bytes = 0;                           // read from (Scan) / written to (Into) files
+};
+
+struct QueryProfile {
+    // Pipeline order, each operator feeds the next one
+    enum Operator { Scan, Split, Filter, Project, Into, Output, OperatorCount };
+    OperatorStats operators[OperatorCount];
+    // Scan, Split and Filter are timed per batch, the others on 1 row out of
+    // sampleEvery, times extrapolated (cheap enough for every query), rows
+    // and bytes are always exact
+    int sampleEvery = 1;
+    bool analyzed = false;
+    qint64 nanos = 0;                           // whole execution
+    qint64 blocks = 0;                          // zone map blocks of the table, 0 if not used
+    qint64 blocksSkipped = 0;
+    qint64 pagesHit = -1;                       // table file pages found in the page cache,
+    qint64 pagesMissed = -1;                    // -1 if unknown
+    qint64 heapBytes = -1;                      // heap growth during execution, -1 if unknown
+};
+
+// Runs a prepared QueryPlan with its bound parameters, RowFilter::batchRows
+// lines at a time: scan -> split -> WHERE filter -> projection -> (INTO table) -> sink.
+// A SELECT INTO whose rows aren't wanted by the sink skips the pipeline: file
+// copy without WHERE, else parallel writers each filling a segment of the table.
+// A partitioned table runs an Executor per partition the WHERE clause may
+// match, concurrently, their rows reach the sink in partition order. A query
+// a CoveringIndex answers runs over the index instead of the table. With a
+// TableSample only the rows drawn are read, estimate() scales aggregates
+// over them to the whole table
+
+class Executor
+{
+    Q_DECLARE_TR_FUNCTIONS(Executor)
+public:
+    Executor(const QueryPlan &plan, const QueryParams &params);
+    bool run(RowSink &sink);
+    // COUNT(*): rows satisfying the WHERE clause, from the bitmaps alone
+    // when they decide it, else by running the query
+    bool count(qint64 &rows);
+    // Approximate COUNT(*), SUM and AVG of the selected numeric columns
+    // from the sample set with setSample(), with confidence intervals
+    bool estimate(SampleEstimate &estimate);
+    // EXPLAIN: the operators run() would use, nothing is read
+    bool explain(QueryProfile &profile);
+    // run() also times and counts into 'profile'; a SELECT INTO fast path
+    // only gets its total time (slow query log)
+    void setProfile(QueryProfile *profile);
+    // EXPLAIN ANALYZE: every row through the timed pipeline, no fast path
+    void setAnalyze(bool analyze);
+    // SELECT INTO: also send the new table's rows to the sink (default)
+    void setIntoOutput(bool rows);
+    // SELECT INTO: add the rows to an existing table of the same columns
+    void setIntoAppend(bool append);
+    // Only read the lines from byte 'offset' on, 'firstRow' being the row
+    // number of the line there (materialized view deltas)
+    void setScanFrom(qint64 offset, qint64 firstRow);
+    // TABLESAMPLE: only read the rows 'sample' draws, the whole table with None
+    void setSample(const TableSample &sample);
+    // Rows written by the last SELECT INTO
+    qint64 getIntoRows() const;
+    QString errorString() const;
+
+private:
+    const QueryPlan &plan;
+    QueryParams params;
+    QString error;
+    // table file is read encoded, only the rows sent to the sink get decoded
+    TableCodec codec;
+    QList<QByteArray> decodeBuffers;                // one per projected column
+    ZoneMap zoneMap;                                // of the table, empty if not valid
+    TrigramIndex trigramIndex;                      // same
+    InvertedIndex invertedIndex;                    // same
+    BitmapIndex bitmapIndex;                        // same
+    Clustering clustering;                          // of the table, none if its rows moved
+    RowFilter rowFilter;                            // WHERE
+    QueryProfile *profile = nullptr;
+    qint64 blocks = 0;                              // zone map blocks considered by scanRanges()
+    qint64 blocksSkipped = 0;
+    qint64 bitmapRows = -1;                         // rows selected by bitmaps, -1 if not used
+    qint64 indexRows = -1;                          // rows named by the inverted index, same
+    bool clusteredScan = false;                     // blocks narrowed on the clustering key
+    bool analyze = false;
+    bool intoOutput = true;
+    bool intoAppend = false;
+    qint64 intoFrom = 0;                            // size of the INTO table before the rows
+    qint64 intoRows = 0;
+    qint64 scanFrom = -1;                           // -1: the whole table
+    qint64 scanFromRow = 0;
+    TableSample sample;                             // drawn over the zone map's blocks
+    int intoWriters = 1;                            // threads of IntoParallel
+
+    struct ScanRange {
+        qint64 begin = 0;                           // [begin, end) bytes of the table file
+        qint64 end = 0;
+        qint64 firstRow = 0;                        // row number of the line at 'begin'
+        bool filter = true;                         // WHERE evaluated on the rows read
+        QList<quint64> selection;                   // rows to read, bit per line, empty: all
+    };
+    // past 1 row in indexedFraction, reading everything beats seeking
+    static constexpr qint64 indexedFraction = 4;
+    // less than this per writer isn't worth a thread
+    static constexpr qint64 segmentBytes = 8 * 1024 * 1024;
+    static constexpr qsizetype segmentBuffer = 1024 * 1024;
+    // read-ahead window of a scan, doubled each time the scan reaches it
+    static constexpr qint64 readAheadMin = 256 * 1024;
+    static constexpr qint64 readAheadMax = 16 * 1024 * 1024;
+    // ranges closer than this are read ahead as one
+    static constexpr qint64 readAheadGap = 64 * 1024;
+
+    // RowFilter::batchRows lines on their way through the pipeline
+    struct Batch {
+        Batch();
+        QList<QByteArrayView> lines;
+        QList<qint64> rowNumbers;
+        QList<Row> rows;
+        QList<int> selection;                       // indexes of the rows kept, in order
+        QList<bool> filtered;                       // WHERE left to evaluate (not decided by null bitmaps)
+        QList<bool> passed;
+        int size = 0;
+        int kept = 0;
+    };
+    // Where a scan is in its ranges
+    struct ScanCursor {
+        qsizetype nextRange = 0;
+        const ScanRange *range = nullptr;
+        qint64 row = 0;
+        qint64 scanned = 0;                         // lines read, skipped ones included
+        qint64 consumed = 0;                        // bytes of the ranges before 'range'
+        qsizetype aheadRange = 0;                   // read ahead up to this range...
+        qint64 ahead = 0;                           // ...and this offset in it
+        qint64 aheadBytes = 0;                      // of the ranges, read ahead so far
+        qint64 window = readAheadMin;
+    };
+    // SELECT INTO without sink rows, part of the table for one writer thread
+    struct Segment {
+        QString source;                             // table file
+        QString path;                               // written here, then appended to the new table
+        QList<ScanRange> ranges;
+        RowFilter filter;                           // own copy, statistics are per thread
+        qint64 rows = 0;
+        qint64 scanned = 0;
+        QList<QPair<qint64, int>> blanks;           // (row in the segment, column) of '' values
+        QString error;
+    };
+    enum IntoPath {
+        IntoRows,                                   // through the pipeline, rows sent to the sink
+        IntoCopy,                                   // table file and sidecars copied as they are
+        IntoParallel                                // segments written by intoWriters threads
+    };
+
+    // Codec, table file, zone map and WHERE, shared by run() and explain()
+    bool open(TableFile &tableFile, TableFile::Access access);
+    // Parts of the table file worth reading
+    QList<ScanRange> scanRanges(const TableFile &tableFile);
+    // Sorted blocks [first, last) holding the clustering key values the
+    // WHERE clause allows, false if it doesn't bound the key
+    bool clusteredBlocks(const TableFile &tableFile, qsizetype &first, qsizetype &last,
+                         qsizetype &sorted) const;
+    // Next lines of 'ranges' into 'batch', false once they are all read
+    static bool readBatch(TableFile &tableFile, const QList<ScanRange> &ranges,
+                          ScanCursor &cursor, Batch &batch);
+    // Asks for the next window of 'ranges' once the scan is half way
+    // through the previous one, the pages arrive while rows are processed
+    static void readAhead(const TableFile &tableFile, const QList<ScanRange> &ranges,
+                          ScanCursor &cursor);
+    // batch.selection: the rows passing 'filter' (null: all of them)
+    static void filterBatch(RowFilter *filter, Batch &batch);
+    IntoPath intoPath() const;
+    int writerCount(const QList<ScanRange> &ranges) const;
+    bool copyInto(const TableFile &tableFile, QFile &newTableFile);
+    bool writeInto(const TableFile &tableFile, const QList<ScanRange> &ranges, QFile &newTableFile,
+                   QList<QPair<qint64, int>> &blanks, qint64 &scanned);
+    void writeSegment(Segment &segment) const;
+    void describe(QueryProfile &profile, const TableFile &tableFile) const;
+    QString filterDetail() const;
+    bool createIntoTable(QFile &newTableFile);
+    // blanks: (row, column) of the new table's '' values
+    bool buildZoneMap(const QString &newTableName, const QList<QPair<qint64, int>> &blanks);
+    // Index-only scan: the plan run over a covering index
+    bool runIndex(RowSink &sink, const QString &indexName);
+    bool explainIndex(QueryProfile &profile, const QString &indexName);
+    // Partitioned table: an Executor per partition left by prune()
+    bool runPartitions(RowSink &sink, const Partitioning &partitioning);
+    bool explainPartitions(QueryProfile &profile, const Partitioning &partitioning);
+    QList<QueryPlan> partitionPlans(const Partitioning &partitioning) const;
+    // estimate() of the table, or of each partition merged
+    bool estimateSample(SampleEstimate &result);
+    QString partitionDetail(const Partitioning &partitioning, const QList<QueryPlan> &plans) const;
+};
+
+#endif // EXECUTOR_H
@@ -0,0 +1,207 @@
+#include "exportsink.h"
+
+#include <QtEndian>
+
+#include <charconv>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EXPORT_SSE2
+#endif
+
+// ',', '"', '\n' or '\r' in the field, 16 bytes at a time
+static bool needsQuotes(QByteArrayView field)
+{
+    const char *p = field.data();
+    qsizetype n = field.size();
+    qsizetype i = 0;
+#ifdef EXPORT_SSE2
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        __m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, comma), _mm_cmpeq_epi8(block, quote)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(block, newline), _mm_cmpeq_epi8(block, cr)));
+        if (_mm_movemask_epi8(found))
+            return true;
+    }
+#endif
+    for (; i < n; ++i)
+        if (p[i] == ',' || p[i] == '"' || p[i] == '\n' || p[i] == '\r')
+            return true;
+    return false;
+}
+
+template <typename T>
+static void appendLittleEndian(QByteArray &out, T value)
+{
+    T le = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char *>(&le), sizeof(le));
+}
+
+ExportSink::ExportSink(const QString &path, Format format, const QByteArray &types)
+    : file(path)
+    , format(format)
+    , types(types)
+{
+}
+
+bool ExportSink::open()
+{
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        error = tr("Error while creating Export file: %1").arg(file.fileName());
+        return false;
+    }
+    buffer.reserve(bufferBytes + 64 * 1024);
+    return true;
+}
+
+qint64 ExportSink::getRowCount() const
+{
+    return rows;
+}
+
+QString ExportSink::errorString() const
+{
+    return error;
+}
+
+void ExportSink::flush()
+{
+    if (error.isEmpty() && file.write(buffer) != buffer.size())
+        error = tr("Error while writing Export file: %1").arg(file.fileName());
+    buffer.resize(0);
+}
+
+void ExportSink::appendCsv(QByteArrayView field)
+{
+    if (!needsQuotes(field)) {
+        buffer.append(field);
+        return;
+    }
+    buffer.append('"');
+    for (char c : field) {
+        if (c == '"')
+            buffer.append('"');
+        buffer.append(c);
+    }
+    buffer.append('"');
+}
+
+void ExportSink::begin(const QStringList &headers)
+{
+    rows = 0;
+    if (format == Csv) {
+        for (qsizetype i = 0; i < headers.size(); ++i) {
+            if (i) buffer.append(',');
+            appendCsv(headers.at(i).toUtf8());
+        }
+        buffer.append('\n');
+        return;
+    }
+    buffer.append("MTRB", 4);
+    appendLittleEndian(buffer, quint32(1));
+    appendLittleEndian(buffer, quint32(types.size()));
+    for (qsizetype i = 0; i < types.size(); ++i) {
+        QByteArray name = headers.value(i).toUtf8();
+        appendLittleEndian(buffer, quint16(name.size()));
+        buffer.append(name);
+        buffer.append(types.at(i));
+    }
+    columns = QList<Column>(types.size());
+    groupSize = 0;
+}
+
+void ExportSink::appendBinary(qsizetype c, QByteArrayView field)
+{
+    Column &column = columns[c];
+    char type = types.at(c);
+    bool null = field.isEmpty();
+    switch (type) {
+    case 'i': case 't':
+    {
+        qint64 v = 0;
+        auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), v);
+        null = null || ec != std::errc() || end != field.data() + field.size();
+        appendLittleEndian(column.values, null ? qint64(0) : v);
+        break;
+    }
+    case 'f': case 'd':
+    {
+        bool ok = false;
+        double v = null ? 0 : field.toDouble(&ok);
+        null = null || !ok;
+        quint64 bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        appendLittleEndian(column.values, null ? quint64(0) : bits);
+        break;
+    }
+    case 'b':
+    {
+        char first = null ? '\0' : field.front();
+        bool isTrue = first == '1' || first == 't' || first == 'T' || first == 'y' || first == 'Y';
+        bool isFalse = first == '0' || first == 'f' || first == 'F' || first == 'n' || first == 'N';
+        null = null || (!isTrue && !isFalse);
+        column.values.append(char(isTrue ? 1 : 0));
+        break;
+    }
+    default:
+        column.values.append(field);
+        appendLittleEndian(column.ends, quint32(column.values.size()));
+    }
+    qsizetype byte = qsizetype(groupSize / 8);
+    if (column.nulls.size() <= byte)
+        column.nulls.append('\0');
+    if (null)
+        column.nulls[byte] = char(column.nulls.at(byte) | 1 << (groupSize % 8));
+}
+
+void ExportSink::writeGroup()
+{
+    appendLittleEndian(buffer, quint32(groupSize));
+    for (auto& column : columns) {
+        buffer.append(column.nulls);
+        buffer.append(column.ends);
+        buffer.append(column.values);
+        column.nulls.resize(0);
+        column.ends.resize(0);
+        column.values.resize(0);
+        if (buffer.size() >= bufferBytes)
+            flush();
+    }
+    groupSize = 0;
+}
+
+void ExportSink::row(const Row &fields)
+{
+    rows++;
+    if (format == Csv) {
+        for (qsizetype i = 0; i < fields.size(); ++i) {
+            if (i) buffer.append(',');
+            appendCsv(fields.at(i));
+        }
+        buffer.append('\n');
+    }
+    else {
+        for (qsizetype c = 0; c < columns.size(); ++c)
+            appendBinary(c, c < fields.size() ? fields.at(c) : QByteArrayView());
+        if (++groupSize == groupRows)
+            writeGroup();
+    }
+    if (buffer.size() >= bufferBytes)
+        flush();
+}
+
+void ExportSink::end()
+{
+    if (format == Binary) {
+        if (groupSize > 0)
+            writeGroup();
+        appendLittleEndian(buffer, quint32(0));
+    }
+    flush();
+    file.close();
+}
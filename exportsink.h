@@ -0,0 +1,63 @@
+#ifndef EXPORTSINK_H
+#define EXPORTSINK_H
+
+#include "executor.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+
+// Streams an Executor's rows to a file as they come: only a write buffer
+// (CSV) or one group of rows (Binary) is ever held in memory.
+//  - Csv: header line, ',' separated, fields quoted only when they hold
+//    ',', '"' or a line break. Empty values are written unquoted, NULL and
+//    '' alike, as the sink can't tell them apart
+//  - Binary: typed columnar file, little-endian. "MTRB", version, column
+//    count, each column's name and attrMeta type, then groups of up to
+//    groupRows rows, a 0 row group ends the file. Per group and column: a
+//    null bitmap, then the values: i/t int64, f/d double, b uint8, c/v
+//    uint32 end offsets followed by the UTF-8 bytes
+
+class ExportSink : public RowSink
+{
+    Q_DECLARE_TR_FUNCTIONS(ExportSink)
+public:
+    enum Format { Csv, Binary };
+    static constexpr qsizetype groupRows = 64 * 1024;
+
+    // 'types': attrMeta types of the columns of the rows to come
+    ExportSink(const QString &path, Format format, const QByteArray &types);
+    bool open();
+    void begin(const QStringList &headers) override;
+    void row(const Row &fields) override;
+    void end() override;
+    qint64 getRowCount() const;
+    // Not empty if a write failed, the file is then incomplete
+    QString errorString() const;
+
+private:
+    static constexpr qsizetype bufferBytes = 1024 * 1024;
+    struct Column {
+        QByteArray nulls;                   // bit per row of the group
+        QByteArray values;                  // fixed width values, or the strings' bytes
+        QByteArray ends;                    // strings: uint32 end of each value in 'values'
+    };
+    QFile file;
+    Format format;
+    QByteArray types;
+    QByteArray buffer;                      // written once bufferBytes are reached
+    QList<Column> columns;                  // Binary: current group
+    qint64 groupSize = 0;
+    qint64 rows = 0;
+    QString error;
+
+    void appendCsv(QByteArrayView field);
+    void appendBinary(qsizetype column, QByteArrayView field);
+    void writeGroup();
+    void flush();
+};
+
+#endif // EXPORTSINK_H
@@ -0,0 +1,285 @@
+#include "invertedindex.h"
+
+#include <QFile>
+#include <QDataStream>
+#include <algorithm>
+
+static constexpr quint32 magic = 0x4D494E56;           // "MINV"
+static constexpr qint32 formatVersion = 1;
+
+static void putVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+static quint64 getVarint(const uchar *&p)
+{
+    quint64 value = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        value |= quint64(*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    return value | quint64(*p++) << shift;
+}
+
+static bool isTermByte(uchar c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c >= 0x80;
+}
+
+namespace {
+struct Term {
+    QByteArrayView text;
+    bool starts = false;        // a separator precedes it: it begins a term
+    bool ends = false;          // a separator follows it: it ends a term
+};
+}
+
+// Terms of 'value'; for a needle, whether each one is cut by its edges
+static QList<Term> terms(QByteArrayView value)
+{
+    QList<Term> result;
+    const uchar *p = reinterpret_cast<const uchar *>(value.data());
+    qsizetype n = value.size();
+    for (qsizetype i = 0; i < n; ) {
+        if (!isTermByte(p[i])) {
+            i++;
+            continue;
+        }
+        qsizetype first = i;
+        while (i < n && isTermByte(p[i]))
+            i++;
+        result.append({value.sliced(first, i - first), first > 0, i < n});
+    }
+    return result;
+}
+
+void InvertedIndex::addRow(Posting &posting, qint64 row)
+{
+    if (posting.last == row)
+        return;
+    putVarint(posting.deltas, quint64(row - posting.last));
+    posting.last = row;
+    posting.count++;
+}
+
+QList<qint64> InvertedIndex::rowsOf(const Posting &posting)
+{
+    QList<qint64> result;
+    result.reserve(posting.count);
+    const uchar *p = reinterpret_cast<const uchar *>(posting.deltas.constData());
+    qint64 row = -1;
+    for (qint64 i = 0; i < posting.count; ++i) {
+        row += qint64(getVarint(p));
+        result.append(row);
+    }
+    return result;
+}
+
+bool InvertedIndex::isValid(qint64 fileSize) const
+{
+    return !columns.isEmpty() && bytes == fileSize;
+}
+
+bool InvertedIndex::isEmpty() const
+{
+    return columns.isEmpty();
+}
+
+bool InvertedIndex::hasColumn(int position) const
+{
+    for (const auto& c : columns)
+        if (c.position == position)
+            return true;
+    return false;
+}
+
+QList<int> InvertedIndex::getColumns() const
+{
+    QList<int> result;
+    for (const auto& c : columns)
+        result.append(c.position);
+    return result;
+}
+
+qint64 InvertedIndex::getRowCount() const
+{
+    return rows;
+}
+
+void InvertedIndex::extend(TableFile &file, const QList<int> &positions, qint64 from)
+{
+    if (from == 0 || bytes != from) {
+        columns.clear();
+        for (int p : positions) {
+            Column c;
+            c.position = p;
+            columns.append(c);
+        }
+        strideOffsets.clear();
+        strideLengths.clear();
+        lengths.clear();
+        rows = 0;
+        from = 0;
+    }
+    file.seek(from);
+    QByteArrayView line;
+    Row fields;
+    qint64 begin = from;
+    while (file.readLine(line)) {
+        if (rows % offsetStride == 0) {
+            strideOffsets.append(begin);
+            strideLengths.append(lengths.size());
+        }
+        putVarint(lengths, quint64(file.pos() - begin));
+        begin = file.pos();
+        TableFile::split(line, fields);
+        for (auto& c : columns) {
+            if (c.position >= fields.size())
+                continue;
+            for (const Term &t : terms(fields.at(c.position)))
+                addRow(c.terms[t.text.toByteArray()], rows);
+        }
+        rows++;
+    }
+    bytes = file.pos();
+}
+
+bool InvertedIndex::candidates(int position, QByteArrayView needle, QList<qint64> &result) const
+{
+    const Column *column = nullptr;
+    for (const auto& c : columns)
+        if (c.position == position)
+            column = &c;
+    const QList<Term> wanted = terms(needle);
+    if (!column || wanted.isEmpty())
+        return false;
+    // a needle term cut on both sides is a whole term, on the left only
+    // a term prefix ("phrase-prefix"), on the right a suffix, else infix
+    bool first = true;
+    for (const Term &t : wanted) {
+        QList<qint64> rowsOfTerm;
+        if (t.starts && t.ends) {
+            auto it = column->terms.constFind(t.text.toByteArray());
+            if (it != column->terms.cend())
+                rowsOfTerm = rowsOf(it.value());
+        } else {
+            auto it = t.starts ? column->terms.lowerBound(t.text.toByteArray())
+                               : column->terms.cbegin();
+            qsizetype matched = 0;
+            for (; it != column->terms.cend(); ++it) {
+                const QByteArray &term = it.key();
+                bool match;
+                if (t.starts) {
+                    if (!term.startsWith(t.text))
+                        break;
+                    match = true;
+                } else {
+                    match = t.ends ? term.endsWith(t.text) : term.contains(t.text);
+                }
+                if (match) {
+                    rowsOfTerm += rowsOf(it.value());
+                    matched++;
+                }
+            }
+            if (matched > 1) {
+                std::sort(rowsOfTerm.begin(), rowsOfTerm.end());
+                rowsOfTerm.erase(std::unique(rowsOfTerm.begin(), rowsOfTerm.end()), rowsOfTerm.end());
+            }
+        }
+        result = first ? rowsOfTerm : intersect(result, rowsOfTerm);
+        first = false;
+        if (result.isEmpty())
+            break;
+    }
+    return true;
+}
+
+void InvertedIndex::rowSpan(qint64 row, qint64 &begin, qint64 &end) const
+{
+    qsizetype stride = qsizetype(row / offsetStride);
+    begin = strideOffsets.at(stride);
+    const uchar *p = reinterpret_cast<const uchar *>(lengths.constData()) + strideLengths.at(stride);
+    for (qint64 r = stride * offsetStride; r < row; ++r)
+        begin += qint64(getVarint(p));
+    end = begin + qint64(getVarint(p));
+}
+
+QList<qint64> InvertedIndex::intersect(const QList<qint64> &a, const QList<qint64> &b)
+{
+    QList<qint64> result;
+    std::set_intersection(a.cbegin(), a.cend(), b.cbegin(), b.cend(), std::back_inserter(result));
+    return result;
+}
+
+QList<qint64> InvertedIndex::unite(const QList<qint64> &a, const QList<qint64> &b)
+{
+    QList<qint64> result;
+    result.reserve(a.size() + b.size());
+    std::set_union(a.cbegin(), a.cend(), b.cbegin(), b.cend(), std::back_inserter(result));
+    return result;
+}
+
+bool InvertedIndex::read(const QString &path)
+{
+    columns.clear();
+    rows = 0;
+    bytes = -1;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    quint32 m;
+    qint32 version;
+    qint32 count;
+    in >> m >> version;
+    if (m != magic || version != formatVersion)
+        return false;
+    in >> bytes >> rows >> strideOffsets >> strideLengths >> lengths >> count;
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        Column c;
+        qint32 position;
+        qint64 termCount;
+        in >> position >> termCount;
+        c.position = position;
+        for (qint64 t = 0; t < termCount && in.status() == QDataStream::Ok; ++t) {
+            QByteArray term;
+            Posting posting;
+            in >> term >> posting.count >> posting.last >> posting.deltas;
+            c.terms.insert(term, posting);
+        }
+        columns.append(c);
+    }
+    // a truncated file is no index
+    if (in.status() != QDataStream::Ok || columns.size() != count
+            || strideOffsets.size() != (rows + offsetStride - 1) / offsetStride
+            || strideLengths.size() != strideOffsets.size()) {
+        columns.clear();
+        rows = 0;
+        bytes = -1;
+        return false;
+    }
+    return true;
+}
+
+bool InvertedIndex::write(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out << magic << formatVersion << bytes << rows << strideOffsets << strideLengths << lengths
+        << qint32(columns.size());
+    for (const auto& c : columns) {
+        out << qint32(c.position) << qint64(c.terms.size());
+        for (auto it = c.terms.cbegin(); it != c.terms.cend(); ++it)
+            out << it.key() << it.value().count << it.value().last << it.value().deltas;
+    }
+    file.close();
+    return out.status() == QDataStream::Ok;
+}
@@ -0,0 +1,68 @@
+#ifndef INVERTEDINDEX_H
+#define INVERTEDINDEX_H
+
+#include "tablefile.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QMap>
+
+// Terms (runs of ASCII letters/digits and non-ASCII UTF-8 bytes, case
+// kept) of varchar columns, each with the sorted row numbers holding it,
+// delta + varint encoded. Also keeps where every line starts, so Contains
+// can read only the rows its needle's terms point to. Built on load,
+// extended when rows are appended, stored in <table>.inv.
+
+class InvertedIndex
+{
+public:
+    InvertedIndex() = default;
+    // Terms of the lines from 'from' to the end of the file (load, append),
+    // columns at 'positions' when (re)building from the start
+    void extend(TableFile &file, const QList<int> &positions, qint64 from = 0);
+    // Only usable if it covers exactly the current table file
+    bool isValid(qint64 fileSize) const;
+    bool isEmpty() const;
+    bool hasColumn(int position) const;
+    QList<int> getColumns() const;
+    qint64 getRowCount() const;
+
+    // Rows whose value at 'position' may contain 'needle' (a superset,
+    // sorted), false if the needle has no term to look up
+    bool candidates(int position, QByteArrayView needle, QList<qint64> &rows) const;
+    // [begin, end) bytes of a row's line, '\n' included
+    void rowSpan(qint64 row, qint64 &begin, qint64 &end) const;
+
+    static QList<qint64> intersect(const QList<qint64> &a, const QList<qint64> &b);
+    static QList<qint64> unite(const QList<qint64> &a, const QList<qint64> &b);
+
+    // binary, QDataStream: header, line offsets, then per column its terms
+    bool read(const QString &path);
+    bool write(const QString &path) const;
+
+private:
+    // line lengths are summed from the nearest stored offset
+    static constexpr qint64 offsetStride = 128;
+    struct Posting {
+        QByteArray deltas;                  // varint gaps between row numbers
+        qint64 last = -1;                   // last row number added
+        qint64 count = 0;
+    };
+    struct Column {
+        int position = -1;
+        QMap<QByteArray, Posting> terms;    // sorted, for prefix lookups
+    };
+    QList<Column> columns;
+    QList<qint64> strideOffsets;            // first byte of rows 0, offsetStride, 2 * offsetStride...
+    QList<qint64> strideLengths;            // position in 'lengths' of the same rows
+    QByteArray lengths;                     // varint line lengths, '\n' included
+    qint64 rows = 0;
+    qint64 bytes = -1;                      // file size covered, -1: empty index
+
+    static void addRow(Posting &posting, qint64 row);
+    static QList<qint64> rowsOf(const Posting &posting);
+};
+
+#endif // INVERTEDINDEX_H
@@ -0,0 +1,917 @@
+#include "loader.h"
+#include "materializedview.h"
+#include "coveringindex.h"
+#include "memorygovernor.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <queue>
+#include <sstream>
+#include <vector>
+
+Loader::Loader(const QString &relName)
+    : relName(relName)
+{
+}
+
+qint64 Loader::getRowCount() const
+{
+    return rows;
+}
+
+QString Loader::errorString() const
+{
+    return error;
+}
+
+QStringList Loader::parseRecord(const QString &line, QList<int> *blanks)
+{
+    // parse record algorithm
+    std::stringstream inLine(line.toStdString());
+    QStringList values;
+    bool insideQuotes = false;
+    bool quoted = false;                // current field started with '"'
+    QString word;
+    char c;
+    auto appendEmpty = [&]() {
+        if (quoted && blanks)
+            blanks->append(int(values.size()));
+        values.append("");
+        quoted = false;
+    };
+    while (inLine.get(c)) {
+        if (c == ',') {
+            // If no content
+            if (word.isEmpty()) {
+                appendEmpty();
+            }
+            else if (insideQuotes)
+                word+=c;
+            else {
+                values.append(word);
+                word.clear();
+                quoted = false;
+            }
+        }
+        // not so sure about some (unlikely) cases like  ""hello", he said"
+        else if (c == '"') {
+            if (word.isEmpty()) {
+                // second '"' of an empty "" field closes it
+                if (insideQuotes && quoted)
+                    insideQuotes = false;
+                else
+                    insideQuotes = quoted = true;
+            }
+            else {
+                char p = inLine.peek();
+                // If data ends
+                if (p == ',') {
+                    values.append(word);
+                    word.clear();
+                    insideQuotes = quoted = false;
+                    inLine.seekg(1, std::ios_base::cur);
+                }
+                // Then it's a '"' inside commillas
+                else
+                    word+=c;
+            }
+        }
+        else word+=c;
+    }
+    // handle last field
+    if (!word.isEmpty())
+        values.append(word);
+    else if (quoted)
+        appendEmpty();
+    return values;
+}
+
+void Loader::collect(const QStringList &values)
+{
+    for (qsizetype i = 0; i < values.size() && i < stats.size(); ++i) {
+        const QString &v = values.at(i);
+        if (v.isEmpty())
+            continue;
+        ColumnStats &s = stats[i];
+        s.count++;
+        s.bytes += v.size();
+        if (!s.highCardinality) {
+            s.frequencies[v]++;
+            if (s.frequencies.size() > dictionaryLimit) {
+                s.highCardinality = true;
+                s.frequencies.clear();
+            }
+        }
+        if (s.integral) {
+            bool ok;
+            qint64 n = v.toLongLong(&ok);
+            if (ok) {
+                s.min = std::min(s.min, n);
+                s.max = std::max(s.max, n);
+            }
+            else s.integral = false;
+        }
+    }
+}
+
+TableCodec Loader::chooseCodec() const
+{
+    auto digits = [](qint64 n) { return qint64(QString::number(n).size()); };
+    TableCodec codec;
+    for (qsizetype i = 0; i < stats.size() && i < meta.size(); ++i) {
+        const ColumnStats &s = stats.at(i);
+        if (s.count == 0)
+            continue;
+        switch (meta.at(i).type) {
+        // Dictionary: strings repeating a handful of values
+        case 'c': case 'v': case 'b':
+        {
+            if (s.highCardinality || s.frequencies.size() > s.count / 4)
+                break;
+            QList<QPair<qint64, QString>> byFrequency;
+            for (auto it = s.frequencies.cbegin(), end = s.frequencies.cend(); it != end; ++it)
+                byFrequency.append({it.value(), it.key()});
+            std::sort(byFrequency.begin(), byFrequency.end(), [](const auto &a, const auto &b) {
+                return a.first > b.first;
+            });
+            TableCodec::Column column;
+            column.encoding = TableCodec::Dictionary;
+            qint64 encodedBytes = 0;
+            for (qsizetype code = 0; code < byFrequency.size(); ++code) {
+                const QString &value = byFrequency.at(code).second;
+                column.dictionary.append(value);
+                column.codes.insert(value, code);
+                encodedBytes += byFrequency.at(code).first * digits(code) + value.size() + 1;
+            }
+            if (encodedBytes < s.bytes)
+                codec.setColumn(i, column);
+            break;
+        }
+        // FrameOfReference: positive integers sharing their leading digits
+        case 'i': case 't':
+        {
+            if (!s.integral || s.min <= 0 || digits(s.max - s.min) >= digits(s.min))
+                break;
+            TableCodec::Column column;
+            column.encoding = TableCodec::FrameOfReference;
+            column.base = s.min;
+            codec.setColumn(i, column);
+            break;
+        }
+        // bool/tinyint values are already a single character in the table
+        // file, RLE/bit-packing would need a columnar layout
+        }
+    }
+    return codec;
+}
+
+bool Loader::encodeTable(const QString &path, const TableCodec &codec)
+{
+    QFile plainFile(path);
+    QFile encodedFile(path + ".tmp");
+    if (!plainFile.open(QIODevice::ReadOnly | QIODevice::Text) ||
+        !encodedFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        error = tr("Error while encoding Table file: %1").arg(path);
+        return false;
+    }
+    QList<int> encoded;
+    for (qsizetype i = 0; i < meta.size(); ++i)
+        if (codec.encoding(i) != TableCodec::Plain)
+            encoded.append(i);
+    QTextStream in(&plainFile);
+    QTextStream out(&encodedFile);
+    while (!in.atEnd()) {
+        QStringList values = in.readLine().split('#');
+        for (int i : std::as_const(encoded))
+            if (i < values.size())
+                values[i] = codec.encode(i, values.at(i));
+        out << values.join('#') << "\n";
+    }
+    plainFile.close();
+    encodedFile.close();
+    return QFile::remove(path) && QFile::rename(encodedFile.fileName(), path);
+}
+
+bool Loader::load(QTextStream &in)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    meta = sysCat->values(relName);
+    std::reverse(meta.begin(), meta.end());
+    stats = QList<ColumnStats>(meta.size());
+    blankCells.clear();
+    rows = 0;
+
+    // Write dataFile, plain, while gathering column statistics
+    QString path(sysCat->getDbDirPath() + "/" + relName + ".txt");
+    QFile newFile(path);
+    if (!newFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        error = tr("Error while creating Table file: %1").arg(path);
+        return false;
+    }
+    QTextStream dout(&newFile);
+    QList<int> blanks;
+    while (!in.atEnd()) {
+        blanks.clear();
+        QStringList values = parseRecord(in.readLine(), &blanks);
+        if (values.isEmpty())
+            continue;
+        collect(values);
+        // a quoted "" is only an empty string for string columns, NULL otherwise
+        for (int i : std::as_const(blanks))
+            if (i < meta.size() && (meta.at(i).type == 'c' || meta.at(i).type == 'v'))
+                blankCells.append({rows, i});
+        dout << values.join('#') << "\n";
+        rows++;
+    }
+    newFile.close();
+
+    // Re-encode with the chosen column encodings
+    TableCodec codec = chooseCodec();
+    if (!codec.isPlain() && !encodeTable(path, codec)) {
+        if (error.isEmpty())
+            error = tr("Error while encoding Table file: %1").arg(path);
+        return false;
+    }
+    if (!sysCat->setCodec(relName, codec)) {
+        error = tr("Error while writing Codec file for: %1").arg(relName);
+        return false;
+    }
+
+    if (!updateIndexes(relName, codec, 0, rows, blankCells))
+        return false;
+    sysCat->bumpTableVersion(relName);
+    return true;
+}
+
+bool Loader::append(const QString &header, QTextStream &in)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    meta = sysCat->values(relName);
+    std::reverse(meta.begin(), meta.end());
+    blankCells.clear();
+    rows = 0;
+    if (meta.isEmpty()) {
+        error = tr("Relation: %1 doesn't exist.").arg(relName);
+        return false;
+    }
+    // its rows come from its source table
+    if (MaterializedView::isView(relName)) {
+        error = tr("Relation: %1 is a materialized view, append to %2 instead.")
+                    .arg(relName, MaterializedView::sourceOf(relName));
+        return false;
+    }
+    if (CoveringIndex::isIndex(relName)) {
+        error = tr("Relation: %1 is an index, its rows come from its table.").arg(relName);
+        return false;
+    }
+    // same attribute names as parseSchemaPath() took from the first load
+    QStringList names = header.split(",");
+    for (auto& i : names) i.replace('"', QString());
+    QStringList attributes;
+    for (const auto& m : std::as_const(meta)) attributes.append(m.attributeName);
+    if (names != attributes) {
+        error = tr("CSV header doesn't match Relation: %1 (%2)").arg(relName, attributes.join(", "));
+        return false;
+    }
+
+    // New rows, encoded like the table, staged next to it: the table file
+    // is only touched once they are all valid
+    QString path(sysCat->getDbDirPath() + "/" + relName + ".txt");
+    TableCodec codec = sysCat->getCodec(relName);
+    QFile staged(path + ".append");
+    if (!staged.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        error = tr("Error while creating Table file: %1").arg(staged.fileName());
+        return false;
+    }
+    QList<int> encoded;
+    for (qsizetype i = 0; i < meta.size(); ++i)
+        if (codec.encoding(i) != TableCodec::Plain)
+            encoded.append(i);
+    QTextStream dout(&staged);
+    QList<int> blanks;
+    while (!in.atEnd()) {
+        blanks.clear();
+        QStringList values = parseRecord(in.readLine(), &blanks);
+        if (values.isEmpty())
+            continue;
+        for (int i : std::as_const(encoded)) {
+            if (i >= values.size() || values.at(i).isEmpty())
+                continue;
+            if (codec.encoding(i) == TableCodec::Dictionary) {
+                codec.addValue(i, values.at(i));
+            }
+            else {
+                bool ok;
+                values.at(i).toLongLong(&ok);
+                if (!ok) {
+                    error = tr("Value: %1 of %2 doesn't fit the encoding of Relation: %3, "
+                               "load it again instead.").arg(values.at(i), meta.at(i).attributeName, relName);
+                    staged.remove();
+                    return false;
+                }
+            }
+            values[i] = codec.encode(i, values.at(i));
+        }
+        for (int i : std::as_const(blanks))
+            if (i < meta.size() && (meta.at(i).type == 'c' || meta.at(i).type == 'v'))
+                blankCells.append({rows, i});
+        dout << values.join('#') << "\n";
+        rows++;
+    }
+    dout.flush();
+    staged.close();
+
+    // new dictionary codes first, the old rows don't use them
+    if (!sysCat->setCodec(relName, codec)) {
+        error = tr("Error while writing Codec file for: %1").arg(relName);
+        staged.remove();
+        return false;
+    }
+    // partitioned: each row goes to the partition its value picks
+    Partitioning partitioning = sysCat->getPartitioning(relName);
+    if (partitioning.isPartitioned()) {
+        bool distributed = distribute(staged.fileName(), codec, partitioning, blankCells);
+        staged.remove();
+        if (!distributed)
+            return false;
+        sysCat->bumpTableVersion(relName);
+        return true;
+    }
+    QFile tableFile(path);
+    if (!tableFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        error = tr("Error while opening Table file: %1").arg(path);
+        staged.remove();
+        return false;
+    }
+    qint64 from = tableFile.size();
+    bool appended = TableFile::append(tableFile, staged.fileName());
+    tableFile.close();
+    staged.remove();
+    if (!appended) {
+        error = tr("Error while appending to Table file: %1").arg(path);
+        return false;
+    }
+    if (!updateIndexes(relName, codec, from, rows, blankCells))
+        return false;
+    sysCat->bumpTableVersion(relName);
+    // views over the relation only get the new rows
+    QString viewError;
+    if (!MaterializedView::refreshViewsOf(relName, &viewError)) {
+        error = tr("Rows appended to Relation: %1, but %2").arg(relName, viewError);
+        return false;
+    }
+    // indexes too, rows they lack keep them from being used
+    if (!CoveringIndex::refreshIndexesOf(relName, &viewError)) {
+        error = tr("Rows appended to Relation: %1, but %2").arg(relName, viewError);
+        return false;
+    }
+    // clustered: sorted again once the unsorted tail has grown enough
+    return recluster(relName);
+}
+
+bool Loader::partition(const Partitioning &partitioning)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    meta = sysCat->values(relName);
+    std::reverse(meta.begin(), meta.end());
+    rows = 0;
+    if (meta.isEmpty()) {
+        error = tr("Relation: %1 doesn't exist.").arg(relName);
+        return false;
+    }
+    if (sysCat->getPartitioning(relName).isPartitioned()) {
+        error = tr("Relation: %1 is already partitioned.").arg(relName);
+        return false;
+    }
+    // views follow the table file, which is about to be emptied
+    if (MaterializedView::isView(relName) || !MaterializedView::viewsOf(relName).isEmpty()) {
+        error = tr("Relation: %1 has materialized views, it can't be partitioned.").arg(relName);
+        return false;
+    }
+    if (CoveringIndex::isIndex(relName) || !CoveringIndex::indexesOf(relName).isEmpty()) {
+        error = tr("Relation: %1 has indexes, drop them to partition it.").arg(relName);
+        return false;
+    }
+    if (!partitioning.isPartitioned() || partitioning.getPosition() >= meta.size()) {
+        error = tr("Invalid partitioning for Relation: %1").arg(relName);
+        return false;
+    }
+
+    // '' values are only told from NULL by the zone map, they follow their rows
+    QString path(sysCat->getDbDirPath() + "/" + relName + ".txt");
+    TableCodec codec = sysCat->getCodec(relName);
+    ZoneMap zoneMap = sysCat->getZoneMap(relName);
+    QList<QPair<qint64, int>> blanks;
+    if (zoneMap.isValid(QFileInfo(path).size()) && zoneMap.hasBlanks())
+        for (qint64 row = 0; row < zoneMap.getRowCount(); ++row)
+            for (qsizetype i = 0; i < meta.size(); ++i)
+                if (zoneMap.isBlank(row, int(i)))
+                    blanks.append({row, int(i)});
+    Partitioning layout = partitioning;
+    for (int id : partitioning.getPartitions())
+        layout.removePartition(id);
+    if (!distribute(path, codec, layout, blanks))
+        return false;
+
+    // the table's own file stays, empty, with indexes to match
+    QFile tableFile(path);
+    if (!tableFile.resize(0)) {
+        error = tr("Error while emptying Table file: %1").arg(path);
+        return false;
+    }
+    qint64 moved = rows;
+    if (!updateIndexes(relName, codec, 0, 0, {}))
+        return false;
+    rows = moved;
+    // the key stays, for the partitions, the sorted rows went to them
+    Clustering clustering = sysCat->getClustering(relName);
+    if (clustering.isClustered()) {
+        clustering.setSortedRows(0);
+        sysCat->setClustering(relName, clustering);
+    }
+    sysCat->bumpTableVersion(relName);
+    return true;
+}
+
+bool Loader::dropPartition(int id)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    Partitioning partitioning = sysCat->getPartitioning(relName);
+    if (!partitioning.getPartitions().contains(id)) {
+        error = tr("Relation: %1 has no partition %2.").arg(relName).arg(id);
+        return false;
+    }
+    // its rows are gone with its files, nothing else is touched
+    partitioning.removePartition(id);
+    if (!sysCat->setPartitioning(relName, partitioning)) {
+        error = tr("Error while writing Partitioning file for: %1").arg(relName);
+        return false;
+    }
+    if (!sysCat->removeTable(Partitioning::partitionName(relName, id))) {
+        error = tr("Error while removing partition %1 of Relation: %2").arg(id).arg(relName);
+        return false;
+    }
+    sysCat->bumpTableVersion(relName);
+    return true;
+}
+
+bool Loader::cluster(int position)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    meta = sysCat->values(relName);
+    std::reverse(meta.begin(), meta.end());
+    rows = 0;
+    if (meta.isEmpty()) {
+        error = tr("Relation: %1 doesn't exist.").arg(relName);
+        return false;
+    }
+    if (position < 0 || position >= meta.size()) {
+        error = tr("Invalid clustering column for Relation: %1").arg(relName);
+        return false;
+    }
+    // views read their source by byte offset, sorting moves the rows
+    if (!MaterializedView::viewsOf(relName).isEmpty()) {
+        error = tr("Relation: %1 has materialized views, it can't be clustered.").arg(relName);
+        return false;
+    }
+    // an index is sorted on its key
+    if (CoveringIndex::isIndex(relName) && position != 0) {
+        error = tr("Relation: %1 is an index, it stays clustered on its key.").arg(relName);
+        return false;
+    }
+    Partitioning partitioning = sysCat->getPartitioning(relName);
+    if (partitioning.isPartitioned()) {
+        // sorted within each partition, new ones inherit the key
+        for (int id : partitioning.getPartitions()) {
+            Loader partition(Partitioning::partitionName(relName, id));
+            if (!partition.cluster(position)) {
+                error = partition.errorString();
+                return false;
+            }
+            rows += partition.getRowCount();
+        }
+        if (!sysCat->setClustering(relName, Clustering(position))) {
+            error = tr("Error while writing Clustering file for: %1").arg(relName);
+            return false;
+        }
+        return true;
+    }
+    return sortTable(position);
+}
+
+bool Loader::sortTable(int position)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    QString path(sysCat->getDbDirPath() + "/" + relName + ".txt");
+    TableCodec codec = sysCat->getCodec(relName);
+    ZoneMap zoneMap = sysCat->getZoneMap(relName);
+    TableFile file(path);
+    if (!file.open(TableFile::Sequential)) {
+        error = file.errorString();
+        return false;
+    }
+    if (!zoneMap.isValid(file.size()))
+        zoneMap = ZoneMap();
+
+    // keys as the WHERE operators compare them: numbers (empty is 0) or
+    // UTF-8 bytes, dictionary codes decoded
+    bool numeric = Clustering::isNumeric(meta.at(position).type);
+    struct Key {
+        double number = 0;
+        QByteArrayView text;                // views the mapping or the codec, not 'buffer'
+        bool operator<(const Key &other) const
+        {
+            return text.isNull() && other.text.isNull() ? number < other.number : text < other.text;
+        }
+    };
+    auto keyOf = [&](QByteArrayView line, Row &fields, QByteArray &buffer) {
+        TableFile::split(line, fields);
+        QByteArrayView value = codec.decode(position, position < fields.size() ? fields.at(position)
+                                                                                 : QByteArrayView(), buffer);
+        Key key;
+        if (numeric)
+            key.number = Clustering::numericKey(value);
+        else
+            key.text = value.isNull() ? QByteArrayView("", 0) : value;
+        return key;
+    };
+
+    // as many rows sorted at once as the budget holds, else runs merged
+    qint64 total = zoneMap.getBlocks().isEmpty() ? 0 : zoneMap.getRowCount();
+    QByteArrayView line;
+    if (zoneMap.getBlocks().isEmpty() && file.size() > 0) {
+        while (file.readLine(line))
+            total++;
+        file.seek(0);
+    }
+    MemoryBudget budget;
+    const qint64 rowBytes = qint64(sizeof(QByteArrayView) + sizeof(Key) + sizeof(qint64));
+    qint64 runRows = qMax(qint64(1), total);
+    while (!budget.reserve(runRows * rowBytes)) {
+        if (runRows <= minRunRows) {
+            error = tr("Not enough memory to cluster Table: %1").arg(relName);
+            return false;
+        }
+        runRows = qMax(minRunRows, runRows / 2);
+    }
+
+    // written next to the table, then renamed over it
+    QFile sorted(path + ".cluster");
+    if (!sorted.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        error = tr("Error while creating Table file: %1").arg(sorted.fileName());
+        return false;
+    }
+    QList<QPair<qint64, int>> blanks;
+    bool blankRows = zoneMap.hasBlanks();
+    QByteArray out;
+    qint64 written = 0;
+    // 'from': row number of the line in the table
+    auto write = [&](QByteArrayView sortedLine, qint64 from, QIODevice &to, bool last) {
+        out.append(sortedLine.data(), sortedLine.size());
+        out.append('\n');
+        for (qsizetype i = 0; blankRows && &to == &sorted && i < meta.size(); ++i)
+            if (zoneMap.isBlank(from, int(i)))
+                blanks.append({written, int(i)});
+        if (&to == &sorted)
+            written++;
+        if (out.size() >= (1 << 20) || last) {
+            if (to.write(out) != out.size())
+                return false;
+            out.resize(0);
+        }
+        return true;
+    };
+    auto writeError = [&](const QString &fileName) {
+        error = tr("Error while writing Table file: %1").arg(fileName);
+        sorted.remove();
+        return false;
+    };
+
+    QList<QByteArrayView> lines;
+    QList<Key> keys;
+    QList<qint64> order;
+    Row fields;
+    QByteArray buffer;
+    std::vector<std::unique_ptr<QTemporaryFile>> runs;
+    for (qint64 first = 0; ; first += lines.size()) {
+        lines.clear();
+        keys.clear();
+        while (lines.size() < runRows && file.readLine(line)) {
+            lines.append(line);
+            keys.append(keyOf(line, fields, buffer));
+        }
+        order.resize(lines.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&keys](qint64 a, qint64 b) {
+            return keys.at(a) < keys.at(b);
+        });
+        // the only run goes straight to the table
+        if (runs.empty() && file.atEnd()) {
+            for (qsizetype r = 0; r < order.size(); ++r)
+                if (!write(lines.at(order.at(r)), first + order.at(r), sorted, r + 1 == order.size()))
+                    return writeError(sorted.fileName());
+            break;
+        }
+        // "<row> <line>", row numbers of the table for its blanks
+        auto run = std::make_unique<QTemporaryFile>();
+        if (!run->open()) {
+            error = tr("Error while creating a temporary file to cluster Table: %1").arg(relName);
+            sorted.remove();
+            return false;
+        }
+        QByteArray numbered;
+        for (qsizetype r = 0; r < order.size(); ++r) {
+            numbered = QByteArray::number(first + order.at(r)) + ' ';
+            numbered.append(lines.at(order.at(r)));
+            if (!write(numbered, 0, *run, r + 1 == order.size()))
+                return writeError(run->fileName());
+        }
+        run->close();
+        runs.push_back(std::move(run));
+        if (file.atEnd())
+            break;
+    }
+
+    // k-way merge of the runs, ties to the earlier run: still stable
+    if (!runs.empty()) {
+        struct Cursor {
+            std::unique_ptr<TableFile> file;
+            QByteArrayView line;
+            qint64 row = 0;
+            Key key;
+            Row fields;
+            QByteArray buffer;
+        };
+        std::vector<Cursor> cursors(runs.size());
+        auto advance = [&](Cursor &c) {
+            QByteArrayView numbered;
+            if (!c.file->readLine(numbered))
+                return false;
+            qsizetype space = numbered.indexOf(' ');
+            c.row = numbered.first(space).toLongLong();
+            c.line = numbered.sliced(space + 1);
+            c.key = keyOf(c.line, c.fields, c.buffer);
+            return true;
+        };
+        auto later = [&cursors](size_t a, size_t b) {
+            const Key &x = cursors[a].key;
+            const Key &y = cursors[b].key;
+            return y < x || (!(x < y) && a > b);
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+        for (size_t i = 0; i < runs.size(); ++i) {
+            cursors[i].file = std::make_unique<TableFile>(runs[i]->fileName());
+            if (!cursors[i].file->open(TableFile::Sequential)) {
+                error = cursors[i].file->errorString();
+                sorted.remove();
+                return false;
+            }
+            if (advance(cursors[i]))
+                heap.push(i);
+        }
+        while (!heap.empty()) {
+            size_t i = heap.top();
+            heap.pop();
+            Cursor &c = cursors[i];
+            if (!write(c.line, c.row, sorted, false))
+                return writeError(sorted.fileName());
+            if (advance(c))
+                heap.push(i);
+        }
+        if (sorted.write(out) != out.size())
+            return writeError(sorted.fileName());
+        out.resize(0);
+    }
+    sorted.close();
+    file.close();
+    if (!QFile::remove(path) || !sorted.rename(path)) {
+        error = tr("Error while replacing Table file: %1").arg(path);
+        return false;
+    }
+
+    rows = written;
+    if (!updateIndexes(relName, codec, 0, rows, blanks))
+        return false;
+    Clustering clustering(position);
+    clustering.setSortedRows(rows);
+    if (!sysCat->setClustering(relName, clustering)) {
+        error = tr("Error while writing Clustering file for: %1").arg(relName);
+        return false;
+    }
+    sysCat->bumpTableVersion(relName);
+    // indexes track the table by byte offset, the rows moved
+    return CoveringIndex::rebuildIndexesOf(relName, &error);
+}
+
+bool Loader::recluster(const QString &tableName)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    Clustering clustering = sysCat->getClustering(tableName);
+    if (!clustering.needsRecluster(sysCat->getZoneMap(tableName).getRowCount()) ||
+        !MaterializedView::viewsOf(tableName).isEmpty())
+        return true;
+    Loader loader(tableName);
+    if (!loader.cluster(clustering.getPosition())) {
+        error = loader.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool Loader::distribute(const QString &source, const TableCodec &codec, Partitioning &partitioning,
+                        const QList<QPair<qint64, int>> &blanks)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    TableFile file(source);
+    if (!file.open(TableFile::Sequential)) {
+        error = file.errorString();
+        return false;
+    }
+    // lines gathered per partition, written to <partition>.txt.append by MiB
+    struct Part {
+        QByteArray buffer;
+        qint64 rows = 0;
+        QList<QPair<qint64, int>> blanks;
+        bool staged = false;
+    };
+    QList<Part> parts(partitioning.getPartitionCount());
+    auto stagedPath = [&](int id) {
+        return sysCat->getDbDirPath() + "/" + Partitioning::partitionName(relName, id) + ".txt.append";
+    };
+    auto flush = [&](int id) {
+        Part &part = parts[id];
+        QFile staged(stagedPath(id));
+        QIODevice::OpenMode mode = QIODevice::WriteOnly | (part.staged ? QIODevice::Append : QIODevice::Truncate);
+        part.staged = true;
+        bool ok = staged.open(mode) && staged.write(part.buffer) == part.buffer.size();
+        part.buffer.resize(0);
+        return ok;
+    };
+    auto removeStaged = [&]() {
+        for (qsizetype id = 0; id < parts.size(); ++id)
+            if (parts.at(id).staged)
+                QFile::remove(stagedPath(int(id)));
+    };
+    int position = partitioning.getPosition();
+    QByteArrayView line;
+    Row fields;
+    QByteArray buffer;
+    qsizetype blank = 0;
+    qint64 row = 0;
+    while (file.readLine(line)) {
+        TableFile::split(line, fields);
+        QByteArrayView value = position < fields.size() ? fields.at(position) : QByteArrayView();
+        int id = partitioning.partitionOf(codec.decode(position, value, buffer));
+        Part &part = parts[id];
+        for (; blank < blanks.size() && blanks.at(blank).first == row; ++blank)
+            part.blanks.append({part.rows, blanks.at(blank).second});
+        part.buffer.append(line.data(), line.size());
+        part.buffer.append('\n');
+        part.rows++;
+        row++;
+        if (part.buffer.size() >= (1 << 20) && !flush(id)) {
+            error = tr("Error while writing Table file: %1").arg(stagedPath(id));
+            removeStaged();
+            return false;
+        }
+    }
+    file.close();
+
+    // each partition is a relation: columns and codec of the table
+    for (qsizetype i = 0; i < parts.size(); ++i) {
+        int id = int(i);
+        Part &part = parts[id];
+        if (part.rows == 0)
+            continue;
+        if (!part.buffer.isEmpty() && !flush(id)) {
+            error = tr("Error while writing Table file: %1").arg(stagedPath(id));
+            removeStaged();
+            return false;
+        }
+        QString name = Partitioning::partitionName(relName, id);
+        if (sysCat->find(name) == sysCat->end()) {
+            for (const auto& m : std::as_const(meta))
+                sysCat->insertTableMetadata(name, m);
+            sysCat->writeToSchema(name);
+            QFile::remove(sysCat->getDbDirPath() + "/" + name + ".txt");
+            // nothing sorted yet, the first rows get sorted below
+            sysCat->setClustering(name, Clustering(sysCat->getClustering(relName).getPosition()));
+        }
+        partitioning.addPartition(id);
+        QFile tableFile(sysCat->getDbDirPath() + "/" + name + ".txt");
+        if (!tableFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            error = tr("Error while opening Table file: %1").arg(tableFile.fileName());
+            removeStaged();
+            return false;
+        }
+        qint64 from = tableFile.size();
+        bool appended = TableFile::append(tableFile, stagedPath(id));
+        tableFile.close();
+        QFile::remove(stagedPath(id));
+        part.staged = false;
+        if (!appended) {
+            error = tr("Error while appending to Table file: %1").arg(tableFile.fileName());
+            removeStaged();
+            return false;
+        }
+        if (!sysCat->setCodec(name, codec) || !updateIndexes(name, codec, from, part.rows, part.blanks)) {
+            if (error.isEmpty())
+                error = tr("Error while writing Codec file for: %1").arg(name);
+            removeStaged();
+            return false;
+        }
+        sysCat->bumpTableVersion(name);
+        if (!recluster(name)) {
+            removeStaged();
+            return false;
+        }
+    }
+    // dictionaries may have grown, every partition decodes with the same codec
+    for (int id : partitioning.getPartitions())
+        if (parts.value(id).rows == 0)
+            sysCat->setCodec(Partitioning::partitionName(relName, id), codec);
+    if (!sysCat->setPartitioning(relName, partitioning)) {
+        error = tr("Error while writing Partitioning file for: %1").arg(relName);
+        return false;
+    }
+    rows = row;
+    return true;
+}
+
+bool Loader::updateIndexes(const QString &tableName, const TableCodec &codec, qint64 from,
+                          qint64 newRows, const QList<QPair<qint64, int>> &newBlanks)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    QString path(sysCat->getDbDirPath() + "/" + tableName + ".txt");
+    QByteArray types;
+    for (const auto& m : std::as_const(meta)) types.append(m.type);
+    TableFile tableFile(path);
+    if (!tableFile.open(TableFile::Sequential)) {
+        error = tableFile.errorString();
+        return false;
+    }
+    // Zone maps over the final (encoded) file, the last block gets filled up
+    ZoneMap zoneMap = from > 0 ? sysCat->getZoneMap(tableName) : ZoneMap();
+    bool extending = from > 0 && zoneMap.isValid(from);
+    if (!extending)
+        zoneMap = ZoneMap(types);
+    qsizetype blocks = zoneMap.getBlocks().size();
+    qsizetype firstBlock = blocks;
+    qint64 blockOffset = from;
+    if (firstBlock > 0 && zoneMap.getBlocks().last().rows < ZoneMap::rowsPerBlock) {
+        firstBlock--;
+        blockOffset = zoneMap.getBlocks().last().offset;
+    }
+    zoneMap.extend(tableFile, codec, extending ? from : 0);
+    qint64 firstRow = zoneMap.getRowCount() - newRows;
+    for (const auto& cell : newBlanks)
+        zoneMap.markBlank(firstRow + cell.first, cell.second);
+
+    // Trigram signatures of the plain varchar columns, large tables only
+    QList<int> textColumns;
+    for (qsizetype i = 0; i < meta.size(); ++i)
+        if (meta.at(i).type == 'v' && codec.encoding(i) == TableCodec::Plain)
+            textColumns.append(int(i));
+    TrigramIndex trigramIndex = from > 0 ? sysCat->getTrigramIndex(tableName) : TrigramIndex();
+    if (extending && trigramIndex.isValid(from) && trigramIndex.getBlockCount() == blocks)
+        trigramIndex.extend(tableFile, firstBlock, blockOffset);
+    else if (zoneMap.getRowCount() >= TrigramIndex::minRows && !textColumns.isEmpty())
+        trigramIndex.build(tableFile, textColumns);
+    else
+        trigramIndex = TrigramIndex();
+    // Term postings of the same columns, whatever the size
+    InvertedIndex invertedIndex = from > 0 ? sysCat->getInvertedIndex(tableName) : InvertedIndex();
+    if (!textColumns.isEmpty())
+        invertedIndex.extend(tableFile, textColumns, invertedIndex.isValid(from) ? from : 0);
+    // Row bitmaps of the columns with few distinct values, found while
+    // building; a table without any isn't read again on every append
+    BitmapIndex bitmapIndex = from > 0 ? sysCat->getBitmapIndex(tableName) : BitmapIndex();
+    if (from == 0 || bitmapIndex.isValid(from))
+        bitmapIndex.extend(tableFile, int(meta.size()), from);
+    else
+        bitmapIndex = BitmapIndex();
+    tableFile.close();
+
+    if (!sysCat->setZoneMap(tableName, zoneMap)) {
+        error = tr("Error while writing Zone Map file for: %1").arg(tableName);
+        return false;
+    }
+    if (!sysCat->setTrigramIndex(tableName, trigramIndex)) {
+        error = tr("Error while writing Trigram Index file for: %1").arg(tableName);
+        return false;
+    }
+    if (!sysCat->setInvertedIndex(tableName, invertedIndex)) {
+        error = tr("Error while writing Inverted Index file for: %1").arg(tableName);
+        return false;
+    }
+    if (!sysCat->setBitmapIndex(tableName, bitmapIndex)) {
+        error = tr("Error while writing Bitmap Index file for: %1").arg(tableName);
+        return false;
+    }
+    return true;
+}
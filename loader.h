@@ -0,0 +1,93 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "systemcatalog.h"
+#include "columncodec.h"
+#include "tablefile.h"
+#include "zonemap.h"
+#include "trigramindex.h"
+#include "invertedindex.h"
+#include "bitmapindex.h"
+
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QHash>
+#include <QTextStream>
+
+#include <limits>
+
+// Writes the records of a CSV file into an already registered relation's
+// table file, then picks each column's encoding from its attrMeta type and
+// the values observed while loading, and re-encodes the file if worth it.
+// Appending keeps the table's encodings and extends its zone map and
+// indexes, so it costs what the new rows cost.
+
+class Loader
+{
+    Q_DECLARE_TR_FUNCTIONS(Loader)
+public:
+    explicit Loader(const QString &relName);
+    // 'in' is positioned after the CSV header
+    bool load(QTextStream &in);
+    // Adds the records to the relation's table file, 'header' must name
+    // its attributes in order
+    bool append(const QString &header, QTextStream &in);
+    // Moves the rows of the relation into the partitions of 'partitioning',
+    // appends go to them from then on
+    bool partition(const Partitioning &partitioning);
+    // Removes partition 'id' and its rows at once
+    bool dropPartition(int id);
+    // Stores the relation (each partition, if partitioned) sorted on the
+    // column at 'position', and keeps it so as rows get appended
+    bool cluster(int position);
+    qint64 getRowCount() const;
+    QString errorString() const;
+    // Splits a CSV line into its fields, 'blanks' gets the indexes of the
+    // quoted "" fields (empty strings, other empty fields are NULL)
+    static QStringList parseRecord(const QString &line, QList<int> *blanks = nullptr);
+
+private:
+    // Distinct values are only tracked up to this many per column
+    static constexpr int dictionaryLimit = 4096;
+    // a sort whose budget can't hold this many rows gives up
+    static constexpr qint64 minRunRows = 64 * 1024;
+    struct ColumnStats {
+        QHash<QString, qint64> frequencies;     // cleared once over dictionaryLimit
+        bool highCardinality = false;
+        qint64 count = 0;                       // non-empty values
+        qint64 bytes = 0;                       // length of non-empty values
+        bool integral = true;
+        qint64 min = std::numeric_limits<qint64>::max();
+        qint64 max = std::numeric_limits<qint64>::min();
+    };
+
+    QString relName;
+    QList<SystemCatalog::attrMeta> meta;
+    QList<ColumnStats> stats;
+    // (row, column) of the '' values of char/varchar columns
+    QList<QPair<qint64, int>> blankCells;
+    qint64 rows = 0;
+    QString error;
+
+    void collect(const QStringList &values);
+    TableCodec chooseCodec() const;
+    bool encodeTable(const QString &path, const TableCodec &codec);
+    // Appends the (encoded) lines of 'source' to the partitions their
+    // values pick, 'blanks' rows are those of 'source'; partitions a row
+    // needs are created
+    bool distribute(const QString &source, const TableCodec &codec, Partitioning &partitioning,
+                    const QList<QPair<qint64, int>> &blanks);
+    // Rewrites the table file in key order, indexes rebuilt
+    bool sortTable(int position);
+    // Sorts the table again if appends left too much of it unsorted
+    bool recluster(const QString &tableName);
+    // Zone map and indexes over a table file, extended from byte 'from'
+    // (where the 'newRows' start) if the current ones cover exactly that
+    bool updateIndexes(const QString &tableName, const TableCodec &codec, qint64 from,
+                       qint64 newRows, const QList<QPair<qint64, int>> &newBlanks);
+};
+
+#endif // LOADER_H
@@ -0,0 +1,223 @@
+#include "materializedview.h"
+#include "systemcatalog.h"
+#include "executor.h"
+#include "coveringindex.h"
+#include "tablefile.h"
+#include "zonemap.h"
+#include "metrics.h"
+#include "megatron_types.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+QString MaterializedView::definitionPath(const QString &name)
+{
+    return SystemCatalog::getInstance().getDbDirPath() + "/" + name + ".view";
+}
+
+bool MaterializedView::isView(const QString &tableName)
+{
+    return QFile::exists(definitionPath(tableName));
+}
+
+QString MaterializedView::sourceOf(const QString &viewName)
+{
+    Definition view;
+    return read(viewName, view) ? view.spec.tableName : QString();
+}
+
+QStringList MaterializedView::viewsOf(const QString &tableName)
+{
+    QStringList views;
+    QDir dir(SystemCatalog::getInstance().getDbDirPath());
+    for (const auto& file : dir.entryInfoList({"*.view"}, QDir::Files)) {
+        Definition view;
+        if (read(file.completeBaseName(), view) && view.spec.tableName == tableName)
+            views.append(view.name);
+    }
+    return views;
+}
+
+bool MaterializedView::read(const QString &name, Definition &view)
+{
+    QFile file(definitionPath(name));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QJsonObject o = QJsonDocument::fromJson(file.readAll()).object();
+    if (o.isEmpty())
+        return false;
+    view = Definition();
+    view.name = name;
+    for (const auto& a : o["attributes"].toArray())
+        view.spec.attributes.append(a.toString());
+    view.spec.tableName = o["table"].toString();
+    view.spec.into = true;
+    view.params.newTableName = name;
+    const QJsonArray where = o["where"].toArray();
+    view.spec.where = !where.isEmpty();
+    for (const auto& w : where) {
+        QJsonObject c = w.toObject();
+        QuerySpec::Condition condition;
+        condition.field = c["field"].toString();
+        condition.optor = c["operator"].toInt(-1);
+        condition.orPrevious = c["connective"].toString() == "OR";
+        view.spec.conditions.append(condition);
+        QueryParams::Operands operands;
+        operands.condition1 = c["condition1"].toString();
+        operands.condition2 = c["condition2"].toString();
+        view.params.conditions.append(operands);
+    }
+    view.bytes = o["bytes"].toString().toLongLong();
+    view.rows = o["rows"].toString().toLongLong();
+    return !view.spec.tableName.isEmpty();
+}
+
+bool MaterializedView::write(const Definition &view)
+{
+    QJsonObject o;
+    o["attributes"] = QJsonArray::fromStringList(view.spec.attributes);
+    o["table"] = view.spec.tableName;
+    if (view.spec.where) {
+        QJsonArray where;
+        for (qsizetype i = 0; i < view.spec.conditions.size(); ++i) {
+            const QuerySpec::Condition &c = view.spec.conditions.at(i);
+            QueryParams::Operands operands = view.params.conditions.value(i);
+            QJsonObject condition;
+            if (i > 0)
+                condition["connective"] = c.orPrevious ? "OR" : "AND";
+            condition["field"] = c.field;
+            condition["operator"] = c.optor;
+            condition["condition1"] = operands.condition1;
+            if (!operands.condition2.isEmpty())
+                condition["condition2"] = operands.condition2;
+            where.append(condition);
+        }
+        o["where"] = where;
+    }
+    // as strings, JSON numbers are doubles
+    o["bytes"] = QString::number(view.bytes);
+    o["rows"] = QString::number(view.rows);
+    QFile file(definitionPath(view.name));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    QByteArray json = QJsonDocument(o).toJson();
+    return file.write(json) == json.size();
+}
+
+qint64 MaterializedView::rowCount(const QString &tableName, qint64 bytes)
+{
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    ZoneMap zoneMap = sysCat->getZoneMap(tableName);
+    if (zoneMap.isValid(bytes))
+        return zoneMap.getRowCount();
+    TableFile file(sysCat->getDbDirPath() + "/" + tableName + ".txt");
+    if (!file.open(TableFile::Sequential))
+        return 0;
+    qint64 rows = 0;
+    QByteArrayView line;
+    while (file.pos() < bytes && file.readLine(line))
+        rows++;
+    return rows;
+}
+
+bool MaterializedView::create(const QuerySpec &spec, const QueryParams &params, QString *error)
+{
+    QString planError;
+    QueryPlan plan = QueryPlan::prepare(spec, &planError);
+    if (!plan.isValid()) {
+        if (error) *error = planError;
+        return false;
+    }
+    if (!plan.hasClause(Types::SelectInto)) {
+        if (error) *error = tr("A materialized view needs the name of its table (INTO).");
+        return false;
+    }
+    // a view follows the table file, partitions have files of their own
+    if (SystemCatalog::getInstance().getPartitioning(plan.tableName).isPartitioned()) {
+        if (error) *error = tr("Table: %1 is partitioned, views over it aren't supported.").arg(plan.tableName);
+        return false;
+    }
+    // an index gets sorted again, moving the rows the view has seen
+    if (CoveringIndex::isIndex(plan.tableName)) {
+        if (error) *error = tr("Table: %1 is an index, create the view over its table.").arg(plan.tableName);
+        return false;
+    }
+    Definition view;
+    view.name = params.newTableName;
+    view.spec = spec;
+    view.params = params;
+    // what the scan below sees, nothing appends meanwhile
+    view.bytes = QFileInfo(SystemCatalog::getInstance().getDbDirPath() + "/" + plan.tableName + ".txt").size();
+    view.rows = rowCount(plan.tableName, view.bytes);
+
+    Executor executor(plan, params);
+    executor.setIntoOutput(false);
+    DiscardSink sink;
+    if (!executor.run(sink)) {
+        if (error) *error = executor.errorString();
+        return false;
+    }
+    if (!write(view)) {
+        if (error) *error = tr("Error while writing View file: %1").arg(definitionPath(view.name));
+        return false;
+    }
+    return true;
+}
+
+bool MaterializedView::refresh(Definition &view, QString *error)
+{
+    static Metrics::Counter &deltaRows = Metrics::getInstance().counter(
+        "megatron_view_delta_rows_total", "Source rows applied to materialized views");
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    qint64 size = QFileInfo(sysCat->getDbDirPath() + "/" + view.spec.tableName + ".txt").size();
+    if (size == view.bytes)
+        return true;
+    if (size < view.bytes) {
+        if (error) *error = tr("Table: %1 lost rows, create View: %2 again.")
+                                .arg(view.spec.tableName, view.name);
+        return false;
+    }
+    QString planError;
+    QueryPlan plan = QueryPlan::prepare(view.spec, &planError);
+    if (!plan.isValid()) {
+        if (error) *error = planError;
+        return false;
+    }
+    // only the delta: lines from where the last refresh stopped
+    Executor executor(plan, view.params);
+    executor.setIntoOutput(false);
+    executor.setIntoAppend(true);
+    executor.setScanFrom(view.bytes, view.rows);
+    DiscardSink sink;
+    if (!executor.run(sink)) {
+        if (error) *error = executor.errorString();
+        return false;
+    }
+    qint64 rows = rowCount(view.spec.tableName, size);
+    deltaRows.add(rows - view.rows);
+    view.bytes = size;
+    view.rows = rows;
+    if (!write(view)) {
+        if (error) *error = tr("Error while writing View file: %1").arg(definitionPath(view.name));
+        return false;
+    }
+    return true;
+}
+
+bool MaterializedView::refreshViewsOf(const QString &tableName, QString *error)
+{
+    for (const auto& name : viewsOf(tableName)) {
+        Definition view;
+        if (!read(name, view)) {
+            if (error) *error = tr("Error while reading View file: %1").arg(definitionPath(name));
+            return false;
+        }
+        if (!refresh(view, error) || !refreshViewsOf(view.name, error))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef MATERIALIZEDVIEW_H
+#define MATERIALIZEDVIEW_H
+
+#include "queryplan.h"
+
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+
+// CREATE MATERIALIZED VIEW: a SELECT [INTO] whose new table stays in step
+// with its source table. The rows live in a regular relation of the
+// SystemCatalog, so reading the view costs what reading that table costs;
+// <view>.view keeps the query and how much of the source (bytes, rows) it
+// has seen. Rows appended to the source are filtered and projected on
+// their own and appended to the view, the rest is never read again.
+
+class MaterializedView
+{
+    Q_DECLARE_TR_FUNCTIONS(MaterializedView)
+public:
+    // Runs the query into the new table 'params.newTableName' and records it
+    static bool create(const QuerySpec &spec, const QueryParams &params, QString *error = nullptr);
+    // Brings the views reading 'tableName' (and views of those) up to date
+    static bool refreshViewsOf(const QString &tableName, QString *error = nullptr);
+    static bool isView(const QString &tableName);
+    // Table the view reads, empty if 'viewName' isn't one
+    static QString sourceOf(const QString &viewName);
+    // Names of the views reading 'tableName'
+    static QStringList viewsOf(const QString &tableName);
+    // Rows in the first 'bytes' of the table
+    static qint64 rowCount(const QString &tableName, qint64 bytes);
+
+private:
+    struct Definition {
+        QString name;
+        QuerySpec spec;
+        QueryParams params;
+        qint64 bytes = 0;                       // of the source table already in the view
+        qint64 rows = 0;
+    };
+
+    static QString definitionPath(const QString &name);
+    static bool read(const QString &name, Definition &view);
+    static bool write(const Definition &view);
+    static bool refresh(Definition &view, QString *error);
+};
+
+#endif // MATERIALIZEDVIEW_H
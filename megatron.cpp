@@ -2,14 +2,21 @@
 #include "./ui_megatron.h"
 #include "opentable.h"
 #include "queryform.h"
+#include "resultcache.h"
+#include "memorygovernor.h"
+#include "loader.h"
+#include "coveringindex.h"
+#include "metrics.h"
+#include "metricsdialog.h"
+#include "slowquerylog.h"
 
 #include <QDebug>
 #include <QScrollArea>
 #include <QTabWidget>
 #include <QInputDialog>
 #include <QTimer>
-
-#include <sstream>
+#include <QMenu>
+#include <QRegularExpression>
 
 // bool is_empty(std::ifstream& pFile);
 
@@ -153,14 +160,187 @@ void Megatron::handleOpenMessage(bool ret)
 void Megatron::loadTableTree()
 {
     tableTreeWidget->clear();
-    QSet<QString> tableNames = sysCat->getTableNames();
+    const QSet<QString> relations = sysCat->getTableNames();
+    QSet<QString> tableNames = relations;
+    // partitions and indexes are listed under their table
+    for (const auto& name : relations) {
+        Partitioning partitioning = sysCat->getPartitioning(name);
+        for (int id : partitioning.getPartitions())
+            tableNames.remove(Partitioning::partitionName(name, id));
+        if (CoveringIndex::isIndex(name))
+            tableNames.remove(name);
+    }
     for (auto i = tableNames.cbegin(), end = tableNames.cend(); i != end; ++i) {
         QTreeWidgetItem *item = new QTreeWidgetItem(tableTreeWidget);
         QFont font;
         font.setPointSize(11);
         item->setFont(0, font);
         item->setText(0, *i);
+        QList<SystemCatalog::attrMeta> meta = sysCat->values(*i);
+        Clustering clustering = sysCat->getClustering(*i);
+        Partitioning partitioning = sysCat->getPartitioning(*i);
+        QString clusterColumn, column;
+        for (const auto& m : std::as_const(meta)) {
+            if (m.position == clustering.getPosition())
+                clusterColumn = m.attributeName;
+            if (m.position == partitioning.getPosition())
+                column = m.attributeName;
+        }
+        QStringList toolTip;
+        if (partitioning.isPartitioned())
+            toolTip.append(partitioning.toString(column));
+        if (clustering.isClustered())
+            toolTip.append(tr("CLUSTERED ON (%1)").arg(clusterColumn));
+        item->setToolTip(0, toolTip.join("\n"));
+        for (const auto& index : CoveringIndex::indexesOf(*i)) {
+            QTreeWidgetItem *child = new QTreeWidgetItem(item);
+            child->setText(0, tr("index: %1").arg(CoveringIndex::describe(index)));
+            child->setData(0, Qt::UserRole + 1, index);
+        }
+        if (!partitioning.isPartitioned())
+            continue;
+        for (int id : partitioning.getPartitions()) {
+            QTreeWidgetItem *child = new QTreeWidgetItem(item);
+            child->setText(0, QString("p%1: %2").arg(id).arg(partitioning.describe(id, column)));
+            child->setData(0, Qt::UserRole, id);
+        }
+    }
+}
+
+void Megatron::showTableMenu(const QPoint &pos)
+{
+    QTreeWidgetItem *item = tableTreeWidget->itemAt(pos);
+    if (!item)
+        return;
+    QMenu menu(this);
+    QString indexName = item->data(0, Qt::UserRole + 1).toString();
+    if (!indexName.isEmpty()) {
+        menu.addAction(tr("Drop Index"), this, [this, indexName]() {
+            QString error;
+            if (!CoveringIndex::drop(indexName, &error)) {
+                statusBar()->showMessage(error);
+                return;
+            }
+            statusBar()->showMessage(tr("Dropped Index: %1.").arg(indexName));
+            loadTableTree();
+        });
+    }
+    else if (item->parent()) {
+        // a partition: its rows go at once
+        QString relName = item->parent()->text(0);
+        int id = item->data(0, Qt::UserRole).toInt();
+        menu.addAction(tr("Drop Partition"), this, [this, relName, id]() {
+            if (QMessageBox::question(this, tr("Drop Partition"),
+                    tr("Delete partition %1 of Relation: %2 and its rows?").arg(id).arg(relName))
+                != QMessageBox::Yes)
+                return;
+            Loader loader(relName);
+            if (!loader.dropPartition(id)) {
+                statusBar()->showMessage(loader.errorString());
+                return;
+            }
+            statusBar()->showMessage(tr("Dropped partition %1 of Relation: %2.").arg(id).arg(relName));
+            loadTableTree();
+        });
+    }
+    else {
+        QString relName = item->text(0);
+        if (!sysCat->getPartitioning(relName).isPartitioned())
+            menu.addAction(tr("Partition..."), this, [this, relName]() { partitionRelation(relName); });
+        menu.addAction(tr("Cluster..."), this, [this, relName]() { clusterRelation(relName); });
+        menu.addAction(tr("Create Index..."), this, [this, relName]() { indexRelation(relName); });
+    }
+    if (!menu.isEmpty())
+        menu.exec(tableTreeWidget->viewport()->mapToGlobal(pos));
+}
+
+void Megatron::partitionRelation(const QString &relName)
+{
+    QList<SystemCatalog::attrMeta> meta = sysCat->values(relName);
+    std::reverse(meta.begin(), meta.end());
+    QStringList columns;
+    QByteArray types;
+    for (const auto& m : std::as_const(meta)) {
+        columns.append(m.attributeName);
+        types.append(m.type);
+    }
+    bool ok;
+    QString clause = QInputDialog::getText(this, tr("Partition Relation: %1").arg(relName),
+        tr("RANGE (column) bound, bound...  or  HASH (column) buckets\nColumns: %1")
+            .arg(columns.join(", ")), QLineEdit::Normal, "", &ok);
+    if (!ok || clause.isEmpty())
+        return;
+    QString error;
+    Partitioning partitioning = Partitioning::parse(clause, columns, types, &error);
+    if (!partitioning.isPartitioned()) {
+        statusBar()->showMessage(error);
+        return;
+    }
+    Loader loader(relName);
+    if (!loader.partition(partitioning)) {
+        statusBar()->showMessage(loader.errorString());
+        return;
+    }
+    statusBar()->showMessage(tr("Partitioned Relation: %1, %2 records moved.")
+                             .arg(relName).arg(loader.getRowCount()));
+    loadTableTree();
+}
+
+void Megatron::clusterRelation(const QString &relName)
+{
+    QList<SystemCatalog::attrMeta> meta = sysCat->values(relName);
+    std::reverse(meta.begin(), meta.end());
+    QStringList columns;
+    for (const auto& m : std::as_const(meta))
+        columns.append(m.attributeName);
+    // the current key first, choosing it again sorts the appended rows
+    Clustering clustering = sysCat->getClustering(relName);
+    bool ok;
+    QString column = QInputDialog::getItem(this, tr("Cluster Relation: %1").arg(relName),
+        tr("Store the records sorted on:"), columns, qMax(0, clustering.getPosition()), false, &ok);
+    if (!ok)
+        return;
+    Loader loader(relName);
+    if (!loader.cluster(int(columns.indexOf(column)))) {
+        statusBar()->showMessage(loader.errorString());
+        return;
+    }
+    statusBar()->showMessage(tr("Clustered Relation: %1 on %2, %3 records sorted.")
+                             .arg(relName, column).arg(loader.getRowCount()));
+    loadTableTree();
+}
+
+void Megatron::indexRelation(const QString &relName)
+{
+    QList<SystemCatalog::attrMeta> meta = sysCat->values(relName);
+    std::reverse(meta.begin(), meta.end());
+    QStringList columns;
+    for (const auto& m : std::as_const(meta))
+        columns.append(m.attributeName);
+    bool ok;
+    QString definition = QInputDialog::getText(this, tr("Create Index on Relation: %1").arg(relName),
+        tr("key  or  key INCLUDE (column, column...)\nColumns: %1").arg(columns.join(", ")),
+        QLineEdit::Normal, "", &ok);
+    if (!ok || definition.isEmpty())
+        return;
+    static const QRegularExpression syntax(
+        R"(^\s*(\S+)\s*(?:INCLUDE\s*\(([^)]*)\))?\s*$)", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch match = syntax.match(definition);
+    if (!match.hasMatch()) {
+        statusBar()->showMessage(tr("Expected key or key INCLUDE (column, column...)."));
+        return;
     }
+    QStringList include;
+    for (const auto& c : match.captured(2).split(',', Qt::SkipEmptyParts))
+        include.append(c.trimmed());
+    QString error;
+    if (!CoveringIndex::create(relName, match.captured(1), include, &error)) {
+        statusBar()->showMessage(error);
+        return;
+    }
+    statusBar()->showMessage(tr("Created Index: %1.")
+                             .arg(CoveringIndex::indexName(relName, match.captured(1))));
+    loadTableTree();
 }
 
 // bool is_empty(std::ifstream& pFile)
@@ -187,14 +367,16 @@ void Megatron::createRelation(const QString &dt, const QString &sch)
     };
     if (duplicateTable(tableTreeWidget, relName))
     {
+        // daily feeds of the same relation: append instead of reloading
         QMessageBox msgBox;
-        msgBox.setIcon(QMessageBox::Warning);
-        msgBox.setText("Error");
-        msgBox.setInformativeText(tr("Relation: %1 already exists. "
-                                     "Change filename and try again.").arg(relName));
-        msgBox.setStandardButtons(QMessageBox::Ok);
-        msgBox.setDefaultButton(QMessageBox::Ok);
-        msgBox.exec();
+        msgBox.setIcon(QMessageBox::Question);
+        msgBox.setText(tr("Relation: %1 already exists.").arg(relName));
+        msgBox.setInformativeText(tr("Append the records of this file to it? "
+                                     "Otherwise change filename and try again."));
+        msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+        msgBox.setDefaultButton(QMessageBox::No);
+        if (msgBox.exec() == QMessageBox::Yes)
+            appendRelation(relName, dt);
         return;
     }
 
@@ -231,65 +413,28 @@ void Megatron::createRelation(const QString &dt, const QString &sch)
     }
 
     // Write dataFile after saving its schema
-    QFile newFile(dbDir.filePath(relName + ".txt"));
-    newFile.open(QIODevice::WriteOnly | QIODevice::Text);
-    QTextStream dout(&newFile);
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        // parse record algorithm
-        std::stringstream inLine(line.toStdString());
-        QStringList values;
-        bool insideQuotes = false;
-        QString word;
-        char c;
-        while (inLine.get(c)) {
-            // qDebug() << word;
-            if (c == ',') {
-                // If no content
-                if (word.isEmpty()) {
-                    // qDebug() << "Nan";
-                    values.append("");
-                }
-                else if (insideQuotes)
-                    word+=c;
-                else {
-                    values.append(word);
-                    word.clear();
-                }
-            }
-            // not so sure about some (unlikely) cases like  ""hello", he said"
-            else if (c == '"') {
-                if (word.isEmpty())
-                    insideQuotes = true;
-                else {
-                    char p = inLine.peek();
-                    // If data ends
-                    if (p == ',') {
-                        values.append(word);
-                        word.clear();
-                        insideQuotes = false;
-                        inLine.seekg(1, std::ios_base::cur);
-                    }
-                    // Then it's a '"' inside commillas
-                    else
-                        word+=c;
-                }
-            }
-            else word+=c;
-        }
-        // handle last field
-        if (!word.isEmpty())
-            values.append(word);
-
-        for (qsizetype i = 0; i < values.size(); ++i) {
-            const auto &w = values.at(i);
-            if (i == values.size() - 1)
-                dout << w << Qt::endl;
-            else dout << w << "#";
-        }
+    static Metrics::Histogram &loadLatency = Metrics::getInstance().histogram(
+        "megatron_csv_load_duration_seconds", "Time to load a CSV file into a new relation");
+    static Metrics::Counter &bytesLoaded = Metrics::getInstance().counter(
+        "megatron_csv_bytes_loaded_total", "Bytes of CSV files loaded into relations");
+    static Metrics::Counter &rowsLoaded = Metrics::getInstance().counter(
+        "megatron_csv_rows_loaded_total", "Records of CSV files loaded into relations");
+    static Metrics::Counter &loadErrors = Metrics::getInstance().counter(
+        "megatron_csv_load_errors_total", "CSV files that failed to load");
+    Loader loader(relName);
+    bool loaded;
+    {
+        Metrics::Timer timer(loadLatency);
+        loaded = loader.load(in);
     }
     newData.close();
-    newFile.close();
+    if (!loaded) {
+        loadErrors.add();
+        statusBar()->showMessage(loader.errorString());
+        return;
+    }
+    bytesLoaded.add(dataInfo.size());
+    rowsLoaded.add(loader.getRowCount());
 
     statusBar()->showMessage(tr("Loaded Relation: %1 successfully.").arg(relName));
     // add new relationForm Widget to tree
@@ -298,6 +443,43 @@ void Megatron::createRelation(const QString &dt, const QString &sch)
     loadTableTree();
 }
 
+void Megatron::appendRelation(const QString &relName, const QString &dt)
+{
+    QFile newData(dt);
+    if (!newData.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        statusBar()->showMessage(tr("Error while opening Data file: %1").arg(dt));
+        return;
+    }
+    QTextStream in(&newData);
+    QString header = in.readLine();
+
+    static Metrics::Histogram &appendLatency = Metrics::getInstance().histogram(
+        "megatron_csv_append_duration_seconds", "Time to append a CSV file to an existing relation");
+    static Metrics::Counter &bytesLoaded = Metrics::getInstance().counter(
+        "megatron_csv_bytes_loaded_total", "Bytes of CSV files loaded into relations");
+    static Metrics::Counter &rowsLoaded = Metrics::getInstance().counter(
+        "megatron_csv_rows_loaded_total", "Records of CSV files loaded into relations");
+    static Metrics::Counter &loadErrors = Metrics::getInstance().counter(
+        "megatron_csv_load_errors_total", "CSV files that failed to load");
+    Loader loader(relName);
+    bool appended;
+    {
+        Metrics::Timer timer(appendLatency);
+        appended = loader.append(header, in);
+    }
+    newData.close();
+    if (!appended) {
+        loadErrors.add();
+        statusBar()->showMessage(loader.errorString());
+        return;
+    }
+    bytesLoaded.add(newData.size());
+    rowsLoaded.add(loader.getRowCount());
+    statusBar()->showMessage(tr("Appended %1 records to Relation: %2 successfully.")
+                             .arg(loader.getRowCount()).arg(relName));
+    loadTableTree();
+}
+
 void Megatron::createRelation()
 {
     qDebug() << "Display table to fill in attributes, then add new relationForm Widget to tree, "
@@ -359,6 +541,9 @@ void Megatron::createActions()
     ui->actionNewTable->setShortcut(QKeySequence::New);
     connect(ui->actionNewTable, &QAction::triggered, this, [this](){ createRelation(); });
 
+    tableTreeWidget->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(tableTreeWidget, &QTreeWidget::customContextMenuRequested, this, &Megatron::showTableMenu);
+
     connect(tabWidget, &QTabWidget::tabCloseRequested, this, &Megatron::deleteTabRequested);
     connect(this, &Megatron::messageVisible, this, &Megatron::handleOpenMessage);
 
@@ -372,6 +557,53 @@ void Megatron::createActions()
 
     ui->actionRunSelected->setShortcut(tr("Ctrl+R"));
     ui->actionRunSelected->setEnabled(false);
+
+    connect(ui->actionMetrics, &QAction::triggered, this, [this]() {
+        MetricsDialog dialog(this);
+        dialog.exec();
+    });
+    // Periodic export for a scraper (e.g. node_exporter textfile collector)
+    QString metricsFile = qEnvironmentVariable("MEGATRON_METRICS_FILE");
+    if (!metricsFile.isEmpty()) {
+        QTimer *metricsTimer = new QTimer(this);
+        connect(metricsTimer, &QTimer::timeout, this, [metricsFile]() {
+            Metrics::getInstance().writePrometheus(metricsFile);
+        });
+        metricsTimer->start(15000);
+    }
+
+    connect(ui->actionSlowQueryLog, &QAction::triggered, this, [this]() {
+        SlowQueryLog &slowLog = SlowQueryLog::getInstance();
+        bool ok;
+        int ms = QInputDialog::getInt(this, tr("Slow Query Log"),
+            tr("Log queries slower than (ms), -1 disables:\n%1").arg(slowLog.getPath()),
+            int(slowLog.getThreshold()), -1, 3600000, 100, &ok);
+        if (ok)
+            slowLog.setThreshold(ms);
+    });
+
+    connect(ui->actionMemoryBudget, &QAction::triggered, this, [this]() {
+        MemoryGovernor &governor = MemoryGovernor::getInstance();
+        const qint64 mib = 1024 * 1024;
+        bool ok;
+        int query = QInputDialog::getInt(this, tr("Memory Budget"),
+            tr("Memory of one query (MiB), past it results and sorts spill to disk:"),
+            int(governor.getQueryLimit() / mib), 1, 1024 * 1024, 64, &ok);
+        if (!ok)
+            return;
+        int engine = QInputDialog::getInt(this, tr("Memory Budget"),
+            tr("Memory of every query together (MiB), %1 MiB in use:").arg(governor.getUsed() / mib),
+            int(qMax(governor.getLimit(), query * mib) / mib), query, 1024 * 1024, 64, &ok);
+        if (!ok)
+            return;
+        governor.setQueryLimit(query * mib);
+        governor.setLimit(engine * mib);
+    });
+
+    ui->actionResultCache->setChecked(ResultCache::getInstance().isEnabled());
+    connect(ui->actionResultCache, &QAction::toggled, this, [](bool checked) {
+        ResultCache::getInstance().setEnabled(checked);
+    });
 }
 
 void Megatron::updateActions()
@@ -34,6 +34,8 @@ private slots:
     QWidget* createOpenMessage(QWidget *);
     void handleOpenMessage(bool);
     void loadTableTree();
+    // Partition / Cluster / Create Index / Drop ... on the relation tree
+    void showTableMenu(const QPoint &pos);
     void createRelation(const QString &, const QString &);   // Using file
     void createRelation();                                   // From scratch
     void createQuery();
@@ -49,6 +51,14 @@ private:
 
     void createActions();
     void updateActions();
+    // Records of a CSV file added to an existing relation (same header)
+    void appendRelation(const QString &relName, const QString &dataFile);
+    // Moves a relation's records into the partitions of a RANGE/HASH clause
+    void partitionRelation(const QString &relName);
+    // Stores a relation's records sorted on the chosen column
+    void clusterRelation(const QString &relName);
+    // Covering index on a key column, INCLUDE (columns) optional
+    void indexRelation(const QString &relName);
     // friend bool is_empty(std::fstream &);
 };
 #endif // MEGATRON_H
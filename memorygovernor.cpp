@@ -0,0 +1,96 @@
+#include "memorygovernor.h"
+#include "metrics.h"
+
+bool MemoryGovernor::reserve(qint64 bytes)
+{
+    static Metrics::Counter &refusals = Metrics::getInstance().counter(
+        "megatron_memory_refusals_total", "Memory reservations refused, operators spilled instead");
+    qint64 current = used.load(std::memory_order_relaxed);
+    do {
+        if (current + bytes > limit.load(std::memory_order_relaxed)) {
+            refusals.add();
+            return false;
+        }
+    } while (!used.compare_exchange_weak(current, current + bytes, std::memory_order_relaxed));
+    return true;
+}
+
+void MemoryGovernor::release(qint64 bytes)
+{
+    used.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+qint64 MemoryGovernor::getUsed() const
+{
+    return used.load(std::memory_order_relaxed);
+}
+
+qint64 MemoryGovernor::getLimit() const
+{
+    return limit.load(std::memory_order_relaxed);
+}
+
+void MemoryGovernor::setLimit(qint64 bytes)
+{
+    // lowering it refuses new reservations, what is held stays held
+    limit.store(qMax(qint64(0), bytes), std::memory_order_relaxed);
+}
+
+qint64 MemoryGovernor::getQueryLimit() const
+{
+    return queryLimit.load(std::memory_order_relaxed);
+}
+
+void MemoryGovernor::setQueryLimit(qint64 bytes)
+{
+    queryLimit.store(qMax(qint64(0), bytes), std::memory_order_relaxed);
+}
+
+MemoryBudget::MemoryBudget(qint64 limit)
+    : limit(limit)
+{
+}
+
+MemoryBudget::~MemoryBudget()
+{
+    MemoryGovernor::getInstance().release(used.load(std::memory_order_relaxed));
+}
+
+bool MemoryBudget::reserve(qint64 bytes)
+{
+    qint64 current = used.load(std::memory_order_relaxed);
+    do {
+        if (current + bytes > limit)
+            return false;
+    } while (!used.compare_exchange_weak(current, current + bytes, std::memory_order_relaxed));
+    // the query has room, the engine maybe not
+    if (!MemoryGovernor::getInstance().reserve(bytes)) {
+        used.fetch_sub(bytes, std::memory_order_relaxed);
+        return false;
+    }
+    qint64 now = current + bytes;
+    qint64 highest = peak.load(std::memory_order_relaxed);
+    while (now > highest && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed)) {}
+    return true;
+}
+
+void MemoryBudget::release(qint64 bytes)
+{
+    used.fetch_sub(bytes, std::memory_order_relaxed);
+    MemoryGovernor::getInstance().release(bytes);
+}
+
+qint64 MemoryBudget::getUsed() const
+{
+    return used.load(std::memory_order_relaxed);
+}
+
+qint64 MemoryBudget::getPeak() const
+{
+    return peak.load(std::memory_order_relaxed);
+}
+
+qint64 MemoryBudget::getLimit() const
+{
+    return limit;
+}
@@ -0,0 +1,64 @@
+#ifndef MEMORYGOVERNOR_H
+#define MEMORYGOVERNOR_H
+
+#include <QtGlobal>
+
+#include <atomic>
+
+// MemoryGovernor will be a Singleton
+// Caps the memory the engine's operators hold at once, across every
+// query running: result sets, sorts... reserve bytes from it before
+// allocating them and release them once freed. A refused reservation
+// isn't an error, the operator spills to a temporary file instead.
+
+class MemoryGovernor
+{
+public:
+    static MemoryGovernor& getInstance()
+    {
+        static MemoryGovernor singleton;
+        return singleton;
+    }
+
+    // false if 'bytes' more would go over the limit, nothing reserved then
+    bool reserve(qint64 bytes);
+    void release(qint64 bytes);
+    qint64 getUsed() const;
+    qint64 getLimit() const;
+    void setLimit(qint64 bytes);
+    // budget a query starts with (MemoryBudget)
+    qint64 getQueryLimit() const;
+    void setQueryLimit(qint64 bytes);
+
+private:
+    MemoryGovernor() = default;
+    std::atomic<qint64> used{0};
+    std::atomic<qint64> limit{1024LL * 1024 * 1024};
+    std::atomic<qint64> queryLimit{256LL * 1024 * 1024};
+    Q_DISABLE_COPY(MemoryGovernor)
+};
+
+// Memory of one query, shared by its operators and threads: bounded by
+// its own limit and by what the MemoryGovernor has left. Everything
+// still reserved goes back to the governor with the budget.
+
+class MemoryBudget
+{
+public:
+    explicit MemoryBudget(qint64 limit = MemoryGovernor::getInstance().getQueryLimit());
+    ~MemoryBudget();
+
+    bool reserve(qint64 bytes);
+    void release(qint64 bytes);
+    qint64 getUsed() const;
+    qint64 getPeak() const;
+    qint64 getLimit() const;
+
+private:
+    const qint64 limit;
+    std::atomic<qint64> used{0};
+    std::atomic<qint64> peak{0};
+    Q_DISABLE_COPY(MemoryBudget)
+};
+
+#endif // MEMORYGOVERNOR_H
@@ -0,0 +1,188 @@
+#include "metrics.h"
+
+#include <QSaveFile>
+#include <QTextStream>
+#include <QtAlgorithms>
+
+int Metrics::shard()
+{
+    // threads get consecutive shards in the order they first record
+    static std::atomic<int> nextShard{0};
+    thread_local int index = nextShard.fetch_add(1, std::memory_order_relaxed) % shardCount;
+    return index;
+}
+
+qint64 Metrics::Counter::value() const
+{
+    qint64 total = 0;
+    for (const auto& s : shards) total += s.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+Metrics::Histogram::Histogram()
+    : shards(new Shard[shardCount])
+{
+}
+
+int Metrics::Histogram::bucketIndex(qint64 value)
+{
+    if (value < (1 << subBits))
+        return value < 0 ? 0 : int(value);
+    // top subBits bits below the most significant one pick the sub-bucket
+    int msb = 63 - qCountLeadingZeroBits(quint64(value));
+    int shift = msb - subBits;
+    int sub = int(value >> shift) & ((1 << subBits) - 1);
+    return ((shift + 1) << subBits) + sub;
+}
+
+qint64 Metrics::Histogram::bucketUpper(int index)
+{
+    if (index < (1 << subBits))
+        return index;
+    int shift = (index >> subBits) - 1;
+    int sub = index & ((1 << subBits) - 1);
+    qint64 lower = qint64((1 << subBits) + sub) << shift;
+    return lower + (qint64(1) << shift) - 1;
+}
+
+void Metrics::Histogram::record(qint64 nanos)
+{
+    Shard &s = shards[Metrics::shard()];
+    s.counts[bucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+    s.sum.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+QList<qint64> Metrics::Histogram::merged() const
+{
+    QList<qint64> counts(bucketCount, 0);
+    for (int s = 0; s < shardCount; ++s)
+        for (int i = 0; i < bucketCount; ++i)
+            counts[i] += shards[s].counts[i].load(std::memory_order_relaxed);
+    return counts;
+}
+
+qint64 Metrics::Histogram::count() const
+{
+    qint64 total = 0;
+    for (qint64 c : merged()) total += c;
+    return total;
+}
+
+qint64 Metrics::Histogram::sum() const
+{
+    qint64 total = 0;
+    for (int s = 0; s < shardCount; ++s) total += shards[s].sum.load(std::memory_order_relaxed);
+    return total;
+}
+
+qint64 Metrics::Histogram::percentile(double p) const
+{
+    QList<qint64> counts = merged();
+    qint64 total = 0;
+    for (qint64 c : counts) total += c;
+    if (total == 0)
+        return 0;
+    qint64 rank = qMax(qint64(1), qint64(p / 100.0 * total + 0.5));
+    qint64 seen = 0;
+    for (int i = 0; i < bucketCount; ++i) {
+        seen += counts.at(i);
+        if (seen >= rank)
+            return bucketUpper(i);
+    }
+    return bucketUpper(bucketCount - 1);
+}
+
+qint64 Metrics::Histogram::countUpTo(qint64 limit) const
+{
+    QList<qint64> counts = merged();
+    qint64 total = 0;
+    for (int i = 0; i < bucketCount && bucketUpper(i) <= limit; ++i)
+        total += counts.at(i);
+    return total;
+}
+
+Metrics::Counter &Metrics::counter(const QString &name, const QString &help)
+{
+    QMutexLocker locker(&mutex);
+    Entry &e = entries[name];
+    if (!e.counter) {
+        e.help = help;
+        e.counter = std::make_unique<Counter>();
+    }
+    return *e.counter;
+}
+
+Metrics::Histogram &Metrics::histogram(const QString &name, const QString &help)
+{
+    QMutexLocker locker(&mutex);
+    Entry &e = entries[name];
+    if (!e.histogram) {
+        e.help = help;
+        e.histogram = std::make_unique<Histogram>();
+    }
+    return *e.histogram;
+}
+
+QList<Metrics::Sample> Metrics::snapshot() const
+{
+    QMutexLocker locker(&mutex);
+    QList<Sample> samples;
+    for (const auto& [name, e] : entries) {
+        Sample s;
+        s.name = name;
+        s.help = e.help;
+        if (e.histogram) {
+            s.histogram = true;
+            s.value = e.histogram->count();
+            s.sum = e.histogram->sum();
+            s.p50 = e.histogram->percentile(50);
+            s.p90 = e.histogram->percentile(90);
+            s.p99 = e.histogram->percentile(99);
+        }
+        else if (e.counter) {
+            s.value = e.counter->value();
+        }
+        samples.append(s);
+    }
+    return samples;
+}
+
+QString Metrics::prometheusText() const
+{
+    // Histogram buckets every power of two, ~1us to ~69s
+    static constexpr int firstBucket = 10;
+    static constexpr int lastBucket = 36;
+    QMutexLocker locker(&mutex);
+    QString text;
+    QTextStream out(&text);
+    for (const auto& [name, e] : entries) {
+        out << "# HELP " << name << " " << e.help << "\n";
+        if (e.histogram) {
+            out << "# TYPE " << name << " histogram\n";
+            for (int k = firstBucket; k <= lastBucket; ++k) {
+                qint64 limit = (qint64(1) << k) - 1;
+                out << name << "_bucket{le=\"" << QString::number((limit + 1) / 1e9, 'g', 6)
+                    << "\"} " << e.histogram->countUpTo(limit) << "\n";
+            }
+            qint64 count = e.histogram->count();
+            out << name << "_bucket{le=\"+Inf\"} " << count << "\n";
+            out << name << "_sum " << QString::number(e.histogram->sum() / 1e9, 'g', 12) << "\n";
+            out << name << "_count " << count << "\n";
+        }
+        else if (e.counter) {
+            out << "# TYPE " << name << " counter\n";
+            out << name << " " << e.counter->value() << "\n";
+        }
+    }
+    return text;
+}
+
+bool Metrics::writePrometheus(const QString &path) const
+{
+    // Scrapers (node_exporter textfile collector) never see a partial file
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    file.write(prometheusText().toUtf8());
+    return file.commit();
+}
@@ -0,0 +1,121 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QString>
+#include <QList>
+#include <QMutex>
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <map>
+#include <memory>
+
+// Metrics will be a Singleton
+// Named counters and latency histograms of the engine, cheap enough to
+// always stay on: each thread updates its own shard (relaxed atomics on
+// separate cache lines), shards are only summed when read or exported.
+// Look a metric up once and keep the reference:
+//     static Metrics::Counter &rows = Metrics::getInstance().counter(...);
+
+class Metrics
+{
+public:
+    static constexpr int shardCount = 16;
+
+    class Counter
+    {
+    public:
+        void add(qint64 n = 1) { shards[shard()].value.fetch_add(n, std::memory_order_relaxed); }
+        qint64 value() const;
+    private:
+        struct alignas(64) Shard {
+            std::atomic<qint64> value{0};
+        };
+        Shard shards[shardCount];
+    };
+
+    // Log-linear buckets (HDR style): 2^subBits buckets per power of two,
+    // so a recorded value is known within 1/2^subBits (12.5%)
+    class Histogram
+    {
+    public:
+        static constexpr int subBits = 3;
+        static constexpr int bucketCount = (64 - subBits) << subBits;
+
+        Histogram();
+        void record(qint64 nanos);
+        qint64 count() const;
+        qint64 sum() const;
+        // Upper bound of the bucket holding the p-th percentile (0-100)
+        qint64 percentile(double p) const;
+        // Values recorded <= limit, limit being a power of two minus one
+        qint64 countUpTo(qint64 limit) const;
+
+        static int bucketIndex(qint64 value);
+        static qint64 bucketUpper(int index);
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<qint64> counts[bucketCount] = {};
+            std::atomic<qint64> sum{0};
+        };
+        std::unique_ptr<Shard[]> shards;
+        QList<qint64> merged() const;
+    };
+
+    // Records the lifetime of the object into a histogram
+    class Timer
+    {
+    public:
+        explicit Timer(Histogram &histogram) : histogram(histogram) { timer.start(); }
+        ~Timer() { histogram.record(timer.nsecsElapsed()); }
+    private:
+        Histogram &histogram;
+        QElapsedTimer timer;
+        Q_DISABLE_COPY(Timer)
+    };
+
+    // Point in time values, for the status panel
+    struct Sample {
+        QString name;
+        QString help;
+        bool histogram = false;
+        qint64 value = 0;               // counter value / histogram count
+        qint64 sum = 0;                 // histograms: nanoseconds
+        qint64 p50 = 0;
+        qint64 p90 = 0;
+        qint64 p99 = 0;
+    };
+
+    static Metrics& getInstance()
+    {
+        static Metrics singleton;
+        return singleton;
+    }
+
+    // Created on first use, name follows Prometheus rules (megatron_..._total)
+    Counter &counter(const QString &name, const QString &help);
+    // Nanoseconds recorded, exported in seconds (megatron_..._seconds)
+    Histogram &histogram(const QString &name, const QString &help);
+
+    QList<Sample> snapshot() const;
+    // Prometheus text exposition format
+    QString prometheusText() const;
+    bool writePrometheus(const QString &path) const;
+
+private:
+    Metrics() = default;
+    // Index of the calling thread's shard
+    static int shard();
+
+    struct Entry {
+        QString help;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Histogram> histogram;
+    };
+    mutable QMutex mutex;
+    std::map<QString, Entry> entries;   // ordered by name, stable addresses
+    Q_DISABLE_COPY(Metrics)
+};
+
+#endif // METRICS_H
@@ -0,0 +1,58 @@
+#include "metricsdialog.h"
+#include "ui_metricsdialog.h"
+#include "metrics.h"
+
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QLocale>
+
+MetricsDialog::MetricsDialog(QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::MetricsDialog)
+{
+    ui->setupUi(this);
+    connect(ui->exportButton, &QPushButton::clicked, this, &MetricsDialog::exportMetrics);
+    connect(ui->closeButton, &QPushButton::clicked, this, &MetricsDialog::accept);
+    connect(&refreshTimer, &QTimer::timeout, this, &MetricsDialog::refresh);
+    refresh();
+    ui->metricsTable->resizeColumnsToContents();
+    refreshTimer.start(1000);
+}
+
+MetricsDialog::~MetricsDialog()
+{
+    delete ui;
+}
+
+void MetricsDialog::refresh()
+{
+    QLocale locale;
+    auto ms = [&locale](double nanos) { return locale.toString(nanos / 1e6, 'f', 3); };
+    const QList<Metrics::Sample> samples = Metrics::getInstance().snapshot();
+    QTableWidget *table = ui->metricsTable;
+    table->setRowCount(samples.size());
+    for (int row = 0; row < samples.size(); ++row) {
+        const Metrics::Sample &s = samples.at(row);
+        QStringList cells = {s.name, locale.toString(s.value)};
+        if (s.histogram && s.value > 0)
+            cells << ms(double(s.sum) / s.value) << ms(s.p50) << ms(s.p90) << ms(s.p99);
+        for (int c = 0; c < table->columnCount(); ++c) {
+            QTableWidgetItem *item = new QTableWidgetItem(cells.value(c));
+            if (c == 0)
+                item->setToolTip(s.help);
+            else
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            table->setItem(row, c, item);
+        }
+    }
+}
+
+void MetricsDialog::exportMetrics()
+{
+    QString path = QFileDialog::getSaveFileName(this, tr("Export Metrics"), "megatron.prom",
+                                                tr("Prometheus text files (*.prom)"));
+    if (path.isEmpty())
+        return;
+    if (!Metrics::getInstance().writePrometheus(path))
+        QMessageBox::warning(this, tr("Warning"), tr("Error while writing Metrics file: %1").arg(path));
+}
@@ -0,0 +1,31 @@
+#ifndef METRICSDIALOG_H
+#define METRICSDIALOG_H
+
+#include <QDialog>
+#include <QTimer>
+
+namespace Ui {
+class MetricsDialog;
+}
+
+// Status panel: current value of every engine metric, refreshed every
+// second, and export to a Prometheus text file
+
+class MetricsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsDialog(QWidget *parent = nullptr);
+    ~MetricsDialog();
+
+private slots:
+    void refresh();
+    void exportMetrics();
+
+private:
+    Ui::MetricsDialog *ui;
+    QTimer refreshTimer;
+};
+
+#endif // METRICSDIALOG_H
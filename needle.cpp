@@ -0,0 +1,98 @@
+#include "needle.h"
+
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NEEDLE_SSE2
+#endif
+
+Needle::Needle(QByteArrayView p)
+    : pattern(p.toByteArray())
+{
+}
+
+bool Needle::isEmpty() const
+{
+    return pattern.isEmpty();
+}
+
+bool Needle::prefixOf(QByteArrayView text) const
+{
+    return text.size() >= pattern.size()
+        && std::memcmp(text.data(), pattern.constData(), size_t(pattern.size())) == 0;
+}
+
+bool Needle::suffixOf(QByteArrayView text) const
+{
+    return text.size() >= pattern.size()
+        && std::memcmp(text.data() + text.size() - pattern.size(), pattern.constData(),
+                       size_t(pattern.size())) == 0;
+}
+
+bool Needle::matchesAt(const char *text) const
+{
+    // bytes between the first and the last one
+    qsizetype inner = pattern.size() - 2;
+    return inner <= 0 || std::memcmp(text + 1, pattern.constData() + 1, size_t(inner)) == 0;
+}
+
+bool Needle::containedIn(QByteArrayView text) const
+{
+    const qsizetype n = pattern.size();
+    if (n == 0)
+        return true;
+    if (n > text.size())
+        return false;
+    const char *s = text.data();
+    if (n == 1)
+        return std::memchr(s, pattern.at(0), size_t(text.size())) != nullptr;
+    // candidates: positions i where s[i] is the first byte and s[i + n - 1] the last one
+    const qsizetype last = text.size() - n;             // last candidate position
+    qsizetype i = 0;
+#if defined(__AVX2__)
+    const __m256i first8 = _mm256_set1_epi8(pattern.at(0));
+    const __m256i last8 = _mm256_set1_epi8(pattern.at(n - 1));
+    for (; i + 32 <= last + 1; i += 32) {
+        __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+        __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i + n - 1));
+        __m256i both = _mm256_and_si256(_mm256_cmpeq_epi8(head, first8), _mm256_cmpeq_epi8(tail, last8));
+        quint32 mask = quint32(_mm256_movemask_epi8(both));
+        while (mask) {
+            if (matchesAt(s + i + qCountTrailingZeroBits(mask)))
+                return true;
+            mask &= mask - 1;
+        }
+    }
+#elif defined(NEEDLE_SSE2)
+    const __m128i first8 = _mm_set1_epi8(pattern.at(0));
+    const __m128i last8 = _mm_set1_epi8(pattern.at(n - 1));
+    for (; i + 16 <= last + 1; i += 16) {
+        __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+        __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i + n - 1));
+        __m128i both = _mm_and_si128(_mm_cmpeq_epi8(head, first8), _mm_cmpeq_epi8(tail, last8));
+        quint32 mask = quint32(_mm_movemask_epi8(both));
+        while (mask) {
+            if (matchesAt(s + i + qCountTrailingZeroBits(mask)))
+                return true;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    // remaining positions (or every one without SIMD): memchr on the first byte
+    const char first = pattern.at(0);
+    const char lastByte = pattern.at(n - 1);
+    while (i <= last) {
+        const char *p = static_cast<const char *>(std::memchr(s + i, first, size_t(last - i + 1)));
+        if (!p)
+            return false;
+        if (p[n - 1] == lastByte && matchesAt(p))
+            return true;
+        i = p - s + 1;
+    }
+    return false;
+}
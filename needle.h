@@ -0,0 +1,30 @@
+#ifndef NEEDLE_H
+#define NEEDLE_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+// Substring searched for by Contains/BeginsWith/EndsWith on the UTF-8 bytes
+// of table files, prepared once per execution. contains() only compares
+// the whole needle where its first and last bytes both match, candidates
+// found 32 (AVX2) or 16 (SSE2) positions at a time.
+
+class Needle
+{
+public:
+    Needle() = default;
+    explicit Needle(QByteArrayView pattern);
+
+    bool isEmpty() const;
+    bool containedIn(QByteArrayView text) const;
+    bool prefixOf(QByteArrayView text) const;
+    bool suffixOf(QByteArrayView text) const;
+
+private:
+    QByteArray pattern;
+
+    // true if the needle starts at text, first and last bytes known to match
+    bool matchesAt(const char *text) const;
+};
+
+#endif // NEEDLE_H
@@ -0,0 +1,238 @@
+#include "partitioning.h"
+#include "queryplan.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <limits>
+
+Partitioning Partitioning::parse(const QString &clause, const QStringList &columns,
+                                 const QByteArray &types, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error) *error = message;
+        return Partitioning();
+    };
+    static const QRegularExpression syntax(
+        R"(^\s*(RANGE|HASH)\s*\(\s*([^)]*?)\s*\)\s*(.*?)\s*$)",
+        QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch match = syntax.match(clause);
+    if (!match.hasMatch())
+        return fail(tr("Expected RANGE (column) bound, bound... or HASH (column) buckets."));
+    Partitioning p;
+    p.kind = match.captured(1).compare("RANGE", Qt::CaseInsensitive) == 0 ? Range : Hash;
+    p.position = int(columns.indexOf(match.captured(2)));
+    if (p.position < 0)
+        return fail(tr("Column: %1 not found.").arg(match.captured(2)));
+    p.type = types.at(p.position);
+    if (p.kind == Range) {
+        if (!QByteArray("ifdt").contains(p.type))
+            return fail(tr("Range partitions need a numeric column, %1 isn't.").arg(match.captured(2)));
+        for (const auto& b : match.captured(3).split(',', Qt::SkipEmptyParts)) {
+            bool ok;
+            double bound = b.trimmed().toDouble(&ok);
+            if (!ok || (!p.bounds.isEmpty() && bound <= p.bounds.last()))
+                return fail(tr("Range bounds must be ascending numbers, %1 isn't.").arg(b.trimmed()));
+            p.bounds.append(bound);
+        }
+        if (p.bounds.isEmpty())
+            return fail(tr("Range partitions need at least one bound."));
+    }
+    else {
+        bool ok;
+        p.buckets = match.captured(3).toInt(&ok);
+        if (!ok || p.buckets < 2 || p.buckets > 1024)
+            return fail(tr("Hash partitions need 2 to 1024 buckets."));
+    }
+    return p;
+}
+
+QString Partitioning::partitionName(const QString &tableName, int id)
+{
+    return tableName + ".p" + QString::number(id);
+}
+
+int Partitioning::partitionId(const QString &partitionName)
+{
+    return partitionName.section(".p", -1).toInt();
+}
+
+bool Partitioning::isPartitioned() const
+{
+    return kind != None;
+}
+
+Partitioning::Kind Partitioning::getKind() const
+{
+    return kind;
+}
+
+int Partitioning::getPosition() const
+{
+    return position;
+}
+
+int Partitioning::getPartitionCount() const
+{
+    return kind == Range ? int(bounds.size()) + 1 : kind == Hash ? buckets : 0;
+}
+
+const QList<int> &Partitioning::getPartitions() const
+{
+    return partitions;
+}
+
+void Partitioning::addPartition(int id)
+{
+    auto it = std::lower_bound(partitions.begin(), partitions.end(), id);
+    if (it == partitions.end() || *it != id)
+        partitions.insert(it, id);
+}
+
+void Partitioning::removePartition(int id)
+{
+    partitions.removeOne(id);
+}
+
+quint64 Partitioning::hash(QByteArrayView value)
+{
+    // FNV-1a: stable across runs and Qt versions, rows stay where they were put
+    quint64 h = 14695981039346656037ULL;
+    for (char c : value) {
+        h ^= quint8(c);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+int Partitioning::partitionOf(QByteArrayView value) const
+{
+    if (kind == Hash)
+        return int(hash(value) % quint64(buckets));
+    // the first bound above the value, NULL and garbage read as 0
+    double v = value.toDouble();
+    return int(std::upper_bound(bounds.cbegin(), bounds.cend(), v) - bounds.cbegin());
+}
+
+bool Partitioning::mayMatch(int id, int optor, const QString &condition1, const QString &condition2) const
+{
+    switch (optor) {
+    // matching rows have the condition's bytes, so they share its partition
+    case 3: case 12: case 14:
+        return id == partitionOf(optor == 3 ? condition1.toUtf8() : QByteArray());
+    case 0: case 1: case 4: case 5: case 16:
+        break;
+    default:
+        return true;
+    }
+    if (kind != Range)
+        return true;
+    constexpr double infinity = std::numeric_limits<double>::infinity();
+    double lower = id > 0 ? bounds.at(id - 1) : -infinity;     // inclusive
+    double upper = id < bounds.size() ? bounds.at(id) : infinity;    // exclusive
+    bool ok, upperOk = true;
+    double x = condition1.toDouble(&ok);
+    double y = optor == 16 ? condition2.toDouble(&upperOk) : 0;
+    if (!ok || !upperOk)
+        return true;
+    switch (optor) {
+    case 0: return lower < x;                   // <
+    case 1: return upper > x;                   // >
+    case 4: return lower <= x;                  // <=
+    case 5: return upper > x;                   // >=
+    case 16: return lower <= y && upper > x;    // Between
+    }
+    return true;
+}
+
+QList<int> Partitioning::prune(const QueryPlan &plan, const QueryParams &params) const
+{
+    if (plan.predicates.isEmpty())
+        return partitions;
+    // a partition stays if an OR group may match in it, that is if none
+    // of the group's predicates on the partition column rules it out
+    QList<int> kept;
+    for (int id : partitions) {
+        bool groupMatches = true;
+        bool matches = false;
+        for (qsizetype i = 0; i < plan.predicates.size() && !matches; ++i) {
+            const QueryPlan::Predicate &p = plan.predicates.at(i);
+            if (i > 0 && p.orPrevious) {
+                matches = groupMatches;
+                groupMatches = true;
+            }
+            if (groupMatches && p.fieldPosition == position) {
+                QueryParams::Operands operands = params.conditions.value(i);
+                groupMatches = mayMatch(id, p.optor, operands.condition1, operands.condition2);
+            }
+        }
+        if (matches || groupMatches)
+            kept.append(id);
+    }
+    return kept;
+}
+
+QString Partitioning::describe(int id, const QString &column) const
+{
+    if (kind == Hash)
+        return tr("hash(%1) %2 of %3").arg(column).arg(id).arg(buckets);
+    if (id == 0)
+        return QString("%1 < %2").arg(column).arg(bounds.first());
+    if (id == bounds.size())
+        return QString("%1 >= %2").arg(column).arg(bounds.last());
+    return QString("%1 <= %2 < %3").arg(bounds.at(id - 1)).arg(column).arg(bounds.at(id));
+}
+
+QString Partitioning::toString(const QString &column) const
+{
+    if (kind == Hash)
+        return QString("HASH (%1) %2").arg(column).arg(buckets);
+    QStringList values;
+    for (double b : bounds) values.append(QString::number(b, 'g', 17));
+    return QString("RANGE (%1) %2").arg(column, values.join(", "));
+}
+
+bool Partitioning::read(const QString &path)
+{
+    *this = Partitioning();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    // kind#position#type#buckets, then the bounds, then the partition ids
+    QTextStream in(&file);
+    QStringList header = in.readLine().split('#');
+    if (header.size() < 4)
+        return false;
+    Kind k = header.at(0) == "range" ? Range : header.at(0) == "hash" ? Hash : None;
+    if (k == None)
+        return false;
+    position = header.at(1).toInt();
+    type = header.at(2).isEmpty() ? ' ' : header.at(2).at(0).toLatin1();
+    buckets = header.at(3).toInt();
+    for (const auto& b : in.readLine().split(',', Qt::SkipEmptyParts))
+        bounds.append(b.toDouble());
+    for (const auto& id : in.readLine().split(',', Qt::SkipEmptyParts))
+        partitions.append(id.toInt());
+    std::sort(partitions.begin(), partitions.end());
+    kind = k;
+    return true;
+}
+
+bool Partitioning::write(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    out << (kind == Range ? "range" : "hash") << "#" << position << "#" << type << "#" << buckets << "\n";
+    QStringList values;
+    for (double b : bounds) values.append(QString::number(b, 'g', 17));
+    out << values.join(',') << "\n";
+    values.clear();
+    for (int id : partitions) values.append(QString::number(id));
+    out << values.join(',') << "\n";
+    file.close();
+    return true;
+}
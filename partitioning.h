@@ -0,0 +1,72 @@
+#ifndef PARTITIONING_H
+#define PARTITIONING_H
+
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+
+struct QueryPlan;
+struct QueryParams;
+
+// How the rows of a relation are spread over partitions, stored in
+// <table>.part. Every partition is a relation of its own in the
+// SystemCatalog, <table>.p<id>, with the table's columns and codec; the
+// table's own file stays empty.
+//  - Range (numeric column): partition id holds bounds[id - 1] <= value <
+//    bounds[id], the first one everything below bounds[0], the last one
+//    everything from bounds.last() on. NULLs count as 0, as they do for
+//    the WHERE operators
+//  - Hash: partition id holds the values whose bytes hash to id modulo
+//    buckets, so that isEqualTo finds all of them in one
+// Partitions are only created once a row needs them, and can be dropped.
+
+class Partitioning
+{
+    Q_DECLARE_TR_FUNCTIONS(Partitioning)
+public:
+    enum Kind { None, Range, Hash };
+
+    Partitioning() = default;
+    // "RANGE (column) bound, bound..." or "HASH (column) buckets", invalid
+    // (None) + error if it doesn't fit the table's columns (names and
+    // attrMeta types, ordered by position)
+    static Partitioning parse(const QString &clause, const QStringList &columns,
+                              const QByteArray &types, QString *error = nullptr);
+    static QString partitionName(const QString &tableName, int id);
+    // id of the partition named 'partitionName'
+    static int partitionId(const QString &partitionName);
+
+    bool isPartitioned() const;
+    Kind getKind() const;
+    int getPosition() const;                    // of the partition column
+    int getPartitionCount() const;              // declared ones
+    const QList<int> &getPartitions() const;    // holding a relation, ascending
+    void addPartition(int id);
+    void removePartition(int id);
+    // Partition of a row, 'value' as a plain (decoded) field
+    int partitionOf(QByteArrayView value) const;
+    // Partitions holding rows that may satisfy the WHERE clause
+    QList<int> prune(const QueryPlan &plan, const QueryParams &params) const;
+    // Values of partition 'id', e.g. "10 <= Age < 20"
+    QString describe(int id, const QString &column) const;
+    QString toString(const QString &column) const;
+
+    bool read(const QString &path);
+    bool write(const QString &path) const;
+
+private:
+    Kind kind = None;
+    int position = -1;
+    char type = ' ';
+    QList<double> bounds;                       // Range, ascending
+    int buckets = 0;                            // Hash
+    QList<int> partitions;
+
+    bool mayMatch(int id, int optor, const QString &condition1, const QString &condition2) const;
+    static quint64 hash(QByteArrayView value);
+};
+
+#endif // PARTITIONING_H
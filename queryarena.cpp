@@ -0,0 +1,60 @@
+#include "queryarena.h"
+
+#include <cstring>
+
+QueryArena::QueryArena(qsizetype initialChunk)
+    : pool(std::size_t(initialChunk), &upstream)
+{
+}
+
+std::pmr::memory_resource *QueryArena::resource()
+{
+    return &pool;
+}
+
+void *QueryArena::allocate(qsizetype bytes, qsizetype alignment)
+{
+    return pool.allocate(std::size_t(bytes), std::size_t(alignment));
+}
+
+QByteArrayView QueryArena::copy(QByteArrayView bytes)
+{
+    if (bytes.isEmpty())
+        return QByteArrayView();
+    char *p = static_cast<char *>(pool.allocate(std::size_t(bytes.size()), 1));
+    std::memcpy(p, bytes.data(), std::size_t(bytes.size()));
+    return QByteArrayView(p, bytes.size());
+}
+
+void QueryArena::release()
+{
+    pool.release();
+}
+
+qint64 QueryArena::getReserved() const
+{
+    return upstream.reserved;
+}
+
+qint64 QueryArena::getChunkCount() const
+{
+    return upstream.chunks;
+}
+
+void *QueryArena::Upstream::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    chunks++;
+    reserved += qint64(bytes);
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void QueryArena::Upstream::do_deallocate(void *p, std::size_t bytes, std::size_t alignment)
+{
+    reserved -= qint64(bytes);
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool QueryArena::Upstream::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
@@ -0,0 +1,46 @@
+#ifndef QUERYARENA_H
+#define QUERYARENA_H
+
+#include <QByteArrayView>
+#include <QtGlobal>
+
+#include <cstddef>
+#include <memory_resource>
+
+// Memory of one query's rows, keys and strings: bump allocation out of
+// growing chunks, nothing is freed on its own, everything at once by
+// release() or the destructor. std::pmr containers use it via resource().
+
+class QueryArena
+{
+public:
+    explicit QueryArena(qsizetype initialChunk = 64 * 1024);
+
+    std::pmr::memory_resource *resource();
+    void *allocate(qsizetype bytes, qsizetype alignment = alignof(std::max_align_t));
+    // Copy of 'bytes' living as long as the arena
+    QByteArrayView copy(QByteArrayView bytes);
+    // Frees every chunk in one shot
+    void release();
+
+    qint64 getReserved() const;                 // bytes currently taken from the heap
+    qint64 getChunkCount() const;               // heap allocations made so far
+
+private:
+    // Counts what the arena takes from the heap
+    class Upstream : public std::pmr::memory_resource
+    {
+    public:
+        qint64 reserved = 0;
+        qint64 chunks = 0;
+    private:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+    };
+    Upstream upstream;
+    std::pmr::monotonic_buffer_resource pool;
+    Q_DISABLE_COPY(QueryArena)
+};
+
+#endif // QUERYARENA_H
@@ -2,17 +2,29 @@
 #include "ui_queryform.h"
 #include "systemcatalog.h"
 #include "megatron_types.h"
+#include "executor.h"
+#include "resultcache.h"
+#include "metrics.h"
+#include "slowquerylog.h"
+#include "exportsink.h"
+#include "materializedview.h"
 
 #include <QMessageBox>
+#include <QFileDialog>
+#include <QBoxLayout>
 #include <QMultiMap>
 #include <QList>
+#include <QLocale>
+#include <QElapsedTimer>
 
 QueryForm::QueryForm(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::QueryForm)
 {
     ui->setupUi(this);
-    tableWidget = ui->tableWidget;
+    tableView = ui->tableView;
+    resultModel = new ResultModel(this);
+    tableView->setModel(resultModel);
     attrInput = ui->attrLineEdit;
     tableInput = ui->tableLineEdit;
     whereClause = ui->whereCheckBox;
@@ -22,6 +34,19 @@ QueryForm::QueryForm(QWidget *parent)
     secondCond = ui->fieldThreelineEdit;
     selectIntoClause = ui->selectIntoCheckBox;
     newTableInput = ui->selectIntoLineEdit;
+    intoRowsOutput = ui->intoRowsCheckBox;
+    materializedView = ui->viewCheckBox;
+    sampleMethod = ui->sampleComboBox;
+    samplePercent = ui->samplePercentSpinBox;
+    resultTabs = ui->resultTabWidget;
+    planTree = ui->planTreeWidget;
+    conditionLayout = ui->formLayout_2;
+    ConditionRow row;
+    row.column = columnInput;
+    row.optor = comparisonOperator;
+    row.first = firstCond;
+    row.second = secondCond;
+    conditionRows.append(row);
     createActions();
 }
 
@@ -41,11 +66,7 @@ void QueryForm::warning(const QString &message, QWidget *parent)
 bool QueryForm::validateForm()
 {
     QString table = tableInput->text().trimmed();
-    QString col = columnInput->text().trimmed();
-    QString fcond = firstCond->text().trimmed();
-    QString scond = secondCond->text().trimmed();
     QString name = newTableInput->text().trimmed();
-    int op = comparisonOperator->currentIndex();
     // form validation
     if (attrInput->text().isEmpty()) { warning("Attributes field is empty.", this); return false; }
     else if (table.isEmpty()) { warning("Table field is empty.", this); return false; }
@@ -55,227 +76,160 @@ bool QueryForm::validateForm()
         return ok;
     };
     if (whereClause->isChecked()) {
-        if (col.isEmpty()) { warning("Column field is empty.", this); return false; }
-        switch (op) {
-        case 0: case 1: case 4: case 5:
-        {
-            if (fcond.isEmpty()) { warning("Condition field is empty.", this); return false; }
-            else if (!isNumber(fcond)) { warning("Condition field needs to be a digit.", this); return false; }
-            break;
-        }
-        case 2: case 3: case 6: case 7: case 8: case 9: case 10: case 11:
-        {
-            if (fcond.isEmpty()) { warning("Condition field is empty.", this); return false; }
-            break;
-        }
-        case 12: case 13: case 14: case 15:
-            // already handled column field
-            break;
-        case 16: case 17:
-        {
-            if (fcond.isEmpty()) { warning("Lower limit field is empty.", this); return false; }
-            else if (scond.isEmpty()) { warning("Upper limit field is empty.", this); return false; }
-            else if (!isNumber(fcond) && !isNumber(scond)) { warning("Lower/Upper fields need to be a digit.", this); return false; }
-            break;
-        }
+        for (const auto& row : std::as_const(conditionRows)) {
+            QString col = row.column->text().trimmed();
+            QString fcond = row.first->text().trimmed();
+            QString scond = row.second->text().trimmed();
+            int op = row.optor->currentIndex();
+            if (col.isEmpty()) { warning("Column field is empty.", this); return false; }
+            switch (op) {
+            case 0: case 1: case 4: case 5:
+            {
+                if (fcond.isEmpty()) { warning("Condition field is empty.", this); return false; }
+                else if (!isNumber(fcond)) { warning("Condition field needs to be a digit.", this); return false; }
+                break;
+            }
+            case 2: case 3: case 6: case 7: case 8: case 9: case 10: case 11:
+            {
+                if (fcond.isEmpty()) { warning("Condition field is empty.", this); return false; }
+                break;
+            }
+            case 12: case 13: case 14: case 15:
+                // already handled column field
+                break;
+            case 16: case 17:
+            {
+                if (fcond.isEmpty()) { warning("Lower limit field is empty.", this); return false; }
+                else if (scond.isEmpty()) { warning("Upper limit field is empty.", this); return false; }
+                else if (!isNumber(fcond) || !isNumber(scond)) { warning("Lower/Upper fields need to be a digit.", this); return false; }
+                break;
+            }
+            }
         }
     }
-    else if (selectIntoClause->isChecked()) {
+    if (selectIntoClause->isChecked()) {
         if (name.isEmpty()) { warning("New Table Name field is empty.", this); return false; }
     }
     return true;
 }
 
-QString QueryForm::generateExecutionPlan()
+QuerySpec QueryForm::querySpec() const
 {
-    QString plan;
-    // some syntactic/semantic validations included
-    SystemCatalog *sysCat = &SystemCatalog::getInstance();
-
-    QStringList attributes = attrInput->text().simplified().split(",");
-    for (auto& i : attributes) i = i.trimmed(); // clean spaces
-
-    // FROM: get table information
-    QString tableName = tableInput->text().trimmed();
-    auto table = sysCat->find(tableName);
-    // If table not found in schema
-    if (table == sysCat->end()) {
-        warning(tr("Table: %1 not found in schema.").arg(tableName), this);
-        return QString();
-    }
-    // SELECT - SelectAll: '*' case
-    if (attributes.size() == 1) {
-        if (attributes.contains("*"))
-            plan.append((char)Types::SelectAll);
-        else
-            plan.append((char)Types::SelectCustom);
-    }
-    // SELECT - SelectCustom: custom attributes
-    else {
-        if (attributes.size() > 1) {
-            if (attributes.contains("") || attributes.contains("*")) {
-                warning("Attributes field: Bad syntax.", this);
-                return QString();
-            }
-            else
-                plan.append((char)Types::SelectCustom);
+    QuerySpec spec;
+    spec.attributes = attrInput->text().simplified().split(",");
+    for (auto& i : spec.attributes) i = i.trimmed(); // clean spaces
+    spec.tableName = tableInput->text().trimmed();
+    spec.into = selectIntoClause->isChecked();
+    spec.where = whereClause->isChecked();
+    if (spec.where) {
+        for (const auto& row : conditionRows) {
+            QuerySpec::Condition condition;
+            condition.field = row.column->text().trimmed();
+            condition.optor = row.optor->currentIndex();
+            condition.orPrevious = row.connective && row.connective->currentIndex() == 1;
+            spec.conditions.append(condition);
         }
-        // Seek for specified attribute(s) 'position'
-        // while (table != sysCat->end() && table.key() == tableName) {
-        //     const SystemCatalog::attrMeta& attrInfo = table.value();
-        //     for (qsizetype i = 0; i < attributes.size() || attrPositions.size() != attributes.size(); i++)
-        //         if (attrInfo.attributeName == attributes[i])
-        //             attrPositions.append(attrInfo.position);
-        //     ++table;
-        // }
     }
-    // INTO:
-    if (selectIntoClause->isChecked())
-        plan.append((char)Types::SelectInto);
-    // WHERE:
-    if (whereClause->isChecked())
-        plan.append((char)Types::Where);
-    // End of executionPlan
+    return spec;
+}
+
+QString QueryForm::normalizedQuery() const
+{
+    return querySpec().normalized();
+}
+
+QueryPlan QueryForm::generateExecutionPlan()
+{
+    // some syntactic/semantic validations included
+    QString error;
+    QueryPlan plan = QueryPlan::prepare(querySpec(), &error);
+    if (!plan.isValid())
+        warning(error, this);
     return plan;
 }
 
-bool QueryForm::executeExecutionPlan(const QString& plan)
+QueryParams QueryForm::bindParameters() const
 {
-    // SELECT * FROM ...
-    if (plan == "A") {
-        QString tableName = tableInput->text().trimmed();
-        return exec(tableName);
+    QueryParams params;
+    if (selectIntoClause->isChecked())
+        params.newTableName = newTableInput->text().trimmed();
+    if (whereClause->isChecked()) {
+        for (const auto& row : conditionRows) {
+            QueryParams::Operands operands;
+            operands.condition1 = row.first->text().trimmed();
+            operands.condition2 = row.second->text().trimmed();
+            params.conditions.append(operands);
+        }
     }
-    // SELECT * INTO ... FROM ...
-    else if (plan == "AI") {
-        QString newTableName = newTableInput->text().trimmed();
-        QString tableName = tableInput->text().trimmed();
+    return params;
+}
 
-        return exec(newTableName, tableName);
-    }
-    // SELECT * FROM ... WHERE ...
-    else if (plan == "AW") {
-        QString tableName = tableInput->text().trimmed();
-        QString field = columnInput->text().trimmed();
-        int optor = comparisonOperator->currentIndex();
-        switch (optor) {
-        case 0: case 1: case 2: case 3: case 4: case 5:
-        case 6: case 7: case 8: case 9: case 10: case 11:
-        {
-            QString condition = firstCond->text().trimmed();
-            return exec(tableName, field, optor, condition);
-        }
-        case 12: case 13: case 14: case 15:
-        {
-            QString condition1 = firstCond->text().trimmed();
-            QString condition2 = secondCond->text().trimmed();
-            return exec(tableName, field, optor, condition1, condition2);
-        }
-        case 16: case 17:
-        {
-            return exec(tableName, field, optor);
-        }
-        }
+bool QueryForm::executeExecutionPlan(const QueryPlan& plan, const QueryParams& params,
+                                     QueryProfile* profile, bool useResultCache, bool analyze)
+{
+    if (!plan.isValid()) {
+        warning(tr("Plan: %1 invalid. generateExecutionPlan() failed.").arg(plan.clauses));
+        return false;
     }
-    // SELECT * INTO ... FROM ... WHERE ...
-    else if (plan == "AIW") {
-        QString tableName = tableInput->text().trimmed();
-        QString newTableName = newTableInput->text().trimmed();
-        QString field = columnInput->text().trimmed();
-        int optor = comparisonOperator->currentIndex();
-        switch (optor) {
-        case 0: case 1: case 2: case 3: case 4: case 5:
-        case 6: case 7: case 8: case 9: case 10: case 11:
-        {
-            QString condition = firstCond->text().trimmed();
-            return exec(newTableName, tableName, field, optor, condition);
-        }
-        case 12: case 13: case 14: case 15:
-        {
-            QString condition1 = firstCond->text().trimmed();
-            QString condition2 = secondCond->text().trimmed();
-            return exec(newTableName, tableName, field, optor, condition1, condition2);
-        }
-        case 16: case 17:
-        {
-            return exec(newTableName, tableName, field, optor);
-        }
+    static Metrics::Histogram &queryLatency = Metrics::getInstance().histogram(
+        "megatron_query_duration_seconds", "Time to execute a query and show its results");
+    static Metrics::Counter &queries = Metrics::getInstance().counter(
+        "megatron_queries_total", "Queries executed");
+    static Metrics::Counter &queryErrors = Metrics::getInstance().counter(
+        "megatron_query_errors_total", "Queries that failed while executing");
+    queries.add();
+    Metrics::Timer timer(queryLatency);
+    RowSink &sink = *resultModel;
+    // SELECT INTO has side effects, always executed
+    ResultCache &resultCache = ResultCache::getInstance();
+    // a sample isn't the query's result
+    TableSample sample = tableSample();
+    bool cacheable = useResultCache && resultCache.isEnabled() && !plan.hasClause(Types::SelectInto) &&
+                     !sample.isSampling();
+    QString resultKey;
+    if (cacheable) {
+        resultKey = plan.canonical(params);
+        if (const CachedResult *cached = resultCache.find(resultKey)) {
+            cached->rows.replay(sink);
+            return resultsComplete();
         }
     }
 
-    // SELECT ... FROM ...
-    else if (plan == "C") {
-        QStringList attributes = attrInput->text().trimmed().split(",");
-        for (auto& i : attributes) i = i.trimmed(); // clean spaces
-        QString tableName = tableInput->text().trimmed();
-        return exec(attributes, tableName);
-    }
-    // SELECT ... INTO ... FROM ...
-    else if (plan == "CI") {
-        QStringList attributes = attrInput->text().trimmed().split(",");
-        for (auto& i : attributes) i = i.trimmed(); // clean spaces
-        QString newTableName = newTableInput->text().trimmed();
-        QString tableName = tableInput->text().trimmed();
-        return exec(attributes, newTableName, tableName);
-    }
-    // SELECT ... FROM ... WHERE ...
-    else if (plan == "CW") {
-        QStringList attributes = attrInput->text().trimmed().split(",");
-        for (auto& i : attributes) i = i.trimmed(); // clean spaces
-        QString tableName = tableInput->text().trimmed();
-        QString field = columnInput->text().trimmed();
-        int optor = comparisonOperator->currentIndex();
-        switch (optor) {
-        case 0: case 1: case 2: case 3: case 4: case 5:
-        case 6: case 7: case 8: case 9: case 10: case 11:
-        {
-            QString condition = firstCond->text().trimmed();
-            return exec(attributes, tableName, field, optor, condition);
-        }
-        case 12: case 13: case 14: case 15:
-        {
-            QString condition1 = firstCond->text().trimmed();
-            QString condition2 = secondCond->text().trimmed();
-            return exec(attributes, tableName, field, optor, condition1, condition2);
-        }
-        case 16: case 17:
-        {
-            return exec(attributes, tableName, field, optor);
+    Executor executor(plan, params);
+    executor.setProfile(profile);
+    executor.setAnalyze(analyze);
+    executor.setSample(sample);
+    // without its rows, SELECT INTO copies files or writes in parallel
+    executor.setIntoOutput(intoRowsOutput->isChecked());
+    if (!cacheable) {
+        if (!executor.run(sink)) {
+            queryErrors.add();
+            warning(executor.errorString(), this);
+            return false;
         }
+        if (!resultsComplete()) {
+            queryErrors.add();
+            return false;
         }
+        if (profile)
+            profile->operators[QueryProfile::Output].detail = tr("Results table");
+        return true;
     }
-    // SELECT ... INTO ... FROM ... WHERE ...
-    else if (plan == "CIW") {
-        QStringList attributes = attrInput->text().trimmed().split(",");
-        for (auto& i : attributes) i = i.trimmed(); // clean spaces
-        QString newTableName = newTableInput->text().trimmed();
-        QString tableName = tableInput->text().trimmed();
-        QString field = columnInput->text().trimmed();
-        int optor = comparisonOperator->currentIndex();
-        switch (optor) {
-        case 0: case 1: case 2: case 3: case 4: case 5:
-        case 6: case 7: case 8: case 9: case 10: case 11:
-        {
-            QString condition = firstCond->text().trimmed();
-            return exec(attributes, newTableName, tableName, field, optor, condition);
-        }
-        case 12: case 13: case 14: case 15:
-        {
-            QString condition1 = firstCond->text().trimmed();
-            QString condition2 = secondCond->text().trimmed();
-            return exec(attributes, newTableName, tableName, field, optor, condition1, condition2);
-        }
-        case 16: case 17:
-        {
-            return exec(attributes, newTableName, tableName, field, optor);
-        }
-        }
+    CachingSink cachingSink(sink, plan.tableName, resultCache.getMaxBytes());
+    if (!executor.run(cachingSink)) {
+        queryErrors.add();
+        warning(executor.errorString(), this);
+        return false;
     }
-    else {
-        warning(tr("Plan: %1 invalid. generateExecutionPlan() failed.").arg(plan));
+    if (!resultsComplete()) {
+        queryErrors.add();
         return false;
     }
-    return false;
+    if (profile)
+        profile->operators[QueryProfile::Output].detail = tr("Results table");
+    if (CachedResult *result = cachingSink.take())
+        resultCache.insert(resultKey, result, cachingSink.getCost());
+    return true;
 }
 
 void QueryForm::insertRecord()
@@ -288,321 +242,355 @@ void QueryForm::deleteRecord()
 
 }
 
-void QueryForm::runQuery()
+TableSample QueryForm::tableSample() const
 {
-    if (!validateForm()) return;
-    // Clear tableWidget for future queries
-    else if (tableWidget->rowCount() != 0 ||
-             tableWidget->columnCount() != 0) {
-        tableWidget->setRowCount(0);
-        tableWidget->setColumnCount(0);
-    }
-    QString plan = generateExecutionPlan();
-    if (plan.isEmpty()) return;
-    // Define query templates, plan clauses' order MATTER
-    if (executeExecutionPlan(plan)) {
-        emit refreshUi();
-    }
+    TableSample sample;
+    sample.method = TableSample::Method(sampleMethod->currentIndex());
+    sample.percent = samplePercent->value();
+    return sample;
 }
 
-void QueryForm::clear()
+QueryPlan QueryForm::cachedExecutionPlan()
 {
-    // Clear all
-    tableWidget->setRowCount(0);
-    tableWidget->setColumnCount(0);
-    attrInput->clear();
-    tableInput->clear();
-    newTableInput->clear();
-    columnInput->clear();
-    firstCond->clear();
-    secondCond->clear();
+    // Reuse the prepared plan of an equally shaped query if still valid
+    PlanCache &planCache = PlanCache::getInstance();
+    QString key = normalizedQuery();
+    if (const QueryPlan *cached = planCache.find(key))
+        return *cached;
+    QueryPlan plan = generateExecutionPlan();
+    if (plan.isValid())
+        planCache.insert(key, plan);
+    return plan;
 }
 
-bool QueryForm::exec(const QString &tableName)
+bool QueryForm::resultsComplete()
 {
-    SystemCatalog *sysCat = &SystemCatalog::getInstance();
-    QString path(sysCat->getDbDirPath() + "/" + tableName + ".txt");
-    QFile tableFile(path);
-    tableFile.open(QIODevice::ReadOnly | QIODevice::Text);
-    QList<SystemCatalog::attrMeta> meta = sysCat->values(tableName);
-    std::reverse(meta.begin(), meta.end());
-
-    // Show
-    QStringList headers;
-    for (const auto& a : meta) headers.append(a.attributeName);
-    tableWidget->setColumnCount(headers.size());
-    tableWidget->setHorizontalHeaderLabels(headers);
-    QTextStream in(&tableFile);
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        QStringList dataList = line.split("#");
-        int row = tableWidget->rowCount();
-        tableWidget->insertRow(row);
-        for (int i = 0; i < dataList.size(); i++) {
-            QTableWidgetItem *item = new QTableWidgetItem(dataList[i]);
-            tableWidget->setItem(row, i, item);
-        }
-    }
-    // char c;
-    // std::string line;
-    // falta completar algoritmo
-    // while (std::getline(tableFile, line)) {
-    //     std::stringstream ss(line);
-    //     // get position pointers
-    //     int i = 0;
-    //     int *posValues = new int[headers.size()];
-    //     posValues[0] = 0; i++;
-    //     while (ss.get(c)) {
-    //         if (c == '#') {
-    //             posValues[i] = ss.tellg();
-    //             i++;
-    //         }
-    //     }
-    //     ss.seekg(0, ss.beg);
-    //     for (int j = 0; j < headers.size(); ++j) {
-    //         cout <<
-    //     }
-    //     delete [] posValues;
-    // }
-    tableFile.close();
-    return true;
+    // a row the results table couldn't spill: no partial answer shown
+    QString error = resultModel->getResultSet().errorString();
+    if (error.isEmpty())
+        return true;
+    resultModel->clear();
+    warning(error, this);
+    return false;
 }
 
-bool QueryForm::exec(const QString &newTableName, const QString &tableName)
+void QueryForm::clearResults()
 {
-    if (tableName == newTableName) {
-        warning(tr("Table: %1 already exists.").arg(tableName));
-        return false;
-    }
-
-    SystemCatalog *sysCat = &SystemCatalog::getInstance();
-    QString tablePath(sysCat->getDbDirPath() + "/" + tableName + ".txt");
-    QFile tableFile(tablePath);
-    tableFile.open(QIODevice::ReadOnly | QIODevice::Text);
-    QList<SystemCatalog::attrMeta> meta = sysCat->values(tableName);
-    std::reverse(meta.begin(), meta.end());
-
-    // Write schema
-    for (const auto& m : meta) {
-        sysCat->insertTableMetadata(newTableName, m);
-    }
-    sysCat->writeToSchema(newTableName);
-
-    QString newTablePath(sysCat->getDbDirPath() + "/" + newTableName + ".txt");
-    QFile newTableToCreate(newTablePath);
-    newTableToCreate.open(QIODevice::WriteOnly | QIODevice::Text);
-
-    QTextStream in(&tableFile);
-    QTextStream out(&newTableToCreate);
-
-    QStringList headers;
-    for (const auto& a : meta) headers.append(a.attributeName);
-    tableWidget->setColumnCount(headers.size());
-    tableWidget->setHorizontalHeaderLabels(headers);
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        out << line << "\n";
-        // Show
-        QStringList dataList = line.split("#");
-        int row = tableWidget->rowCount();
-        tableWidget->insertRow(row);
-        for (int i = 0; i < dataList.size(); i++) {
-            QTableWidgetItem *item = new QTableWidgetItem(dataList[i]);
-            tableWidget->setItem(row, i, item);
-        }
-    }
-
-    tableFile.close();
-    newTableToCreate.close();
-    return true;
+    // Drops the previous result's arena in one shot
+    resultModel->clear();
 }
 
-bool QueryForm::exec(const QString &tableName, const QString &field,
-                     int optor, const QString &condition)
+void QueryForm::runQuery()
 {
-    SystemCatalog *sysCat = &SystemCatalog::getInstance();
-    QString path(sysCat->getDbDirPath() + "/" + tableName + ".txt");
-    QFile tableFile(path);
-    tableFile.open(QIODevice::ReadOnly | QIODevice::Text);
-    QList<SystemCatalog::attrMeta> meta = sysCat->values(tableName);
-    std::reverse(meta.begin(), meta.end());
-
-    int fieldPosition = 0;
-    char fieldType = ' ';
-    for (const auto& f : meta) {
-        if (f.attributeName == field) {
-            fieldPosition = f.position;
-            fieldType = f.type;
-            break;
-        }
-    }
-
-    // Handle data type mismatch
-    if (optor == 0 || optor == 1 || optor == 4 || optor == 5) {
-        if (fieldType != 'i' || fieldType != 'f' || fieldType != 'd') {
-            warning("Incompatible data types, comparison is not possible.", this);
-            return false;
+    if (!validateForm()) return;
+    clearResults();
+    QElapsedTimer timer;
+    timer.start();
+    QueryPlan plan = cachedExecutionPlan();
+    if (!plan.isValid()) return;
+    resultTabs->setCurrentWidget(ui->resultsTab);
+    // Sampled operator timing, in case the query ends up in the slow query log
+    SlowQueryLog &slowLog = SlowQueryLog::getInstance();
+    QueryProfile profile;
+    profile.sampleEvery = SlowQueryLog::sampleEvery;
+    QueryParams params = bindParameters();
+    // CREATE MATERIALIZED VIEW: kept up to date by appends to the FROM table
+    if (plan.hasClause(Types::SelectInto) && materializedView->isChecked()) {
+        QString error;
+        if (!MaterializedView::create(querySpec(), params, &error)) {
+            warning(error, this);
+            return;
         }
+        emit refreshUi();
+        return;
     }
-
-    // Show
-    QStringList headers;
-    for (const auto& a : meta) headers.append(a.attributeName);
-    tableWidget->setColumnCount(headers.size());
-    tableWidget->setHorizontalHeaderLabels(headers);
-    QTextStream in(&tableFile);
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        QStringList dataList = line.split("#");
-        // Manage operator type
-        switch (optor) {
-        // toDouble casting manages all numeric types...
-        case 0: // <
-        {
-            if (dataList[fieldPosition].toDouble() < condition.toDouble())
-                break;
-            else continue;
-        }
-        case 1: // >
-        {
-            if (dataList[fieldPosition].toDouble() > condition.toDouble())
-                break;
-            else continue;
-        }
-        case 2: // isNotEqualTo
-        {
-            if (dataList[fieldPosition] != condition)
-                break;
-            else continue;
-        }
-        case 3: // isEqualTo
-        {
-            if (dataList[fieldPosition] == condition)
-                break;
-            else continue;
-        }
-        case 4: // <=
-        {
-            if (dataList[fieldPosition].toDouble() <= condition.toDouble())
-                break;
-            else continue;
-        }
-        case 5: // >=
-        {
-            if (dataList[fieldPosition].toDouble() >= condition.toDouble())
-                break;
-            else continue;
-        }
-        case 6: // Contains
-        {
-            if (dataList[fieldPosition].contains(condition))
-                break;
-            else continue;
-        }
-        case 7: // BeginsWith
-        {
-            if (dataList[fieldPosition].startsWith(condition))
-                break;
-            else continue;
-        }
-        case 8: // EndsWith
-        {
-            if (dataList[fieldPosition].endsWith(condition))
-                break;
-            else continue;
-        }
-        case 9: // DoesNotContain
-        {
-            if (!dataList[fieldPosition].contains(condition))
-                break;
-            else continue;
-        }
-        case 10: // DoesNotBeginWith
-        {
-            if (!dataList[fieldPosition].startsWith(condition))
-                break;
-            else continue;
-        }
-        case 11: // DoesNotEndWith
-        {
-            if (!dataList[fieldPosition].endsWith(condition))
-                break;
-            else continue;
-        }
-        }
-        int row = tableWidget->rowCount();
-        tableWidget->insertRow(row);
-        for (int i = 0; i < dataList.size(); i++) {
-            QTableWidgetItem *item = new QTableWidgetItem(dataList[i]);
-            tableWidget->setItem(row, i, item);
-        }
+    // Define query templates, plan clauses' order MATTER
+    if (executeExecutionPlan(plan, params, slowLog.isEnabled() ? &profile : nullptr)) {
+        qint64 nanos = timer.nsecsElapsed();
+        if (slowLog.isSlow(nanos))
+            slowLog.append(querySpec(), params, plan, profile, nanos, resultModel->getResultSet().rowCount());
+        emit refreshUi();
     }
-    return true;
-}
-
-bool QueryForm::exec(const QString &tableName, const QString &field, int optor, const QString &condition1, const QString &condition2)
-{
-    return true;
 }
 
-bool QueryForm::exec(const QString &tableName, const QString &field, int optor)
+void QueryForm::explainQuery()
 {
-    return true;
-}
-
-bool QueryForm::exec(const QString &newTableName, const QString &tableName, const QString &field, int optor, const QString &condition)
-{
-    return true;
+    if (!validateForm()) return;
+    QueryPlan plan = cachedExecutionPlan();
+    if (!plan.isValid()) return;
+    QueryProfile profile;
+    Executor executor(plan, bindParameters());
+    executor.setSample(tableSample());
+    if (!executor.explain(profile)) {
+        warning(executor.errorString(), this);
+        return;
+    }
+    profile.operators[QueryProfile::Output].detail = tr("Results table");
+    showProfile(profile);
 }
 
-bool QueryForm::exec(const QString &newTableName, const QString &tableName, const QString &field, int optor, const QString &condition1, const QString &condition2)
+void QueryForm::analyzeQuery()
 {
-    return true;
+    if (!validateForm()) return;
+    clearResults();
+    QueryPlan plan = cachedExecutionPlan();
+    if (!plan.isValid()) return;
+    // Executes for real, SELECT INTO included
+    QueryProfile profile;
+    if (executeExecutionPlan(plan, bindParameters(), &profile, false, true)) {
+        showProfile(profile);
+        emit refreshUi();
+    }
 }
 
-bool QueryForm::exec(const QString &newTableName, const QString &tableName, const QString &field, int optor)
+void QueryForm::exportQuery()
 {
-    return true;
+    if (!validateForm()) return;
+    QueryPlan plan = cachedExecutionPlan();
+    if (!plan.isValid()) return;
+    QString filter;
+    QString path = QFileDialog::getSaveFileName(this, tr("Export Results"), plan.tableName + ".csv",
+        tr("CSV files (*.csv);;Megatron binary files (*.mtb)"), &filter);
+    if (path.isEmpty()) return;
+    ExportSink::Format format = path.endsWith(".mtb") || filter.contains("*.mtb")
+        ? ExportSink::Binary : ExportSink::Csv;
+    QByteArray types;
+    for (int p : plan.projection) types.append(plan.meta.at(p).type);
+    ExportSink sink(path, format, types);
+    if (!sink.open()) {
+        warning(sink.errorString(), this);
+        return;
+    }
+    static Metrics::Counter &rowsExported = Metrics::getInstance().counter(
+        "megatron_export_rows_total", "Result rows written to export files");
+    clearResults();
+    // straight from the executor to the file, no result cache
+    Executor executor(plan, bindParameters());
+    if (!executor.run(sink)) {
+        warning(executor.errorString(), this);
+        return;
+    }
+    if (!sink.errorString().isEmpty()) {
+        warning(sink.errorString(), this);
+        return;
+    }
+    rowsExported.add(sink.getRowCount());
+    if (plan.hasClause(Types::SelectInto))
+        emit refreshUi();
+    QMessageBox::information(this, tr("Export Results"),
+                             tr("%1 rows written to %2").arg(sink.getRowCount()).arg(path));
 }
 
-bool QueryForm::exec(const QStringList &attributes, const QString &tableName)
+void QueryForm::countQuery()
 {
-    return true;
+    if (!validateForm()) return;
+    QueryPlan plan = cachedExecutionPlan();
+    if (!plan.isValid()) return;
+    Executor executor(plan, bindParameters());
+    qint64 rows;
+    if (!executor.count(rows)) {
+        warning(executor.errorString(), this);
+        return;
+    }
+    QMessageBox::information(this, tr("Count"), tr("%1 rows in %2").arg(rows).arg(plan.tableName));
 }
 
-bool QueryForm::exec(const QStringList &attributes, const QString &newTableName, const QString &tableName)
+void QueryForm::estimateQuery()
 {
-    return true;
+    if (!validateForm()) return;
+    TableSample sample = tableSample();
+    if (!sample.isSampling()) {
+        warning(tr("Pick a TABLESAMPLE method to estimate from."), this);
+        return;
+    }
+    QueryPlan plan = cachedExecutionPlan();
+    if (!plan.isValid()) return;
+    Executor executor(plan, bindParameters());
+    executor.setSample(sample);
+    SampleEstimate estimate;
+    if (!executor.estimate(estimate)) {
+        warning(executor.errorString(), this);
+        return;
+    }
+    QLocale locale;
+    auto value = [&locale](const SampleEstimate::Value &v) {
+        return tr("%1 ± %2").arg(locale.toString(v.estimate, 'f', 2), locale.toString(v.margin, 'f', 2));
+    };
+    QStringList lines;
+    lines.append(tr("TABLESAMPLE %1: %2 rows read, %3 matching")
+                     .arg(sample.describe(), locale.toString(estimate.getScannedRows()),
+                          locale.toString(estimate.getMatchedRows())));
+    lines.append(tr("COUNT(*) ≈ %1").arg(value(estimate.count())));
+    const QStringList columns = estimate.getColumns();
+    for (int c = 0; c < columns.size(); ++c) {
+        lines.append(tr("SUM(%1) ≈ %2").arg(columns.at(c), value(estimate.sum(c))));
+        lines.append(tr("AVG(%1) ≈ %2").arg(columns.at(c), value(estimate.average(c))));
+    }
+    lines.append(tr("95% confidence intervals."));
+    QMessageBox::information(this, tr("Estimate"), lines.join("\n"));
 }
 
-bool QueryForm::exec(const QStringList &attributes, const QString &tableName, const QString &field, int optor, const QString &condition)
+void QueryForm::showProfile(const QueryProfile &profile)
 {
-    return true;
+    QLocale locale;
+    auto count = [&locale, &profile](qint64 n) {
+        return profile.analyzed ? locale.toString(n) : QString();
+    };
+    planTree->clear();
+    QTreeWidgetItem *root = new QTreeWidgetItem(planTree);
+    root->setText(0, profile.analyzed ? tr("Query (analyzed)") : tr("Query"));
+    root->setText(1, normalizedQuery());
+    if (profile.analyzed) {
+        root->setText(2, locale.toString(profile.nanos / 1e6, 'f', 3));
+        if (profile.pagesHit >= 0) {
+            root->setText(6, locale.toString(profile.pagesHit));
+            root->setText(7, locale.toString(profile.pagesMissed));
+        }
+        if (profile.heapBytes >= 0)
+            root->setText(8, locale.formattedDataSize(profile.heapBytes));
+    }
+    // Output on top, Scan as the innermost child
+    QTreeWidgetItem *parent = root;
+    for (int i = QueryProfile::OperatorCount - 1; i >= 0; --i) {
+        const OperatorStats &op = profile.operators[i];
+        if (op.name.isEmpty())
+            continue;
+        QTreeWidgetItem *item = new QTreeWidgetItem(parent);
+        item->setText(0, op.name);
+        item->setText(1, op.detail);
+        if (profile.analyzed)
+            item->setText(2, locale.toString(op.nanos / 1e6, 'f', 3));
+        item->setText(3, count(op.rowsIn));
+        item->setText(4, count(op.rowsOut));
+        if (op.bytes > 0)
+            item->setText(5, locale.toString(op.bytes));
+        for (int c = 2; c <= 8; ++c)
+            item->setTextAlignment(c, Qt::AlignRight | Qt::AlignVCenter);
+        parent = item;
+    }
+    planTree->expandAll();
+    for (int c = 0; c < planTree->columnCount(); ++c)
+        planTree->resizeColumnToContents(c);
+    resultTabs->setCurrentWidget(ui->planTab);
 }
 
-bool QueryForm::exec(const QStringList &attributes, const QString &tableName, const QString &field, int optor, const QString &condition1, const QString &condition2)
+void QueryForm::clear()
 {
-    return true;
+    // Clear all
+    resultModel->clear();
+    attrInput->clear();
+    tableInput->clear();
+    newTableInput->clear();
+    columnInput->clear();
+    firstCond->clear();
+    secondCond->clear();
+    removeConditions();
 }
 
-bool QueryForm::exec(const QStringList &attributes, const QString &tableName, const QString &field, int optor)
+void QueryForm::addCondition()
 {
-    return true;
+    ConditionRow row;
+    row.connective = new QComboBox(this);
+    row.connective->addItems({"AND", "OR"});
+    row.connective->setToolTip(tr("AND binds tighter than OR"));
+    row.column = new QLineEdit(this);
+    row.column->setSizePolicy(columnInput->sizePolicy());
+    row.column->setToolTip(columnInput->toolTip());
+    row.optor = new QComboBox(this);
+    for (int i = 0; i < comparisonOperator->count(); ++i)
+        row.optor->addItem(comparisonOperator->itemText(i));
+    row.optor->setSizePolicy(comparisonOperator->sizePolicy());
+    row.optor->setMinimumSize(comparisonOperator->minimumSize());
+    row.optor->setMaximumSize(comparisonOperator->maximumSize());
+    row.optor->setToolTip(comparisonOperator->toolTip());
+    row.first = new QLineEdit(this);
+    row.first->setSizePolicy(firstCond->sizePolicy());
+    row.first->setToolTip(firstCond->toolTip());
+    row.second = new QLineEdit(this);
+    row.second->setSizePolicy(secondCond->sizePolicy());
+    row.second->setToolTip(secondCond->toolTip());
+    row.second->setVisible(false);
+    row.remove = new QToolButton(this);
+    row.remove->setText("-");
+    row.remove->setToolTip(tr("Remove this condition"));
+
+    QVBoxLayout *conds = new QVBoxLayout;
+    conds->addWidget(row.first);
+    conds->addWidget(row.second);
+    QHBoxLayout *layout = new QHBoxLayout;
+    layout->addWidget(row.column);
+    layout->addWidget(row.optor);
+    layout->addLayout(conds);
+    layout->addWidget(row.remove);
+    conditionLayout->addRow(row.connective, layout);
+
+    connectOperator(row);
+    connect(row.remove, &QToolButton::clicked, this, [this, remove = row.remove]() {
+        removeCondition(remove);
+    });
+    conditionRows.append(row);
 }
 
-bool QueryForm::exec(const QStringList &attributes, const QString &newTableName, const QString &tableName, const QString &field, int optor, const QString &condition)
+void QueryForm::removeCondition(QToolButton *remove)
 {
-    return true;
+    for (qsizetype i = 1; i < conditionRows.size(); ++i) {
+        const ConditionRow &row = conditionRows.at(i);
+        if (row.remove != remove)
+            continue;
+        QFormLayout::TakeRowResult taken = conditionLayout->takeRow(row.connective);
+        delete taken.labelItem;
+        delete taken.fieldItem;
+        // the button may be the one being clicked
+        const QList<QWidget *> widgets = { row.connective, row.column, row.optor,
+                                           row.first, row.second, row.remove };
+        for (QWidget *w : widgets) {
+            w->hide();
+            w->deleteLater();
+        }
+        conditionRows.removeAt(i);
+        return;
+    }
 }
 
-bool QueryForm::exec(const QStringList &attributes, const QString &newTableName, const QString &tableName, const QString &field, int optor, const QString &condition1, const QString &condition2)
+void QueryForm::removeConditions()
 {
-    return true;
+    while (conditionRows.size() > 1)
+        removeCondition(conditionRows.last().remove);
 }
 
-bool QueryForm::exec(const QStringList &attributes, const QString &newTableName, const QString &tableName, const QString &field, int optor)
+void QueryForm::connectOperator(const ConditionRow &row)
 {
-    return true;
+    QLineEdit *first = row.first;
+    QLineEdit *second = row.second;
+    connect(row.optor, &QComboBox::currentIndexChanged, this, [first, second](int index) {
+        switch (index) {
+        case 0: case 1: case 2: case 3: case 4: case 5:
+        case 6: case 7: case 8: case 9: case 10: case 11:
+        {
+            first->clear();
+            first->setVisible(true);
+            second->clear();
+            second->setVisible(false);
+            break;
+        }
+        case 12: case 13: case 14: case 15:
+        {
+            first->clear();
+            first->setVisible(false);
+            second->clear();
+            second->setVisible(false);
+            break;
+        }
+        case 16: case 17:
+        {
+            first->clear();
+            first->setVisible(true);
+            second->clear();
+            second->setVisible(true);
+            break;
+        }
+        }
+    });
 }
 
 void QueryForm::createActions()
@@ -618,47 +606,36 @@ void QueryForm::createActions()
         comparisonOperator->setEnabled(ret);
         firstCond->setEnabled(ret);
         secondCond->setEnabled(ret);
+        ui->addConditionButton->setEnabled(ret);
         columnInput->clear();
         firstCond->clear();
         secondCond->clear();
+        removeConditions();
     });
 
-    connect(comparisonOperator, &QComboBox::currentIndexChanged, this, [this](int index) {
-        switch (index) {
-        case 0: case 1: case 2: case 3: case 4: case 5:
-        case 6: case 7: case 8: case 9: case 10: case 11:
-        {
-            firstCond->clear();
-            firstCond->setVisible(true);
-            secondCond->clear();
-            secondCond->setVisible(false);
-            break;
-        }
-        case 12: case 13: case 14: case 15:
-        {
-            firstCond->clear();
-            firstCond->setVisible(false);
-            secondCond->clear();
-            secondCond->setVisible(false);
-            break;
-        }
-        case 16: case 17:
-        {
-            firstCond->clear();
-            firstCond->setVisible(true);
-            secondCond->clear();
-            secondCond->setVisible(true);
-            break;
-        }
-        }
-    });
+    connectOperator(conditionRows.first());
+    ui->addConditionButton->setEnabled(false);
+    connect(ui->addConditionButton, &QToolButton::clicked, this, &QueryForm::addCondition);
 
     newTableInput->setEnabled(false);
+    intoRowsOutput->setEnabled(false);
+    materializedView->setEnabled(false);
+    samplePercent->setEnabled(false);
+    connect(sampleMethod, &QComboBox::currentIndexChanged, this, [this](int index) {
+        samplePercent->setEnabled(index != TableSample::None);
+    });
     connect(selectIntoClause, &QCheckBox::stateChanged, this, [this](int state) {
         newTableInput->setEnabled(state == Qt::Checked ? true : false);
+        intoRowsOutput->setEnabled(state == Qt::Checked ? true : false);
+        materializedView->setEnabled(state == Qt::Checked ? true : false);
     });
 
     connect(ui->runButton, &QPushButton::clicked, this, &QueryForm::runQuery);
+    connect(ui->explainButton, &QPushButton::clicked, this, &QueryForm::explainQuery);
+    connect(ui->analyzeButton, &QPushButton::clicked, this, &QueryForm::analyzeQuery);
+    connect(ui->exportButton, &QPushButton::clicked, this, &QueryForm::exportQuery);
+    connect(ui->countButton, &QPushButton::clicked, this, &QueryForm::countQuery);
+    connect(ui->estimateButton, &QPushButton::clicked, this, &QueryForm::estimateQuery);
     connect(ui->clearButton, &QPushButton::clicked, this, &QueryForm::clear);
     // tabWidget->centralwidget->Megatron
     connect(this, SIGNAL(refreshUi()), parent()->parent()->parent(), SLOT(loadTableTree()));
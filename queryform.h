@@ -4,9 +4,20 @@
 #include <QLineEdit>
 #include <QCheckBox>
 #include <QComboBox>
-#include <QTableWidget>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QToolButton>
+#include <QTableView>
+#include <QTabWidget>
+#include <QTreeWidget>
 #include <QWidget>
 
+#include "queryplan.h"
+#include "resultmodel.h"
+#include "sampling.h"
+
+struct QueryProfile;
+
 namespace Ui {
 class QueryForm;
 }
@@ -22,9 +33,21 @@ public:
     void warning(const QString& message, QWidget* parent = nullptr);
     // Just superficial validation
     bool validateForm();
-    // Generate sequence to follow
-    QString generateExecutionPlan();
-    bool executeExecutionPlan(const QString& plan);
+    // What the form asks for, before resolving it
+    QuerySpec querySpec() const;
+    // Query text with constants replaced by '?', key of the PlanCache
+    QString normalizedQuery() const;
+    // Generate sequence to follow (prepared, without constants)
+    QueryPlan generateExecutionPlan();
+    // Constants from the form for the plan's placeholders
+    QueryParams bindParameters() const;
+    // TABLESAMPLE picked in the form, None if the whole table is read
+    TableSample tableSample() const;
+    // A profile gets the executor's counters (left untouched on a result cache hit),
+    // analyze (EXPLAIN ANALYZE) times every operator, SELECT INTO fast paths off
+    bool executeExecutionPlan(const QueryPlan& plan, const QueryParams& params,
+                              QueryProfile* profile = nullptr, bool useResultCache = true,
+                              bool analyze = false);
 
 signals:
     void refreshUi();
@@ -33,10 +56,20 @@ private slots:
     void insertRecord();
     void deleteRecord();
     void clear();
+    // One more WHERE condition row, combined with AND/OR
+    void addCondition();
 
 public slots:
     // query logic
     void runQuery();
+    void explainQuery();
+    void analyzeQuery();
+    // Rows streamed to a file (COPY TO), the results table stays empty
+    void exportQuery();
+    // COUNT(*) of the query, no row shown
+    void countQuery();
+    // Approximate aggregates from the table sample
+    void estimateQuery();
 
 private:
     Ui::QueryForm *ui;
@@ -49,44 +82,38 @@ private:
     QLineEdit* secondCond;
     QCheckBox* selectIntoClause;
     QLineEdit* newTableInput;
-    QTableWidget* tableWidget;
-
-    // Actual execution according to response
-    bool exec(const QString &tableName);
-    bool exec(const QString &newTableName, const QString &tableName);
-    bool exec(const QString &tableName, const QString &field, int optor,
-              const QString &condition);
-    bool exec(const QString &tableName, const QString &field, int optor,
-              const QString &condition1, const QString &condition2);
-    bool exec(const QString &tableName, const QString &field, int optor);
-    bool exec(const QString &newTableName, const QString &tableName,
-              const QString &field, int optor, const QString &condition);
-    bool exec(const QString &newTableName, const QString &tableName,
-              const QString &field, int optor, const QString &condition1,
-              const QString &condition2);
-    bool exec(const QString &newTableName, const QString &tableName,
-              const QString &field, int optor);
-
-    bool exec(const QStringList &attributes, const QString &tableName);
-    bool exec(const QStringList &attributes, const QString &newTableName,
-              const QString &tableName);
-    bool exec(const QStringList &attributes, const QString &tableName,
-              const QString &field, int optor, const QString &condition);
-    bool exec(const QStringList &attributes, const QString &tableName,
-              const QString &field, int optor, const QString &condition1,
-              const QString &condition2);
-    bool exec(const QStringList &attributes, const QString &tableName,
-              const QString &field, int optor);
-    bool exec(const QStringList &attributes, const QString &newTableName,
-              const QString &tableName, const QString &field, int optor,
-              const QString &condition);
-    bool exec(const QStringList &attributes, const QString &newTableName,
-              const QString &tableName, const QString &field, int optor,
-              const QString &condition1, const QString &condition2);
-    bool exec(const QStringList &attributes, const QString &newTableName,
-              const QString &tableName, const QString &field, int optor);
+    QCheckBox* intoRowsOutput;
+    QCheckBox* materializedView;
+    QComboBox* sampleMethod;
+    QDoubleSpinBox* samplePercent;
+    QTableView* tableView;
+    ResultModel* resultModel;
+    QTabWidget* resultTabs;
+    QTreeWidget* planTree;
+    // WHERE conditions, the first one is the .ui row (no connective nor remove button)
+    struct ConditionRow {
+        QComboBox* connective = nullptr;
+        QLineEdit* column = nullptr;
+        QComboBox* optor = nullptr;
+        QLineEdit* first = nullptr;
+        QLineEdit* second = nullptr;
+        QToolButton* remove = nullptr;
+    };
+    QList<ConditionRow> conditionRows;
+    QFormLayout* conditionLayout;
 
     void createActions();
+    // Condition inputs shown according to the operator picked
+    void connectOperator(const ConditionRow& row);
+    void removeCondition(QToolButton* remove);
+    void removeConditions();
+    // From the PlanCache if an equally shaped query was prepared before
+    QueryPlan cachedExecutionPlan();
+    void clearResults();
+    // false, results cleared and a warning shown, if rows were lost spilling
+    bool resultsComplete();
+    // Operator tree in the Plan tab, data flows from the leaf (Scan) up
+    void showProfile(const QueryProfile& profile);
 };
 
 #endif // QUERYFORM_H
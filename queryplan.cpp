@@ -0,0 +1,196 @@
+#include "queryplan.h"
+
+#include <QCoreApplication>
+
+static QString tr(const char *sourceText)
+{
+    return QCoreApplication::translate("QueryPlan", sourceText);
+}
+
+QString QuerySpec::normalized() const
+{
+    QString query = "SELECT " + attributes.join(", ");
+    if (into)
+        query += " INTO ?";
+    query += " FROM " + tableName;
+    for (qsizetype i = 0; where && i < conditions.size(); ++i) {
+        const Condition &c = conditions.at(i);
+        query += i == 0 ? " WHERE " : c.orPrevious ? " OR " : " AND ";
+        query += QString("%1 %2").arg(c.field, QueryPlan::operatorName(c.optor));
+        switch (c.optor) {
+        case 12: case 13: case 14: case 15:
+            break;
+        case 16: case 17:
+            query += " ? AND ?";
+            break;
+        default:
+            query += " ?";
+        }
+    }
+    return query;
+}
+
+QString QueryPlan::operatorName(int optor)
+{
+    static const char *const names[] = {
+        "<", ">", "isNotEqualTo", "isEqualTo", "≤", "≥",
+        "Contains", "BeginsWith", "EndsWith",
+        "DoesNotContain", "DoesNotBeginWith", "DoesNotEndWith",
+        "IsNull", "IsNotNull", "IsEmpty", "IsNotEmpty",
+        "Between", "NotBetween"
+    };
+    if (optor < 0 || optor >= int(sizeof(names) / sizeof(names[0])))
+        return QString::number(optor);
+    return QString::fromUtf8(names[optor]);
+}
+
+QueryPlan QueryPlan::prepare(const QuerySpec &spec, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error) *error = message;
+        return QueryPlan();
+    };
+    QueryPlan plan;
+    QString clauses;
+    SystemCatalog *sysCat = &SystemCatalog::getInstance();
+    const QStringList &attributes = spec.attributes;
+
+    // FROM: get table information
+    const QString &tableName = spec.tableName;
+    auto table = sysCat->find(tableName);
+    // If table not found in schema
+    if (table == sysCat->end())
+        return fail(tr("Table: %1 not found in schema.").arg(tableName));
+    plan.tableName = tableName;
+    plan.catalogVersion = sysCat->getVersion();
+    plan.meta = sysCat->values(tableName);
+    std::reverse(plan.meta.begin(), plan.meta.end());
+    auto positionOf = [&plan](const QString& name) {
+        for (const auto& m : std::as_const(plan.meta))
+            if (m.attributeName == name)
+                return m.position;
+        return -1;
+    };
+
+    // SELECT - SelectAll: '*' case
+    if (attributes.size() == 1) {
+        if (attributes.contains("*"))
+            clauses.append((char)Types::SelectAll);
+        else
+            clauses.append((char)Types::SelectCustom);
+    }
+    // SELECT - SelectCustom: custom attributes
+    else {
+        if (attributes.isEmpty() || attributes.contains("") || attributes.contains("*"))
+            return fail(tr("Attributes field: Bad syntax."));
+        clauses.append((char)Types::SelectCustom);
+    }
+    // Seek for specified attribute(s) 'position'
+    if (clauses.at(0) == QChar((char)Types::SelectAll)) {
+        for (const auto& m : std::as_const(plan.meta))
+            plan.projection.append(m.position);
+    }
+    else {
+        for (const auto& a : attributes) {
+            int pos = positionOf(a);
+            if (pos < 0)
+                return fail(tr("Attribute: %1 not found in %2.").arg(a, tableName));
+            plan.projection.append(pos);
+        }
+    }
+    // INTO:
+    if (spec.into)
+        clauses.append((char)Types::SelectInto);
+    // WHERE:
+    if (spec.where) {
+        if (spec.conditions.isEmpty())
+            return fail(tr("WHERE clause without conditions."));
+        for (const auto& c : spec.conditions) {
+            Predicate predicate;
+            predicate.fieldPosition = positionOf(c.field);
+            if (predicate.fieldPosition < 0)
+                return fail(tr("Column: %1 not found in %2.").arg(c.field, tableName));
+            predicate.fieldType = plan.meta.at(predicate.fieldPosition).type;
+            predicate.optor = c.optor;
+            predicate.orPrevious = c.orPrevious && !plan.predicates.isEmpty();
+            // Handle data type mismatch
+            switch (predicate.optor) {
+            case 0: case 1: case 4: case 5: case 16: case 17:
+            {
+                switch (predicate.fieldType) {
+                case 'i': case 'f': case 'd': case 't':
+                    break;
+                default:
+                    return fail(tr("Incompatible data types, comparison is not possible on %1.").arg(c.field));
+                }
+                break;
+            }
+            }
+            plan.predicates.append(predicate);
+        }
+        clauses.append((char)Types::Where);
+    }
+    // End of executionPlan
+    plan.clauses = clauses;
+    return plan;
+}
+
+QString QueryPlan::canonical(const QueryParams &params) const
+{
+    QStringList positions;
+    for (int p : projection) positions.append(QString::number(p));
+    // ASCII unit separator, can't be part of a name nor typed as a condition
+    QStringList parts = { clauses, tableName, positions.join(',') };
+    for (qsizetype i = 0; i < predicates.size(); ++i) {
+        const Predicate &p = predicates.at(i);
+        QueryParams::Operands operands = params.conditions.value(i);
+        parts << (p.orPrevious ? "|" : "&") << QString::number(p.fieldPosition)
+              << QString::number(p.optor) << operands.condition1 << operands.condition2;
+    }
+    return parts.join(QChar(0x1F));
+}
+
+PlanCache::PlanCache(int capacity)
+    : plans(capacity)
+{
+}
+
+const QueryPlan *PlanCache::find(const QString &key)
+{
+    // QCache::object() also marks the entry as most recently used
+    QueryPlan *plan = plans.object(key);
+    if (!plan)
+        return nullptr;
+    // Catalog changed since the plan was prepared: table/attributes may be gone
+    if (plan->catalogVersion != SystemCatalog::getInstance().getVersion()) {
+        plans.remove(key);
+        return nullptr;
+    }
+    return plan;
+}
+
+void PlanCache::insert(const QString &key, const QueryPlan &plan)
+{
+    // every plan costs 1, so maxCost is the number of cached plans
+    plans.insert(key, new QueryPlan(plan));
+}
+
+void PlanCache::clear()
+{
+    plans.clear();
+}
+
+void PlanCache::setCapacity(int capacity)
+{
+    plans.setMaxCost(capacity);
+}
+
+int PlanCache::getCapacity() const
+{
+    return plans.maxCost();
+}
+
+int PlanCache::getSize() const
+{
+    return plans.size();
+}
@@ -0,0 +1,93 @@
+#ifndef QUERYPLAN_H
+#define QUERYPLAN_H
+
+#include "systemcatalog.h"
+#include "megatron_types.h"
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QCache>
+
+// A query as described in a QueryForm, before resolving it
+struct QuerySpec {
+    QStringList attributes;                     // selected attributes, or just "*"
+    QString tableName;
+    bool into = false;
+    bool where = false;
+    // WHERE field optor ? [AND|OR field optor ?]..., AND binds tighter than OR
+    struct Condition {
+        QString field;
+        int optor = -1;                         // operatorComboBox index
+        bool orPrevious = false;                // OR (else AND) with the previous condition
+    };
+    QList<Condition> conditions;
+
+    // Query text with constants replaced by '?'
+    QString normalized() const;
+};
+
+// Values bound to a QueryPlan's placeholders
+struct QueryParams {
+    QString newTableName;                       // INTO ?
+    struct Operands {
+        QString condition1;                     // WHERE field optor ?
+        QString condition2;                     // Between/NotBetween upper limit
+    };
+    QList<Operands> conditions;                 // one per WHERE condition, same order
+};
+
+// Prepared statement: everything resolved from the form and SystemCatalog
+// once, constants are left out as '?' placeholders and bound at execution
+struct QueryPlan {
+    QString clauses;                            // Types::QueryClauses sequence, e.g. "AW", "CIW"
+    QString tableName;
+    QList<SystemCatalog::attrMeta> meta;        // table attributes, ordered by position
+    QList<int> projection;                      // positions (in meta) of the selected attributes
+    struct Predicate {                          // a resolved QuerySpec::Condition
+        int fieldPosition = -1;
+        char fieldType = ' ';
+        int optor = -1;
+        bool orPrevious = false;
+    };
+    QList<Predicate> predicates;                // WHERE, empty if there is no WHERE clause
+    quint64 catalogVersion = 0;                 // SystemCatalog version the plan was resolved with
+
+    // Resolves the spec against the SystemCatalog, invalid plan + error on failure
+    static QueryPlan prepare(const QuerySpec &spec, QString *error = nullptr);
+    // operatorComboBox labels
+    static QString operatorName(int optor);
+
+    bool isValid() const { return !clauses.isEmpty(); }
+    // Canonical text of the plan with its parameters bound, used as ResultCache key
+    QString canonical(const QueryParams &params) const;
+    bool hasClause(Types::QueryClauses c) const { return clauses.contains(QChar(char(c))); }
+};
+
+// PlanCache will be a Singleton
+// LRU of prepared plans keyed by normalized query text, entries resolved
+// against an older catalog version are dropped on lookup
+
+class PlanCache
+{
+public:
+    static PlanCache& getInstance()
+    {
+        static PlanCache singleton;
+        return singleton;
+    }
+
+    const QueryPlan *find(const QString &);
+    void insert(const QString &, const QueryPlan &);
+    void clear();
+    void setCapacity(int);
+    int getCapacity() const;
+    int getSize() const;
+
+private:
+    PlanCache(int capacity = 128);
+    QCache<QString, QueryPlan> plans;
+    Q_DISABLE_COPY(PlanCache)
+};
+
+#endif // QUERYPLAN_H
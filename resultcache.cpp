@@ -0,0 +1,98 @@
+#include "resultcache.h"
+#include "systemcatalog.h"
+
+ResultCache::ResultCache(qsizetype maxBytes)
+    : results(maxBytes)
+{
+}
+
+bool ResultCache::isEnabled() const
+{
+    return enabled;
+}
+
+void ResultCache::setEnabled(bool e)
+{
+    enabled = e;
+    if (!enabled)
+        results.clear();
+}
+
+const CachedResult *ResultCache::find(const QString &key)
+{
+    if (!enabled)
+        return nullptr;
+    CachedResult *result = results.object(key);
+    if (!result)
+        return nullptr;
+    // Table was written since the result was produced
+    if (result->tableVersion != SystemCatalog::getInstance().getTableVersion(result->tableName)) {
+        results.remove(key);
+        return nullptr;
+    }
+    return result;
+}
+
+bool ResultCache::insert(const QString &key, CachedResult *result, qsizetype cost)
+{
+    // QCache takes ownership, deletes result right away if cost > maxCost
+    return results.insert(key, result, cost);
+}
+
+void ResultCache::clear()
+{
+    results.clear();
+}
+
+void ResultCache::setMaxBytes(qsizetype maxBytes)
+{
+    results.setMaxCost(maxBytes);
+}
+
+qsizetype ResultCache::getMaxBytes() const
+{
+    return results.maxCost();
+}
+
+CachingSink::CachingSink(RowSink &next, const QString &tableName, qsizetype budget)
+    : next(next)
+    , result(new CachedResult)
+    , budget(budget)
+{
+    result->tableName = tableName;
+    result->tableVersion = SystemCatalog::getInstance().getTableVersion(tableName);
+}
+
+void CachingSink::begin(const QStringList &headers)
+{
+    if (result)
+        result->rows.reset(headers);
+    next.begin(headers);
+}
+
+void CachingSink::row(const Row &fields)
+{
+    if (result) {
+        result->rows.append(fields);
+        cost = result->rows.memoryUsage();
+        // too big, or incomplete
+        if (cost > budget || !result->rows.errorString().isEmpty())
+            result.reset();
+    }
+    next.row(fields);
+}
+
+void CachingSink::end()
+{
+    next.end();
+}
+
+CachedResult *CachingSink::take()
+{
+    return result.release();
+}
+
+qsizetype CachingSink::getCost() const
+{
+    return cost;
+}
@@ -0,0 +1,69 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include "executor.h"
+#include "resultset.h"
+
+#include <QString>
+#include <QStringList>
+#include <QCache>
+
+#include <memory>
+
+struct CachedResult {
+    QString tableName;
+    quint64 tableVersion = 0;                   // SystemCatalog table version rows were read at
+    ResultSet rows;                             // decoded, UTF-8
+};
+
+// ResultCache will be a Singleton
+// Optional (disabled by default), bounded by an approximate byte budget.
+// Keyed by QueryPlan::canonical(), an entry is dropped on lookup once its
+// table's version moved (insert, delete, SELECT INTO, reload)
+
+class ResultCache
+{
+public:
+    static ResultCache& getInstance()
+    {
+        static ResultCache singleton;
+        return singleton;
+    }
+
+    bool isEnabled() const;
+    void setEnabled(bool);
+    const CachedResult *find(const QString &);
+    bool insert(const QString &, CachedResult *, qsizetype);
+    void clear();
+    void setMaxBytes(qsizetype);
+    qsizetype getMaxBytes() const;
+
+private:
+    ResultCache(qsizetype maxBytes = 64 * 1024 * 1024);
+    // cost of each entry is its approximate size in bytes
+    QCache<QString, CachedResult> results;
+    bool enabled = false;
+    Q_DISABLE_COPY(ResultCache)
+};
+
+// Forwards rows to another sink while keeping a copy for the ResultCache,
+// stops copying once the result can't fit in the cache anyway
+class CachingSink : public RowSink
+{
+public:
+    CachingSink(RowSink &next, const QString &tableName, qsizetype budget);
+    void begin(const QStringList &headers) override;
+    void row(const Row &fields) override;
+    void end() override;
+    // nullptr if the result outgrew the budget
+    CachedResult *take();
+    qsizetype getCost() const;
+
+private:
+    RowSink &next;
+    std::unique_ptr<CachedResult> result;
+    qsizetype cost = 0;
+    qsizetype budget;
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,64 @@
+#include "resultmodel.h"
+
+#include <limits>
+
+ResultModel::ResultModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+int ResultModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return int(qMin(results.rowCount(), qsizetype(std::numeric_limits<int>::max())));
+}
+
+int ResultModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(results.columnCount());
+}
+
+QVariant ResultModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || role != Qt::DisplayRole)
+        return QVariant();
+    return QString::fromUtf8(results.cell(index.row(), index.column()));
+}
+
+QVariant ResultModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+    if (orientation == Qt::Horizontal)
+        return results.getHeaders().value(section);
+    return section + 1;
+}
+
+void ResultModel::begin(const QStringList &headers)
+{
+    beginResetModel();
+    results.reset(headers);
+}
+
+void ResultModel::row(const Row &fields)
+{
+    results.append(fields);
+}
+
+void ResultModel::end()
+{
+    endResetModel();
+}
+
+void ResultModel::clear()
+{
+    beginResetModel();
+    results.reset(QStringList());
+    endResetModel();
+}
+
+const ResultSet &ResultModel::getResultSet() const
+{
+    return results;
+}
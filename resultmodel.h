@@ -0,0 +1,37 @@
+#ifndef RESULTMODEL_H
+#define RESULTMODEL_H
+
+#include "executor.h"
+#include "resultset.h"
+
+#include <QAbstractTableModel>
+
+// Results table of a QueryForm: the Executor's rows land in a ResultSet,
+// cells only become QStrings when the view paints them
+
+class ResultModel : public QAbstractTableModel, public RowSink
+{
+    Q_OBJECT
+
+public:
+    explicit ResultModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+
+    // RowSink, the view is refreshed once at end()
+    void begin(const QStringList &headers) override;
+    void row(const Row &fields) override;
+    void end() override;
+
+    void clear();
+    const ResultSet &getResultSet() const;
+
+private:
+    ResultSet results;
+};
+
+#endif // RESULTMODEL_H
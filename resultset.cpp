@@ -0,0 +1,194 @@
+#include "resultset.h"
+#include "metrics.h"
+
+#include <cstring>
+#include <new>
+
+ResultSet::~ResultSet()
+{
+    unmapSpill();
+    if (charged)
+        currentBudget()->release(charged);
+}
+
+void ResultSet::setBudget(MemoryBudget *b)
+{
+    if (charged) {
+        currentBudget()->release(charged);
+        charged = 0;
+    }
+    budget = b;
+}
+
+MemoryBudget *ResultSet::currentBudget()
+{
+    if (budget)
+        return budget;
+    if (!ownBudget)
+        ownBudget = std::make_unique<MemoryBudget>();
+    return ownBudget.get();
+}
+
+void ResultSet::reset(const QStringList &h)
+{
+    blocks.clear();
+    cells = 0;
+    arena.release();
+    headers = h;
+    if (charged)
+        currentBudget()->release(charged);
+    used = charged = 0;
+    unmapSpill();
+    spill.reset();
+    spillOffsets.clear();
+    error.clear();
+}
+
+void ResultSet::append(const Row &fields)
+{
+    // once a row spilled every later one does, rows stay in order;
+    // none after one that couldn't be written
+    if (!error.isEmpty())
+        return;
+    if (spill) {
+        spillRow(fields);
+        return;
+    }
+    qint64 cost = headers.size() * qint64(sizeof(QByteArrayView));
+    for (const auto& f : fields)
+        cost += f.size();
+    if (used + cost > charged) {
+        qint64 step = qMax(chargeStep, used + cost - charged);
+        if (currentBudget()->reserve(step))
+            charged += step;
+        // without a temporary file, over budget rather than without the row
+        else if (spillRow(fields) || !error.isEmpty())
+            return;
+    }
+    used += cost;
+    // rows shorter than the headers get empty cells
+    for (qsizetype i = 0; i < headers.size(); ++i) {
+        qsizetype slot = cells % cellsPerBlock;
+        if (slot == 0) {
+            void *p = arena.allocate(cellsPerBlock * qsizetype(sizeof(QByteArrayView)),
+                                     alignof(QByteArrayView));
+            blocks.append(static_cast<QByteArrayView *>(p));
+        }
+        QByteArrayView value = i < fields.size() ? fields.at(i) : QByteArrayView();
+        new (blocks.last() + slot) QByteArrayView(arena.copy(value));
+        cells++;
+    }
+}
+
+void ResultSet::replay(RowSink &sink) const
+{
+    sink.begin(headers);
+    Row fields;
+    for (qsizetype r = 0; r < rowCount(); ++r) {
+        fields.clear();
+        for (qsizetype c = 0; c < headers.size(); ++c)
+            fields.append(cell(r, c));
+        sink.row(fields);
+    }
+    sink.end();
+}
+
+const QStringList &ResultSet::getHeaders() const
+{
+    return headers;
+}
+
+bool ResultSet::spillRow(const Row &fields)
+{
+    static Metrics::Counter &spills = Metrics::getInstance().counter(
+        "megatron_result_spills_total", "Result sets that outgrew their memory budget");
+    static Metrics::Counter &spilledBytes = Metrics::getInstance().counter(
+        "megatron_spilled_bytes_total", "Bytes written to temporary files by spilling operators");
+    if (!spill) {
+        spill = std::make_unique<QTemporaryFile>();
+        if (!spill->open()) {
+            spill.reset();
+            return false;
+        }
+        spills.add();
+    }
+    unmapSpill();
+    QByteArray record;
+    for (qsizetype i = 0; i < headers.size(); ++i) {
+        QByteArrayView value = i < fields.size() ? fields.at(i) : QByteArrayView();
+        quint32 size = quint32(value.size());
+        record.append(reinterpret_cast<const char *>(&size), sizeof(size));
+        record.append(value);
+    }
+    qint64 offset = spill->pos();
+    // disk full: the query fails rather than answer without the row
+    if (spill->write(record) != record.size()) {
+        error = tr("Error while writing result spill file: %1").arg(spill->errorString());
+        return false;
+    }
+    spillOffsets.append(offset);
+    spilledBytes.add(record.size());
+    return true;
+}
+
+void ResultSet::unmapSpill() const
+{
+    if (spillMap) {
+        spill->unmap(spillMap);
+        spillMap = nullptr;
+        spillMapSize = 0;
+    }
+}
+
+qsizetype ResultSet::rowCount() const
+{
+    return (headers.isEmpty() ? 0 : cells / headers.size()) + spillOffsets.size();
+}
+
+qsizetype ResultSet::spilledRows() const
+{
+    return spillOffsets.size();
+}
+
+QString ResultSet::errorString() const
+{
+    return error;
+}
+
+qsizetype ResultSet::columnCount() const
+{
+    return headers.size();
+}
+
+QByteArrayView ResultSet::cell(qsizetype row, qsizetype column) const
+{
+    qsizetype memoryRows = headers.isEmpty() ? 0 : cells / headers.size();
+    if (row < memoryRows) {
+        qsizetype i = row * headers.size() + column;
+        return blocks.at(i / cellsPerBlock)[i % cellsPerBlock];
+    }
+    if (!spillMap) {
+        if (!spill->flush() || spill->size() == 0)
+            return QByteArrayView();
+        spillMapSize = spill->size();
+        spillMap = spill->map(0, spillMapSize);
+        if (!spillMap)
+            return QByteArrayView();
+    }
+    // walk the length prefixed fields up to 'column'
+    const uchar *p = spillMap + spillOffsets.at(row - memoryRows);
+    quint32 size;
+    for (qsizetype c = 0; ; ++c) {
+        std::memcpy(&size, p, sizeof(size));
+        p += sizeof(size);
+        if (c == column)
+            return QByteArrayView(reinterpret_cast<const char *>(p), size);
+        p += size;
+    }
+}
+
+qsizetype ResultSet::memoryUsage() const
+{
+    return qsizetype(arena.getReserved()) + blocks.size() * qsizetype(sizeof(void *)) +
+           spillOffsets.size() * qsizetype(sizeof(qint64));
+}
@@ -0,0 +1,72 @@
+#ifndef RESULTSET_H
+#define RESULTSET_H
+
+#include "executor.h"
+#include "queryarena.h"
+#include "memorygovernor.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QList>
+#include <QTemporaryFile>
+
+#include <memory>
+
+// Rows of a query result kept in a QueryArena: one copy of each field's
+// UTF-8 bytes plus a view per cell, no allocation per row or per field.
+// reset() drops the previous result in one shot.
+// The arena is charged to a MemoryBudget: once it refuses, the rows left
+// go to a temporary file (length prefixed fields), mapped to read them
+// back, so a huge result costs disk and page cache instead of heap.
+
+class ResultSet
+{
+    Q_DECLARE_TR_FUNCTIONS(ResultSet)
+public:
+    ResultSet() = default;
+    ~ResultSet();
+    // Budget the rows are charged to, shared by the result sets of a
+    // query; null (default): one of its own, MemoryGovernor's query limit
+    void setBudget(MemoryBudget *budget);
+    void reset(const QStringList &headers);
+    void append(const Row &fields);
+    // Sends every row to 'sink' (begin, row..., end)
+    void replay(RowSink &sink) const;
+
+    const QStringList &getHeaders() const;
+    qsizetype rowCount() const;
+    qsizetype columnCount() const;
+    QByteArrayView cell(qsizetype row, qsizetype column) const;
+    // Bytes held, arena chunks and block index
+    qsizetype memoryUsage() const;
+    // Rows in the temporary file, the budget having run out
+    qsizetype spilledRows() const;
+    // Not empty if a row couldn't be spilled, the result is then incomplete
+    QString errorString() const;
+
+private:
+    // cells are allocated by blocks, never moved once written
+    static constexpr qsizetype cellsPerBlock = 4096;
+    // budget taken by so many bytes at a time
+    static constexpr qint64 chargeStep = 1024 * 1024;
+    QStringList headers;
+    QueryArena arena;
+    QList<QByteArrayView *> blocks;
+    qsizetype cells = 0;
+    MemoryBudget *budget = nullptr;
+    std::unique_ptr<MemoryBudget> ownBudget;
+    qint64 used = 0;                            // row bytes in the arena, approximate
+    qint64 charged = 0;                         // reserved from the budget
+    std::unique_ptr<QTemporaryFile> spill;      // rows past the budget, in order
+    QList<qint64> spillOffsets;                 // of each spilled row
+    mutable uchar *spillMap = nullptr;          // mapped on first read
+    mutable qint64 spillMapSize = 0;
+    QString error;
+
+    MemoryBudget *currentBudget();
+    bool spillRow(const Row &fields);
+    void unmapSpill() const;
+    Q_DISABLE_COPY(ResultSet)
+};
+
+#endif // RESULTSET_H
@@ -0,0 +1,517 @@
+#include "rowfilter.h"
+
+#include <QStringList>
+#include <QVarLengthArray>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <chrono>
+
+static qint64 clockNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool RowFilter::isNumericOperator(int optor)
+{
+    switch (optor) {
+    case 0: case 1: case 4: case 5: case 16: case 17:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool RowFilter::isNullOperator(int optor)
+{
+    return optor >= 12 && optor <= 15;
+}
+
+double RowFilter::Predicate::cost() const
+{
+    return evaluated > 0 ? nanos / evaluated : estimate;
+}
+
+double RowFilter::Predicate::selectivity() const
+{
+    // starts at 1/2, follows the measures once rows went through
+    return (passed + 1) / (evaluated + 2);
+}
+
+QString RowFilter::errorString() const
+{
+    return error;
+}
+
+bool RowFilter::bind(const QueryPlan &plan, const QueryParams &params, const TableCodec &c,
+                     const ZoneMap *z, const TrigramIndex *t, const InvertedIndex *i,
+                     const BitmapIndex *b)
+{
+    codec = c;
+    zoneMap = z;
+    trigramIndex = zoneMap ? t : nullptr;
+    invertedIndex = i;
+    // empty values come from the zone map
+    bitmapIndex = zoneMap ? b : nullptr;
+    blanks = zoneMap && zoneMap->hasBlanks();
+    predicates.clear();
+    groups.clear();
+    for (qsizetype i = 0; i < plan.predicates.size(); ++i) {
+        const QueryPlan::Predicate &planned = plan.predicates.at(i);
+        Predicate p;
+        p.position = planned.fieldPosition;
+        p.optor = planned.optor;
+        p.index = int(i);
+        if (!bindPredicate(p, params.conditions.value(i)))
+            return false;
+        // a new AND group after each OR
+        if (groups.isEmpty() || planned.orPrevious)
+            groups.append(QList<int>());
+        groups.last().append(int(predicates.size()));
+        predicates.append(p);
+    }
+    reorder();
+    return true;
+}
+
+bool RowFilter::bindPredicate(Predicate &p, const QueryParams::Operands &operands)
+{
+    p.condition = operands.condition1.toUtf8();
+    p.needle = Needle(p.condition);
+    bool ok = true;
+    switch (p.optor) {
+    case 0: case 1: case 4: case 5:
+    {
+        p.lower = operands.condition1.toDouble(&ok);
+        break;
+    }
+    case 16: case 17:
+    {
+        bool upperOk;
+        p.lower = operands.condition1.toDouble(&ok);
+        p.upper = operands.condition2.toDouble(&upperOk);
+        ok = ok && upperOk;
+        break;
+    }
+    }
+    if (!ok) {
+        error = tr("Condition field needs to be a digit.");
+        return false;
+    }
+
+    p.zoneLower = p.lower;
+    p.zoneUpper = p.upper;
+    p.numericZones = zoneMap && isNumericOperator(p.optor) && zoneMap->isNumeric(p.position);
+
+    // Evaluate on encoded values where possible
+    p.encoding = codec.encoding(p.position);
+    p.emptyMatches = matches(p, QByteArrayView());
+    switch (p.encoding) {
+    case TableCodec::Dictionary:
+    {
+        // once per distinct value instead of once per row
+        for (const auto& v : codec.column(p.position).utf8)
+            p.codeMatches.append(matches(p, v));
+        break;
+    }
+    case TableCodec::FrameOfReference:
+    {
+        // shift the bounds instead of decoding every value
+        if (isNumericOperator(p.optor)) {
+            p.lower -= codec.column(p.position).base;
+            p.upper -= codec.column(p.position).base;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    // blocks lacking one of the needle's trigrams can't contain it
+    if (p.optor == 6 && p.encoding == TableCodec::Plain && trigramIndex &&
+        trigramIndex->hasColumn(p.position))
+        p.trigrams = TrigramIndex::trigrams(p.condition);
+    p.indexed = p.optor == 6 && p.encoding == TableCodec::Plain && invertedIndex &&
+                invertedIndex->hasColumn(p.position);
+    // once per distinct value, the rows then come from their bitmaps
+    if (bitmapIndex && bitmapIndex->hasColumn(p.position) && !isNullOperator(p.optor)) {
+        const QList<QByteArray> values = bitmapIndex->getValues(p.position);
+        QList<int> passing, failing;
+        for (qsizetype id = 0; id < values.size(); ++id)
+            (testValue(p, values.at(id)) ? passing : failing).append(int(id));
+        p.bitmapComplement = failing.size() < passing.size();
+        p.bitmapValues = p.bitmapComplement ? failing : passing;
+        p.bitmaps = true;
+    }
+
+    // Rough nanoseconds per row, until the scan measures it
+    switch (p.optor) {
+    case 6: case 9:
+        p.estimate = p.encoding == TableCodec::Dictionary ? 4 : 20;
+        break;
+    case 12: case 13: case 14: case 15:
+        p.estimate = 2;
+        break;
+    default:
+        p.estimate = p.encoding == TableCodec::Dictionary ? 4 : 6;
+    }
+    return true;
+}
+
+bool RowFilter::test(const Predicate &p, const Row &fields, qint64 row) const
+{
+    if (isNullOperator(p.optor)) {
+        // missing trailing fields are empty too
+        bool empty = p.position >= fields.size() || fields.at(p.position).isEmpty();
+        bool null = empty && !(blanks && zoneMap->isBlank(row, p.position));
+        switch (p.optor) {
+        case 12: return null;                                   // IsNull
+        case 13: return !null;                                  // IsNotNull
+        case 14: return empty;                                  // IsEmpty
+        default: return !empty;                                 // IsNotEmpty
+        }
+    }
+    if (p.position >= fields.size())
+        return false;
+    return testValue(p, fields.at(p.position));
+}
+
+bool RowFilter::testValue(const Predicate &p, QByteArrayView value) const
+{
+    if (p.encoding == TableCodec::Plain)
+        return matches(p, value);
+    if (value.isEmpty())
+        return p.emptyMatches;
+    switch (p.encoding) {
+    case TableCodec::Dictionary:
+        return p.codeMatches.value(value.toInt(), false);
+    case TableCodec::FrameOfReference:
+    {
+        if (isNumericOperator(p.optor))
+            return matches(p, value);
+        return matches(p, codec.decode(p.position, value, buffer));
+    }
+    default:
+        return matches(p, value);
+    }
+}
+
+bool RowFilter::matches(const Predicate &p, QByteArrayView value) const
+{
+    // UTF-8 bytes compare/search the same as the decoded strings would
+    // Manage operator type
+    const QByteArray &condition = p.condition;
+    switch (p.optor) {
+    // toDouble casting manages all numeric types...
+    case 0:  return value.toDouble() < p.lower;             // <
+    case 1:  return value.toDouble() > p.lower;             // >
+    case 2:  return value != QByteArrayView(condition);     // isNotEqualTo
+    case 3:  return value == QByteArrayView(condition);     // isEqualTo
+    case 4:  return value.toDouble() <= p.lower;            // <=
+    case 5:  return value.toDouble() >= p.lower;            // >=
+    case 6:  return p.needle.containedIn(value);            // Contains
+    case 7:  return p.needle.prefixOf(value);               // BeginsWith
+    case 8:  return p.needle.suffixOf(value);               // EndsWith
+    case 9:  return !p.needle.containedIn(value);           // DoesNotContain
+    case 10: return !p.needle.prefixOf(value);              // DoesNotBeginWith
+    case 11: return !p.needle.suffixOf(value);              // DoesNotEndWith
+    // without the row NULL and '' can't be told apart, both are empty
+    case 12: case 14: return value.isEmpty();               // IsNull, IsEmpty
+    case 13: case 15: return !value.isEmpty();              // IsNotNull, IsNotEmpty
+    case 16:                                                // Between
+    {
+        double v = value.toDouble();
+        return v >= p.lower && v <= p.upper;
+    }
+    case 17:                                                // NotBetween
+    {
+        double v = value.toDouble();
+        return v < p.lower || v > p.upper;
+    }
+    }
+    return false;
+}
+
+bool RowFilter::usesZoneMap() const
+{
+    for (const auto& p : predicates)
+        if (p.numericZones || !p.trigrams.isEmpty() || (zoneMap && isNullOperator(p.optor)) || p.bitmaps)
+            return true;
+    return false;
+}
+
+bool RowFilter::usesBitmapIndex() const
+{
+    for (const auto& p : predicates)
+        if (p.bitmaps)
+            return true;
+    return false;
+}
+
+bool RowFilter::bitmapRows(const Predicate &p, qsizetype block, QList<quint64> &rows) const
+{
+    const ZoneMap::Block &b = zoneMap->getBlocks().at(block);
+    const ZoneMap::Zone &zone = b.zones.at(p.position);
+    if (zone.nulls > 0 && zone.nullBits.isEmpty())
+        return false;
+    rows.fill(0, ZoneMap::wordsPerBlock);
+    bitmapIndex->unite(block, p.position, p.bitmapValues, rows);
+    for (qsizetype w = 0; w < ZoneMap::wordsPerBlock; ++w) {
+        qint64 present = qBound(qint64(0), b.rows - w * 64, qint64(64));
+        quint64 valid = present == 64 ? ~quint64(0) : (quint64(1) << present) - 1;
+        quint64 empty = zone.nullBits.value(w);
+        quint64 word = p.bitmapComplement ? valid & ~rows.at(w) & ~empty : rows.at(w);
+        rows[w] = p.emptyMatches ? word | empty : word;
+    }
+    return true;
+}
+
+bool RowFilter::candidates(QList<qint64> &rows) const
+{
+    rows.clear();
+    if (!invertedIndex)
+        return false;
+    for (const auto& group : groups) {
+        // the rows of a group are in those of each of its indexed predicates
+        QList<qint64> groupRows;
+        bool indexed = false;
+        for (int i : group) {
+            const Predicate &p = predicates.at(i);
+            QList<qint64> termRows;
+            if (!p.indexed || !invertedIndex->candidates(p.position, p.condition, termRows))
+                continue;
+            groupRows = indexed ? InvertedIndex::intersect(groupRows, termRows) : termRows;
+            indexed = true;
+        }
+        if (!indexed)
+            return false;
+        rows = InvertedIndex::unite(rows, groupRows);
+    }
+    return true;
+}
+
+bool RowFilter::mayMatch(const Predicate &p, qsizetype b) const
+{
+    if (!p.trigrams.isEmpty())
+        return trigramIndex->mayContain(b, p.position, p.trigrams);
+    const ZoneMap::Block &block = zoneMap->getBlocks().at(b);
+    const ZoneMap::Zone &zone = block.zones.at(p.position);
+    if (isNullOperator(p.optor)) {
+        switch (p.optor) {
+        case 12: case 14: return zone.nulls > 0;            // IsNull, IsEmpty
+        case 13: return zone.nulls < block.rows || !zone.blankBits.isEmpty();
+        default: return zone.nulls < block.rows;            // IsNotEmpty
+        }
+    }
+    if (!p.numericZones)
+        return true;
+    // empty values compare as 0
+    if (zone.nulls > 0 && p.emptyMatches)
+        return true;
+    // a zone without values has min > max, fails every check
+    switch (p.optor) {
+    case 0:  return zone.min < p.zoneLower;                 // <
+    case 1:  return zone.max > p.zoneLower;                 // >
+    case 4:  return zone.min <= p.zoneLower;                // <=
+    case 5:  return zone.max >= p.zoneLower;                // >=
+    case 16: return zone.max >= p.zoneLower && zone.min <= p.zoneUpper;     // Between
+    case 17: return zone.min < p.zoneLower || zone.max > p.zoneUpper;       // NotBetween
+    }
+    return true;
+}
+
+bool RowFilter::mayMatch(qsizetype block) const
+{
+    for (const auto& group : groups) {
+        bool may = true;
+        for (int i : group)
+            may = may && mayMatch(predicates.at(i), block);
+        if (may)
+            return true;
+    }
+    return groups.isEmpty();
+}
+
+qint64 RowFilter::select(qsizetype block, QList<quint64> &rows, bool &exact) const
+{
+    if (!zoneMap)
+        return -1;
+    const ZoneMap::Block &b = zoneMap->getBlocks().at(block);
+    rows.fill(0, ZoneMap::wordsPerBlock);
+    QList<quint64> groupRows;
+    QList<quint64> words;
+    bool any = false;
+    exact = true;
+    for (const auto& group : groups) {
+        // rows of the block, narrowed by the group's null predicates
+        groupRows.resize(ZoneMap::wordsPerBlock);
+        for (qsizetype w = 0; w < ZoneMap::wordsPerBlock; ++w) {
+            qint64 present = qBound(qint64(0), b.rows - w * 64, qint64(64));
+            groupRows[w] = present == 64 ? ~quint64(0) : (quint64(1) << present) - 1;
+        }
+        for (int i : group) {
+            const Predicate &p = predicates.at(i);
+            if (p.bitmaps) {
+                if (!bitmapRows(p, block, words)) {
+                    exact = false;
+                    continue;
+                }
+            }
+            else if (!isNullOperator(p.optor)) {
+                exact = false;
+                continue;
+            }
+            else if (zoneMap->select(block, p.position, p.optor, words) < 0)
+                return -1;
+            any = true;
+            for (qsizetype w = 0; w < ZoneMap::wordsPerBlock; ++w)
+                groupRows[w] &= words.at(w);
+        }
+        for (qsizetype w = 0; w < ZoneMap::wordsPerBlock; ++w)
+            rows[w] |= groupRows.at(w);
+    }
+    if (!any)
+        return -1;
+    qint64 selected = 0;
+    for (quint64 w : std::as_const(rows))
+        selected += qPopulationCount(w);
+    return selected;
+}
+
+int RowFilter::applyGroup(const QList<int> &group, const Row *rows, const qint64 *rowNumbers,
+                          int *selection, int n)
+{
+    for (int i : group) {
+        if (n == 0)
+            break;
+        Predicate &p = predicates[i];
+        qint64 started = clockNanos();
+        int kept = 0;
+        for (int k = 0; k < n; ++k) {
+            int r = selection[k];
+            if (test(p, rows[r], rowNumbers[r]))
+                selection[kept++] = r;
+        }
+        p.nanos += clockNanos() - started;
+        p.evaluated += n;
+        p.passed += kept;
+        n = kept;
+    }
+    return n;
+}
+
+int RowFilter::apply(const Row *rows, const qint64 *rowNumbers, int *selection, int n)
+{
+    int kept = 0;
+    if (groups.size() == 1) {
+        kept = applyGroup(groups.first(), rows, rowNumbers, selection, n);
+    }
+    else {
+        // a row accepted by a group isn't seen by the following ones
+        QVarLengthArray<bool, batchRows> accepted(batchRows);
+        std::fill(accepted.begin(), accepted.end(), false);
+        QVarLengthArray<int, batchRows> remaining(selection, selection + n);
+        QVarLengthArray<int, batchRows> alive;
+        for (const auto& group : std::as_const(groups)) {
+            if (remaining.isEmpty())
+                break;
+            alive = remaining;
+            int passed = applyGroup(group, rows, rowNumbers, alive.data(), int(alive.size()));
+            for (int k = 0; k < passed; ++k)
+                accepted[alive[k]] = true;
+            qsizetype left = 0;
+            for (int r : std::as_const(remaining))
+                if (!accepted[r])
+                    remaining[left++] = r;
+            remaining.resize(left);
+        }
+        for (int k = 0; k < n; ++k)
+            if (accepted[selection[k]])
+                selection[kept++] = selection[k];
+    }
+    // forget the oldest measures, the data may change along the table
+    for (auto& p : predicates) {
+        if (p.evaluated > 64.0 * batchRows) {
+            p.evaluated /= 2;
+            p.passed /= 2;
+            p.nanos /= 2;
+        }
+    }
+    reorder();
+    return kept;
+}
+
+void RowFilter::reorder()
+{
+    // AND: ascending cost / (1 - selectivity), the cheapest way to drop rows first
+    auto rank = [this](int i) {
+        const Predicate &p = predicates.at(i);
+        return p.cost() / qMax(1e-9, 1 - p.selectivity());
+    };
+    for (auto& group : groups)
+        std::stable_sort(group.begin(), group.end(), [&rank](int a, int b) {
+            return rank(a) < rank(b);
+        });
+    if (groups.size() < 2)
+        return;
+    // OR: ascending expected cost / probability to accept a row
+    auto groupRank = [this](const QList<int> &group) {
+        double reach = 1;
+        double cost = 0;
+        for (int i : group) {
+            cost += reach * predicates.at(i).cost();
+            reach *= predicates.at(i).selectivity();
+        }
+        return cost / qMax(1e-9, reach);
+    };
+    std::stable_sort(groups.begin(), groups.end(), [&groupRank](const QList<int> &a, const QList<int> &b) {
+        return groupRank(a) < groupRank(b);
+    });
+}
+
+QString RowFilter::describe(const QueryPlan &plan, const QueryParams &params) const
+{
+    QStringList ored;
+    for (const auto& group : groups) {
+        QStringList anded;
+        for (int i : group) {
+            const Predicate &p = predicates.at(i);
+            QueryParams::Operands operands = params.conditions.value(p.index);
+            QString text = QString("%1 %2").arg(plan.meta.at(p.position).attributeName,
+                                                QueryPlan::operatorName(p.optor));
+            if (p.optor == 16 || p.optor == 17)
+                text += QString(" %1 AND %2").arg(operands.condition1, operands.condition2);
+            else if (!isNullOperator(p.optor))
+                text += " " + operands.condition1;
+            QStringList notes;
+            switch (p.encoding) {
+            case TableCodec::Dictionary:
+                if (!isNullOperator(p.optor))
+                    notes.append(tr("on dictionary codes, %1 of %2 match")
+                        .arg(p.codeMatches.count(true)).arg(p.codeMatches.size()));
+                break;
+            case TableCodec::FrameOfReference:
+                if (isNumericOperator(p.optor))
+                    notes.append(tr("bounds shifted by base %1").arg(codec.column(p.position).base));
+                break;
+            default:
+                break;
+            }
+            if (!p.trigrams.isEmpty())
+                notes.append(tr("trigram index"));
+            if (p.indexed)
+                notes.append(tr("inverted index"));
+            if (p.bitmaps)
+                notes.append(p.bitmapComplement ? tr("bitmap index, NOT %1 values").arg(p.bitmapValues.size())
+                                                : tr("bitmap index, %1 values").arg(p.bitmapValues.size()));
+            if (p.evaluated > 0)
+                notes.append(tr("%1% pass, %2 ns/row")
+                    .arg(100 * p.passed / p.evaluated, 0, 'f', 1).arg(p.cost(), 0, 'f', 1));
+            if (!notes.isEmpty())
+                text += " [" + notes.join(", ") + "]";
+            anded.append(text);
+        }
+        ored.append(anded.join(" AND "));
+    }
+    return ored.join(groups.size() > 1 ? " OR " : "");
+}
@@ -0,0 +1,122 @@
+#ifndef ROWFILTER_H
+#define ROWFILTER_H
+
+#include "queryplan.h"
+#include "columncodec.h"
+#include "tablefile.h"
+#include "zonemap.h"
+#include "trigramindex.h"
+#include "invertedindex.h"
+#include "bitmapindex.h"
+#include "needle.h"
+
+#include <QCoreApplication>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+
+// WHERE clause of an Executor: an OR of AND groups of predicates, evaluated
+// on encoded rows a batch at a time. Every predicate narrows a selection
+// vector (indexes of the batch rows still alive), the next one only sees
+// the survivors. After each batch, predicates and groups are reordered from
+// the cost and selectivity measured so far: cheap and selective first.
+
+class RowFilter
+{
+    Q_DECLARE_TR_FUNCTIONS(RowFilter)
+public:
+    static constexpr int batchRows = 1024;
+
+    // Converts the conditions once per execution, 'zoneMap' (null if there
+    // is no valid one) tells NULL from '' and allows skipping blocks, so
+    // does 'trigramIndex' (null if none matches the zone map) for Contains,
+    // 'invertedIndex' (null if not valid) names the rows it may match,
+    // 'bitmapIndex' (null if none matches the zone map) the rows of the
+    // values a predicate on its columns accepts
+    bool bind(const QueryPlan &plan, const QueryParams &params, const TableCodec &codec,
+              const ZoneMap *zoneMap, const TrigramIndex *trigramIndex = nullptr,
+              const InvertedIndex *invertedIndex = nullptr, const BitmapIndex *bitmapIndex = nullptr);
+    // Rows that may satisfy the clause, sorted, from the inverted index:
+    // false unless every OR group has an indexed Contains
+    bool candidates(QList<qint64> &rows) const;
+    // Some predicate can skip zone map blocks
+    bool usesZoneMap() const;
+    // Some predicate gets its rows from the bitmap index
+    bool usesBitmapIndex() const;
+    // false if no row of zone map block 'block' can satisfy the WHERE clause
+    bool mayMatch(qsizetype block) const;
+    // Rows of zone map block 'block' the null bitmaps and the bitmap index
+    // let through, as ZoneMap::wordsPerBlock words: AND within a group, OR
+    // across groups. Returns their count, -1 if no predicate has a bitmap;
+    // 'exact' if the bitmaps decide the whole clause
+    qint64 select(qsizetype block, QList<quint64> &rows, bool &exact) const;
+    // Keeps the entries of selection[0, n) (indexes < batchRows in 'rows'
+    // and 'rowNumbers') whose row satisfies the clause, in order, returns
+    // how many are left
+    int apply(const Row *rows, const qint64 *rowNumbers, int *selection, int n);
+    // Predicates in evaluation order, with what was measured once run
+    QString describe(const QueryPlan &plan, const QueryParams &params) const;
+    QString errorString() const;
+
+    static bool isNumericOperator(int optor);
+    // IsNull, IsNotNull, IsEmpty, IsNotEmpty: answered by null bitmaps
+    static bool isNullOperator(int optor);
+
+private:
+    struct Predicate {
+        int position = -1;
+        int optor = -1;
+        int index = 0;                          // in QueryPlan::predicates
+        // numeric conditions, converted once per execution instead of per row
+        double lower = 0;
+        double upper = 0;
+        // same, as plain values (lower/upper get shifted for encoded columns)
+        double zoneLower = 0;
+        double zoneUpper = 0;
+        QByteArray condition;                   // UTF-8, as stored in table files
+        Needle needle;                          // condition, for operators 6-11
+        QList<quint32> trigrams;                // Contains: looked up in the trigram index
+        bool indexed = false;                   // Contains: rows looked up in the inverted index
+        TableCodec::Encoding encoding = TableCodec::Plain;
+        // Dictionary column: predicate result per code, evaluated in bind()
+        QList<bool> codeMatches;
+        bool emptyMatches = false;
+        // Bitmap index column: ids of the values passing, or of the ones
+        // failing if fewer (the block's other non-empty rows then pass)
+        QList<int> bitmapValues;
+        bool bitmapComplement = false;
+        bool bitmaps = false;
+        bool numericZones = false;              // zone map min/max can be checked
+        // over the rows it was evaluated on, halved now and then to follow the data
+        double evaluated = 0;
+        double passed = 0;
+        double nanos = 0;
+        double estimate = 0;                    // nanoseconds per row until measured
+
+        double cost() const;                    // nanoseconds per row
+        double selectivity() const;             // fraction of the rows passing
+    };
+    QList<Predicate> predicates;
+    QList<QList<int>> groups;                   // indexes in predicates, evaluation order
+    TableCodec codec;
+    const ZoneMap *zoneMap = nullptr;
+    const TrigramIndex *trigramIndex = nullptr;
+    const InvertedIndex *invertedIndex = nullptr;
+    const BitmapIndex *bitmapIndex = nullptr;
+    bool blanks = false;                        // zone map has '' values
+    mutable QByteArray buffer;                  // decoded value, reused by every row
+    QString error;
+
+    bool bindPredicate(Predicate &p, const QueryParams::Operands &operands);
+    bool test(const Predicate &p, const Row &fields, qint64 row) const;     // encoded row
+    bool testValue(const Predicate &p, QByteArrayView value) const;         // encoded value
+    // Rows of block 'block' passing 'p', false if the zone map lacks its null bitmap
+    bool bitmapRows(const Predicate &p, qsizetype block, QList<quint64> &rows) const;
+    bool matches(const Predicate &p, QByteArrayView value) const;           // plain value
+    bool mayMatch(const Predicate &p, qsizetype block) const;
+    int applyGroup(const QList<int> &group, const Row *rows, const qint64 *rowNumbers,
+                   int *selection, int n);
+    void reorder();
+};
+
+#endif // ROWFILTER_H
@@ -0,0 +1,156 @@
+#include "sampling.h"
+
+#include <QtMath>
+
+namespace {
+
+// splitmix64 finalizer, every bit of the input moves about half of the output's
+quint64 mix(quint64 x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+}
+
+bool TableSample::draws(qint64 unit) const
+{
+    // top 53 bits, uniform in [0, 1)
+    double u = double(mix(quint64(unit) ^ (quint64(seed) << 32)) >> 11) / double(quint64(1) << 53);
+    return u < fraction();
+}
+
+qint64 TableSample::drawRows(qint64 firstRow, QList<quint64> &rows) const
+{
+    qint64 left = 0;
+    for (qsizetype w = 0; w < rows.size(); ++w) {
+        quint64 word = rows.at(w);
+        for (quint64 bits = word; bits; bits &= bits - 1) {
+            int b = qCountTrailingZeroBits(bits);
+            if (!draws(firstRow + w * 64 + b))
+                word &= ~(quint64(1) << b);
+        }
+        rows[w] = word;
+        left += qPopulationCount(word);
+    }
+    return left;
+}
+
+QString TableSample::describe() const
+{
+    switch (method) {
+    case Bernoulli: return tr("BERNOULLI (%1%)").arg(percent);
+    case Block: return tr("BLOCK (%1%)").arg(percent);
+    default: return QString();
+    }
+}
+
+TableSample TableSample::forPartition(int id) const
+{
+    TableSample partition = *this;
+    partition.seed = quint32(mix((quint64(seed) << 32) | quint32(id)) >> 32);
+    return partition;
+}
+
+SampleEstimate::SampleEstimate(const TableSample &sample, const QStringList &columns)
+    : fraction(sample.isSampling() ? sample.fraction() : 1.0)
+    , columns(columns)
+    , sums(columns.size(), 0.0)
+    , sumSquares(columns.size(), 0.0)
+    , values(columns.size(), 0)
+    , valueSquares(columns.size(), 0.0)
+    , products(columns.size(), 0.0)
+{
+}
+
+void SampleEstimate::addUnit(qint64 rows, const QList<double> &unitSums, const QList<qint64> &unitValues)
+{
+    matched += rows;
+    countSquares += double(rows) * rows;
+    for (qsizetype c = 0; c < sums.size(); ++c) {
+        double s = unitSums.value(c);
+        qint64 n = unitValues.value(c);
+        sums[c] += s;
+        sumSquares[c] += s * s;
+        values[c] += n;
+        valueSquares[c] += double(n) * n;
+        products[c] += n * s;
+    }
+}
+
+void SampleEstimate::addScanned(qint64 rows)
+{
+    scanned += rows;
+}
+
+void SampleEstimate::merge(const SampleEstimate &other)
+{
+    scanned += other.scanned;
+    matched += other.matched;
+    countSquares += other.countSquares;
+    for (qsizetype c = 0; c < sums.size() && c < other.sums.size(); ++c) {
+        sums[c] += other.sums.at(c);
+        sumSquares[c] += other.sumSquares.at(c);
+        values[c] += other.values.at(c);
+        valueSquares[c] += other.valueSquares.at(c);
+        products[c] += other.products.at(c);
+    }
+}
+
+QStringList SampleEstimate::getColumns() const
+{
+    return columns;
+}
+
+qint64 SampleEstimate::getScannedRows() const
+{
+    return scanned;
+}
+
+qint64 SampleEstimate::getMatchedRows() const
+{
+    return matched;
+}
+
+double SampleEstimate::margin(double squares) const
+{
+    if (fraction <= 0)
+        return 0;
+    return z95 * qSqrt(qMax(0.0, squares) * (1 - fraction)) / fraction;
+}
+
+SampleEstimate::Value SampleEstimate::count() const
+{
+    Value v;
+    if (fraction <= 0)
+        return v;
+    v.estimate = matched / fraction;
+    v.margin = margin(countSquares);
+    return v;
+}
+
+SampleEstimate::Value SampleEstimate::sum(int column) const
+{
+    Value v;
+    if (fraction <= 0 || column < 0 || column >= sums.size())
+        return v;
+    v.estimate = sums.at(column) / fraction;
+    v.margin = margin(sumSquares.at(column));
+    return v;
+}
+
+SampleEstimate::Value SampleEstimate::average(int column) const
+{
+    Value v;
+    if (column < 0 || column >= sums.size() || values.at(column) == 0)
+        return v;
+    qint64 n = values.at(column);
+    double r = sums.at(column) / n;
+    // residuals of the units' sums around r times their non-empty values
+    double squares = sumSquares.at(column) - 2 * r * products.at(column) + r * r * valueSquares.at(column);
+    v.estimate = r;
+    v.margin = margin(squares) / (n / fraction);
+    return v;
+}
@@ -0,0 +1,84 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+// TABLESAMPLE: the part of a table a scan reads, each row (Bernoulli) or
+// each zone map block (Block, whole blocks, far fewer pages read) drawn
+// with probability percent / 100. The draw is a hash of the seed and the
+// row or block number: the same seed draws the same sample again.
+
+struct TableSample {
+    Q_DECLARE_TR_FUNCTIONS(TableSample)
+public:
+    enum Method { None, Bernoulli, Block };
+    Method method = None;
+    double percent = 100;
+    quint32 seed = 0;
+
+    bool isSampling() const { return method != None; }
+    double fraction() const { return qBound(0.0, percent / 100, 1.0); }
+    // row or block number 'unit' is part of the sample
+    bool draws(qint64 unit) const;
+    // ANDs into 'rows' (a zone map block's selection, bit per row) the rows
+    // of the block starting at row 'firstRow' drawn, returns how many are left
+    qint64 drawRows(qint64 firstRow, QList<quint64> &rows) const;
+    // "BERNOULLI (1%)"
+    QString describe() const;
+    // the sample of partition 'id': rows and blocks are numbered from 0 in
+    // each partition, its own seed keeps the draws of partitions independent
+    TableSample forPartition(int id) const;
+};
+
+// Approximate COUNT(*), SUM and AVG over a sample, scaled to the whole
+// table. Each unit (row or block) was drawn with probability f, so the
+// estimates are its totals / f (Horvitz-Thompson), their variance
+// (1 - f) / f^2 * sum of the squared unit totals; AVG is SUM / the count
+// of the column's non-empty values, its variance linearized. Margins are
+// 95% confidence intervals, units without a matching row add nothing to
+// any sum and empty values (NULL, '') nothing to SUM nor AVG.
+
+class SampleEstimate
+{
+public:
+    struct Value {
+        double estimate = 0;
+        double margin = 0;                      // estimate +- margin, 95% confidence
+    };
+
+    SampleEstimate() = default;
+    SampleEstimate(const TableSample &sample, const QStringList &columns);
+    // one unit of the sample: its rows satisfying the WHERE clause, the
+    // sums of their values of each column and how many weren't empty
+    void addUnit(qint64 rows, const QList<double> &sums, const QList<qint64> &values);
+    // rows read, matching or not
+    void addScanned(qint64 rows);
+    // a partition's estimate, drawn with the same fraction
+    void merge(const SampleEstimate &other);
+
+    QStringList getColumns() const;
+    qint64 getScannedRows() const;
+    qint64 getMatchedRows() const;
+    Value count() const;
+    Value sum(int column) const;
+    Value average(int column) const;
+
+private:
+    static constexpr double z95 = 1.96;
+    double fraction = 1;
+    QStringList columns;                        // numeric ones, SUM and AVG
+    qint64 scanned = 0;
+    qint64 matched = 0;
+    double countSquares = 0;
+    QList<double> sums;                         // by column
+    QList<double> sumSquares;
+    QList<qint64> values;                       // non-empty ones, by column
+    QList<double> valueSquares;
+    QList<double> products;                     // unit values * unit sum
+    double margin(double squares) const;
+};
+
+#endif // SAMPLING_H
@@ -0,0 +1,124 @@
+#include "slowquerylog.h"
+#include "systemcatalog.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+SlowQueryLog::SlowQueryLog()
+{
+    bool ok;
+    threshold = qEnvironmentVariable("MEGATRON_SLOW_QUERY_MS").toLongLong(&ok);
+    if (!ok)
+        threshold = 1000;
+}
+
+void SlowQueryLog::setThreshold(qint64 ms)
+{
+    threshold = ms;
+}
+
+qint64 SlowQueryLog::getThreshold() const
+{
+    return threshold;
+}
+
+bool SlowQueryLog::isEnabled() const
+{
+    return threshold >= 0;
+}
+
+bool SlowQueryLog::isSlow(qint64 nanos) const
+{
+    return isEnabled() && nanos >= threshold * 1000000;
+}
+
+QString SlowQueryLog::getPath() const
+{
+    return QDir(SystemCatalog::getInstance().getDbDirPath()).filePath("slow_queries.log");
+}
+
+bool SlowQueryLog::append(const QuerySpec &spec, const QueryParams &params, const QueryPlan &plan,
+                          const QueryProfile &profile, qint64 nanos, qint64 rows)
+{
+    auto ms = [](qint64 n) { return n / 1e6; };
+
+    QJsonObject form;
+    form["attributes"] = QJsonArray::fromStringList(spec.attributes);
+    form["table"] = spec.tableName;
+    if (spec.into)
+        form["into"] = params.newTableName;
+    if (spec.where) {
+        QJsonArray where;
+        for (qsizetype i = 0; i < spec.conditions.size(); ++i) {
+            const QuerySpec::Condition &c = spec.conditions.at(i);
+            QueryParams::Operands operands = params.conditions.value(i);
+            QJsonObject condition;
+            if (i > 0)
+                condition["connective"] = c.orPrevious ? "OR" : "AND";
+            condition["field"] = c.field;
+            condition["operator"] = QueryPlan::operatorName(c.optor);
+            condition["condition1"] = operands.condition1;
+            if (!operands.condition2.isEmpty())
+                condition["condition2"] = operands.condition2;
+            where.append(condition);
+        }
+        form["where"] = where;
+    }
+
+    QJsonObject planInfo;
+    planInfo["clauses"] = plan.clauses;
+    planInfo["catalog_version"] = QString::number(plan.catalogVersion);
+    if (profile.analyzed) {
+        QJsonArray operators;
+        for (const auto& op : profile.operators) {
+            if (op.name.isEmpty())
+                continue;
+            QJsonObject o;
+            o["operator"] = op.name;
+            o["detail"] = op.detail;
+            o["ms"] = ms(op.nanos);
+            o["rows_in"] = op.rowsIn;
+            o["rows_out"] = op.rowsOut;
+            o["bytes"] = op.bytes;
+            operators.append(o);
+        }
+        planInfo["operators"] = operators;
+        planInfo["sample_every"] = profile.sampleEvery;
+        if (profile.pagesHit >= 0) {
+            planInfo["pages_hit"] = profile.pagesHit;
+            planInfo["pages_missed"] = profile.pagesMissed;
+        }
+    }
+
+    QJsonObject entry;
+    entry["time"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    entry["query"] = spec.normalized();
+    entry["latency_ms"] = ms(nanos);
+    entry["rows"] = rows;
+    entry["result_cache"] = !profile.analyzed;
+    entry["form"] = form;
+    entry["plan"] = planInfo;
+    if (profile.analyzed) {
+        // where the time went, what isn't here was spent outside the executor
+        const auto &ops = profile.operators;
+        QJsonObject breakdown;
+        breakdown["scan"] = ms(ops[QueryProfile::Scan].nanos + ops[QueryProfile::Split].nanos);
+        breakdown["filter"] = ms(ops[QueryProfile::Filter].nanos);
+        breakdown["project"] = ms(ops[QueryProfile::Project].nanos);
+        breakdown["into"] = ms(ops[QueryProfile::Into].nanos);
+        breakdown["ui"] = ms(ops[QueryProfile::Output].nanos);
+        entry["breakdown_ms"] = breakdown;
+    }
+
+    QFile log(getPath());
+    if (!log.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        return false;
+    QByteArray line = QJsonDocument(entry).toJson(QJsonDocument::Compact) + '\n';
+    bool ok = log.write(line) == line.size();
+    log.close();
+    return ok;
+}
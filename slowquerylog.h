@@ -0,0 +1,42 @@
+#ifndef SLOWQUERYLOG_H
+#define SLOWQUERYLOG_H
+
+#include "queryplan.h"
+#include "executor.h"
+
+#include <QString>
+
+// SlowQueryLog will be a Singleton
+// Appends the queries slower than a threshold to <db>/slow_queries.log,
+// one JSON object per line: form state, plan operators with their timing
+// breakdown, total latency and rows produced
+
+class SlowQueryLog
+{
+public:
+    static SlowQueryLog& getInstance()
+    {
+        static SlowQueryLog singleton;
+        return singleton;
+    }
+    // Operator timing sampling of queries run while the log is enabled
+    static constexpr int sampleEvery = 64;
+
+    // Milliseconds, negative disables the log
+    void setThreshold(qint64 ms);
+    qint64 getThreshold() const;
+    bool isEnabled() const;
+    bool isSlow(qint64 nanos) const;
+    QString getPath() const;
+    // 'profile' is not analyzed when the result came from the ResultCache
+    bool append(const QuerySpec &spec, const QueryParams &params, const QueryPlan &plan,
+                const QueryProfile &profile, qint64 nanos, qint64 rows);
+
+private:
+    // Initial threshold from MEGATRON_SLOW_QUERY_MS, 1000 otherwise
+    SlowQueryLog();
+    qint64 threshold;
+    Q_DISABLE_COPY(SlowQueryLog)
+};
+
+#endif // SLOWQUERYLOG_H
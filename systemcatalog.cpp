@@ -1,4 +1,19 @@
 #include "systemcatalog.h"
+#include "metrics.h"
+
+static Metrics::Counter &lookups()
+{
+    static Metrics::Counter &c = Metrics::getInstance().counter(
+        "megatron_catalog_lookups_total", "Table metadata lookups in the SystemCatalog");
+    return c;
+}
+
+static Metrics::Counter &fileOpens()
+{
+    static Metrics::Counter &c = Metrics::getInstance().counter(
+        "megatron_file_opens_total", "Table, schema and sidecar files opened");
+    return c;
+}
 
 SystemCatalog::SystemCatalog(const QString &path)
     : dbDir(path)
@@ -8,8 +23,17 @@ SystemCatalog::SystemCatalog(const QString &path)
 
 bool SystemCatalog::initSchema()
 {
-    // Read schema and load 'tables' if any
+    // Read schema and load 'tables' if any (reloading drops what was cached)
+    tables.clear();
+    codecs.clear();
+    zoneMaps.clear();
+    trigramIndexes.clear();
+    invertedIndexes.clear();
+    bitmapIndexes.clear();
+    partitionings.clear();
+    clusterings.clear();
     QFile schema(schemaPath);
+    fileOpens().add();
     if (schema.open(QIODevice::ReadOnly | QIODevice::Text) && schema.size() != 0) {
         QTextStream in(&schema);
         while (!in.atEnd()) {
@@ -33,6 +57,7 @@ bool SystemCatalog::initSchema()
                 pos++;
             }
         }
+        version++;
         return true;
     }
     return false;
@@ -43,6 +68,7 @@ Types::Return SystemCatalog::parseSchemaPath(const QString &relName,
 {
     // Parse newSchemaFile
     QFile newSchema(schemaFile);
+    fileOpens().add();
     if (!newSchema.open(QIODevice::ReadOnly | QIODevice::Text))
         return Types::OpenError;
     QTextStream in(&newSchema);
@@ -121,16 +147,19 @@ void SystemCatalog::insertTableMetadata(const QString &an, const QString &tn, ch
     attrMeta tm = { .attributeName = an, .type = t, .length = l, .position = p};
     // qDebug() << tm.attributeName << tm.type << tm.length << tm.position;
     tables.insert(tn, tm);
+    version++;
 }
 
 void SystemCatalog::insertTableMetadata(const QString &tn, const attrMeta &tm)
 {
     tables.insert(tn, tm);
+    version++;
 }
 
 void SystemCatalog::writeToSchema(const QString &relName)
 {
     QFile schema(schemaPath);
+    fileOpens().add();
     schema.open(QIODevice::Append | QIODevice::Text);
     QTextStream out(&schema);
     out << relName;
@@ -175,11 +204,13 @@ QString SystemCatalog::getDbDirPath() const
 
 QList<SystemCatalog::attrMeta> SystemCatalog::values(const QString &str)
 {
+    lookups().add();
     return tables.values(str);
 }
 
 QMultiMap<QString, SystemCatalog::attrMeta>::iterator SystemCatalog::find(const QString &str)
 {
+    lookups().add();
     return tables.find(str);
 }
 
@@ -210,3 +241,196 @@ int SystemCatalog::getSize(const QString &tableName)
     // QFile file(dbDir.filePath(tableName));
     return size;
 }
+
+quint64 SystemCatalog::getVersion() const
+{
+    return version;
+}
+
+quint64 SystemCatalog::getTableVersion(const QString &tableName) const
+{
+    return tableVersions.value(tableName, 0);
+}
+
+void SystemCatalog::bumpTableVersion(const QString &tableName)
+{
+    tableVersions[tableName]++;
+}
+
+TableCodec SystemCatalog::getCodec(const QString &tableName)
+{
+    auto it = codecs.constFind(tableName);
+    if (it != codecs.cend())
+        return *it;
+    // Missing file: every column is Plain
+    TableCodec codec;
+    fileOpens().add();
+    codec.read(dbDir.filePath(tableName + ".codec"));
+    codecs.insert(tableName, codec);
+    return codec;
+}
+
+bool SystemCatalog::setCodec(const QString &tableName, const TableCodec &codec)
+{
+    codecs.insert(tableName, codec);
+    return codec.write(dbDir.filePath(tableName + ".codec"));
+}
+
+ZoneMap SystemCatalog::getZoneMap(const QString &tableName)
+{
+    auto it = zoneMaps.constFind(tableName);
+    if (it != zoneMaps.cend())
+        return *it;
+    // Missing file: invalid map, tables are scanned entirely
+    ZoneMap zoneMap;
+    fileOpens().add();
+    zoneMap.read(dbDir.filePath(tableName + ".zmp"));
+    zoneMaps.insert(tableName, zoneMap);
+    return zoneMap;
+}
+
+bool SystemCatalog::setZoneMap(const QString &tableName, const ZoneMap &zoneMap)
+{
+    zoneMaps.insert(tableName, zoneMap);
+    return zoneMap.write(dbDir.filePath(tableName + ".zmp"));
+}
+
+TrigramIndex SystemCatalog::getTrigramIndex(const QString &tableName)
+{
+    auto it = trigramIndexes.constFind(tableName);
+    if (it != trigramIndexes.cend())
+        return *it;
+    // Missing file: no index, Contains reads every block
+    TrigramIndex index;
+    fileOpens().add();
+    index.read(dbDir.filePath(tableName + ".tri"));
+    trigramIndexes.insert(tableName, index);
+    return index;
+}
+
+bool SystemCatalog::setTrigramIndex(const QString &tableName, const TrigramIndex &index)
+{
+    trigramIndexes.insert(tableName, index);
+    QString path = dbDir.filePath(tableName + ".tri");
+    if (index.isEmpty())
+        return !QFile::exists(path) || QFile::remove(path);
+    return index.write(path);
+}
+
+InvertedIndex SystemCatalog::getInvertedIndex(const QString &tableName)
+{
+    auto it = invertedIndexes.constFind(tableName);
+    if (it != invertedIndexes.cend())
+        return *it;
+    // Missing file: no index, Contains scans
+    InvertedIndex index;
+    fileOpens().add();
+    index.read(dbDir.filePath(tableName + ".inv"));
+    invertedIndexes.insert(tableName, index);
+    return index;
+}
+
+bool SystemCatalog::setInvertedIndex(const QString &tableName, const InvertedIndex &index)
+{
+    invertedIndexes.insert(tableName, index);
+    QString path = dbDir.filePath(tableName + ".inv");
+    if (index.isEmpty())
+        return !QFile::exists(path) || QFile::remove(path);
+    return index.write(path);
+}
+
+BitmapIndex SystemCatalog::getBitmapIndex(const QString &tableName)
+{
+    auto it = bitmapIndexes.constFind(tableName);
+    if (it != bitmapIndexes.cend())
+        return *it;
+    // Missing file: no index, predicates on every row
+    BitmapIndex index;
+    fileOpens().add();
+    index.read(dbDir.filePath(tableName + ".bmx"));
+    bitmapIndexes.insert(tableName, index);
+    return index;
+}
+
+bool SystemCatalog::setBitmapIndex(const QString &tableName, const BitmapIndex &index)
+{
+    bitmapIndexes.insert(tableName, index);
+    QString path = dbDir.filePath(tableName + ".bmx");
+    if (index.isEmpty())
+        return !QFile::exists(path) || QFile::remove(path);
+    return index.write(path);
+}
+
+Partitioning SystemCatalog::getPartitioning(const QString &tableName)
+{
+    auto it = partitionings.constFind(tableName);
+    if (it != partitionings.cend())
+        return *it;
+    // Missing file: a table of its own
+    Partitioning partitioning;
+    fileOpens().add();
+    partitioning.read(dbDir.filePath(tableName + ".part"));
+    partitionings.insert(tableName, partitioning);
+    return partitioning;
+}
+
+bool SystemCatalog::setPartitioning(const QString &tableName, const Partitioning &partitioning)
+{
+    partitionings.insert(tableName, partitioning);
+    QString path = dbDir.filePath(tableName + ".part");
+    if (!partitioning.isPartitioned())
+        return !QFile::exists(path) || QFile::remove(path);
+    return partitioning.write(path);
+}
+
+Clustering SystemCatalog::getClustering(const QString &tableName)
+{
+    auto it = clusterings.constFind(tableName);
+    if (it != clusterings.cend())
+        return *it;
+    // Missing file: rows in arrival order
+    Clustering clustering;
+    fileOpens().add();
+    clustering.read(dbDir.filePath(tableName + ".clu"));
+    clusterings.insert(tableName, clustering);
+    return clustering;
+}
+
+bool SystemCatalog::setClustering(const QString &tableName, const Clustering &clustering)
+{
+    clusterings.insert(tableName, clustering);
+    QString path = dbDir.filePath(tableName + ".clu");
+    if (!clustering.isClustered())
+        return !QFile::exists(path) || QFile::remove(path);
+    return clustering.write(path);
+}
+
+bool SystemCatalog::removeTable(const QString &tableName)
+{
+    if (!tables.contains(tableName))
+        return false;
+    tables.remove(tableName);
+    codecs.remove(tableName);
+    zoneMaps.remove(tableName);
+    trigramIndexes.remove(tableName);
+    invertedIndexes.remove(tableName);
+    bitmapIndexes.remove(tableName);
+    partitionings.remove(tableName);
+    clusterings.remove(tableName);
+    bumpTableVersion(tableName);
+    version++;
+    bool removed = true;
+    for (const char *ext : {".txt", ".codec", ".zmp", ".tri", ".inv", ".bmx", ".part", ".clu", ".cov"}) {
+        QString path = dbDir.filePath(tableName + ext);
+        removed = (!QFile::exists(path) || QFile::remove(path)) && removed;
+    }
+    // the schema file is only ever appended to, written again without it
+    QFile schema(schemaPath);
+    fileOpens().add();
+    if (!schema.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+    schema.close();
+    for (const QString& table : getTableNames())
+        writeToSchema(table);
+    return removed;
+}
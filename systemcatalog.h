@@ -2,6 +2,13 @@
 #define SYSTEMCATALOG_H
 
 #include "megatron_types.h"
+#include "columncodec.h"
+#include "zonemap.h"
+#include "trigramindex.h"
+#include "invertedindex.h"
+#include "bitmapindex.h"
+#include "partitioning.h"
+#include "clustering.h"
 
 #include <QObject>
 #include <QString>
@@ -10,6 +17,7 @@
 #include <QFile>
 #include <QMultiMap>
 #include <QList>
+#include <QHash>
 
 // SystemCatalog will be a Singleton
 
@@ -44,6 +52,35 @@ public:
 
     QSet<QString> getTableNames() const;
     int getSize(const QString &);
+    // Bumped on every metadata change, cached plans compare against it
+    quint64 getVersion() const;
+    // Bumped by whoever writes a table's data file, cached results compare against it
+    quint64 getTableVersion(const QString &) const;
+    void bumpTableVersion(const QString &);
+    // Column encodings of a table file (<table>.codec), loaded on first use
+    TableCodec getCodec(const QString &);
+    bool setCodec(const QString &, const TableCodec &);
+    // Block summaries of a table file (<table>.zmp), loaded on first use
+    ZoneMap getZoneMap(const QString &);
+    bool setZoneMap(const QString &, const ZoneMap &);
+    // Substring signatures of a table file (<table>.tri), loaded on first use,
+    // setting an empty index removes the file
+    TrigramIndex getTrigramIndex(const QString &);
+    bool setTrigramIndex(const QString &, const TrigramIndex &);
+    // Term postings of a table file (<table>.inv), same
+    InvertedIndex getInvertedIndex(const QString &);
+    bool setInvertedIndex(const QString &, const InvertedIndex &);
+    // Row bitmaps per value of low cardinality columns (<table>.bmx), same
+    BitmapIndex getBitmapIndex(const QString &);
+    bool setBitmapIndex(const QString &, const BitmapIndex &);
+    // Partitions of a table (<table>.part), same, not partitioned if none
+    Partitioning getPartitioning(const QString &);
+    bool setPartitioning(const QString &, const Partitioning &);
+    // Sort key of a table file (<table>.clu), same, not clustered if none
+    Clustering getClustering(const QString &);
+    bool setClustering(const QString &, const Clustering &);
+    // Forgets a table and the files of its data, rewrites the schema file
+    bool removeTable(const QString &);
 
 private:
     SystemCatalog(const QString &dbDir = QString());
@@ -52,6 +89,15 @@ private:
     QMultiMap<QString, attrMeta> tables;
     QDir dbDir;
     QString schemaPath;
+    quint64 version = 0;
+    QHash<QString, quint64> tableVersions;
+    QHash<QString, TableCodec> codecs;
+    QHash<QString, ZoneMap> zoneMaps;
+    QHash<QString, TrigramIndex> trigramIndexes;
+    QHash<QString, InvertedIndex> invertedIndexes;
+    QHash<QString, BitmapIndex> bitmapIndexes;
+    QHash<QString, Partitioning> partitionings;
+    QHash<QString, Clustering> clusterings;
     Q_DISABLE_COPY(SystemCatalog)
 };
 
@@ -0,0 +1,223 @@
+#include "tablefile.h"
+#include "metrics.h"
+
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 27)
+#define HAVE_COPY_FILE_RANGE
+#endif
+#endif
+#endif
+
+TableFile::TableFile(const QString &path)
+    : file(path)
+{
+}
+
+TableFile::~TableFile()
+{
+    close();
+}
+
+bool TableFile::open(Access access)
+{
+    static Metrics::Counter &fileOpens = Metrics::getInstance().counter(
+        "megatron_file_opens_total", "Table, schema and sidecar files opened");
+    close();
+    fileOpens.add();
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = tr("Error while opening Table file: %1").arg(file.fileName());
+        return false;
+    }
+    mapSize = file.size();
+    // Nothing to map in an empty table
+    if (mapSize == 0)
+        return true;
+    map = file.map(0, mapSize);
+    if (!map) {
+        error = tr("Error while mapping Table file: %1").arg(file.fileName());
+        file.close();
+        mapSize = 0;
+        return false;
+    }
+#ifdef Q_OS_UNIX
+    // offset 0 mapping, so the address is page aligned
+    madvise(map, size_t(mapSize), access == Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+#else
+    Q_UNUSED(access)
+#endif
+    return true;
+}
+
+void TableFile::close()
+{
+    if (map) {
+        file.unmap(map);
+        map = nullptr;
+    }
+    if (file.isOpen())
+        file.close();
+    mapSize = 0;
+    offset = 0;
+}
+
+QByteArrayView TableFile::data() const
+{
+    return QByteArrayView(reinterpret_cast<const char *>(map), mapSize);
+}
+
+qint64 TableFile::size() const
+{
+    return mapSize;
+}
+
+qint64 TableFile::pos() const
+{
+    return offset;
+}
+
+void TableFile::seek(qint64 o)
+{
+    offset = qBound(qint64(0), o, mapSize);
+}
+
+bool TableFile::atEnd() const
+{
+    return offset >= mapSize;
+}
+
+bool TableFile::readLine(QByteArrayView &line)
+{
+    if (offset >= mapSize)
+        return false;
+    const char *begin = reinterpret_cast<const char *>(map) + offset;
+    qint64 left = mapSize - offset;
+    const char *nl = static_cast<const char *>(std::memchr(begin, '\n', size_t(left)));
+    qint64 length = nl ? nl - begin : left;
+    offset += nl ? length + 1 : length;
+    // Files written in QIODevice::Text mode on Windows
+    if (length > 0 && begin[length - 1] == '\r')
+        length--;
+    line = QByteArrayView(begin, length);
+    return true;
+}
+
+void TableFile::split(QByteArrayView line, Row &fields)
+{
+    fields.clear();
+    if (line.isEmpty()) {
+        fields.append(QByteArrayView());
+        return;
+    }
+    const char *p = line.data();
+    const char *end = p + line.size();
+    for (;;) {
+        const char *sep = static_cast<const char *>(std::memchr(p, '#', size_t(end - p)));
+        if (!sep) {
+            fields.append(QByteArrayView(p, end - p));
+            return;
+        }
+        fields.append(QByteArrayView(p, sep - p));
+        p = sep + 1;
+    }
+}
+
+bool TableFile::append(QFile &to, const QString &from)
+{
+    QFile source(from);
+    if (!source.open(QIODevice::ReadOnly) || !to.flush())
+        return false;
+    qint64 size = source.size();
+    qint64 done = 0;
+#ifdef Q_OS_LINUX
+    int in = source.handle();
+    int out = to.handle();
+    loff_t outOffset = to.size();
+#ifdef FICLONE
+    // same filesystem with shared extents (btrfs, xfs): no data copied at all
+    if (outOffset == 0 && size > 0 && ioctl(out, FICLONE, in) == 0)
+        done = size;
+#endif
+#ifdef HAVE_COPY_FILE_RANGE
+    loff_t inOffset = 0;
+    while (done < size) {
+        ssize_t n = copy_file_range(in, &inOffset, out, &outOffset, size_t(size - done), 0);
+        // other filesystems or old kernels: through user space below
+        if (n <= 0)
+            break;
+        done += n;
+    }
+#else
+    Q_UNUSED(in)
+    Q_UNUSED(out)
+    Q_UNUSED(outOffset)
+#endif
+#endif
+    if (done < size && (!source.seek(done) || !to.seek(to.size())))
+        return false;
+    while (done < size) {
+        QByteArray chunk = source.read(1 << 20);
+        if (chunk.isEmpty() || to.write(chunk) != chunk.size())
+            return false;
+        done += chunk.size();
+    }
+    return to.seek(to.size());
+}
+
+bool TableFile::residency(qint64 from, qint64 to, qint64 &resident, qint64 &total) const
+{
+    resident = total = 0;
+    from = qBound(qint64(0), from, mapSize);
+    to = qBound(from, to, mapSize);
+    if (!map || from == to)
+        return true;
+#ifdef Q_OS_LINUX
+    const qint64 page = sysconf(_SC_PAGESIZE);
+    // mincore wants a page aligned address, the mapping starts at one
+    qint64 begin = from / page * page;
+    QByteArray pages((to - begin + page - 1) / page, Qt::Uninitialized);
+    if (mincore(map + begin, size_t(to - begin), reinterpret_cast<unsigned char *>(pages.data())) != 0)
+        return false;
+    for (char p : std::as_const(pages))
+        resident += p & 1;
+    total = pages.size();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TableFile::prefetch(qint64 from, qint64 to) const
+{
+    from = qBound(qint64(0), from, mapSize);
+    to = qBound(from, to, mapSize);
+    if (!map || from == to)
+        return false;
+#ifdef Q_OS_UNIX
+    const qint64 page = sysconf(_SC_PAGESIZE);
+    // the kernel queues the reads of every missing page at once
+    qint64 begin = from / page * page;
+    return madvise(map + begin, size_t(to - begin), MADV_WILLNEED) == 0;
+#else
+    return false;
+#endif
+}
+
+QString TableFile::fileName() const
+{
+    return file.fileName();
+}
+
+QString TableFile::errorString() const
+{
+    return error;
+}
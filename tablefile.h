@@ -0,0 +1,62 @@
+#ifndef TABLEFILE_H
+#define TABLEFILE_H
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QString>
+#include <QByteArrayView>
+#include <QVarLengthArray>
+
+// '#' separated fields of a table line, viewing UTF-8 bytes owned by
+// someone else (the mapping, a codec dictionary...), valid until next row
+using Row = QVarLengthArray<QByteArrayView, 32>;
+
+// Read-only memory mapping of a <table>.txt file: lines and fields are
+// handed out as views into the mapping, nothing is decoded nor copied
+
+class TableFile
+{
+    Q_DECLARE_TR_FUNCTIONS(TableFile)
+public:
+    enum Access {
+        Sequential,         // full scans, kernel reads ahead aggressively
+        Random              // point/range lookups, no read-ahead
+    };
+
+    explicit TableFile(const QString &path);
+    ~TableFile();
+    bool open(Access access = Sequential);
+    void close();
+
+    QByteArrayView data() const;
+    qint64 size() const;
+    qint64 pos() const;
+    void seek(qint64 offset);
+    bool atEnd() const;
+    // Line at pos() without its "\n"/"\r\n", advances pos() past it
+    bool readLine(QByteArrayView &line);
+    // Appends line's fields to 'fields' (cleared first)
+    static void split(QByteArrayView line, Row &fields);
+    // Appends the whole file 'from' to 'to' inside the kernel where it can
+    // (reflink into an empty file, copy_file_range), read/write elsewhere
+    static bool append(QFile &to, const QString &from);
+    // Pages of [from, to) already in the page cache (EXPLAIN ANALYZE),
+    // false where the platform can't tell
+    bool residency(qint64 from, qint64 to, qint64 &resident, qint64 &total) const;
+    // Starts reading [from, to) into the page cache without waiting for
+    // it (scan read-ahead), false where the platform can't
+    bool prefetch(qint64 from, qint64 to) const;
+
+    QString fileName() const;
+    QString errorString() const;
+
+private:
+    QFile file;
+    uchar *map = nullptr;
+    qint64 mapSize = 0;
+    qint64 offset = 0;
+    QString error;
+    Q_DISABLE_COPY(TableFile)
+};
+
+#endif // TABLEFILE_H
@@ -0,0 +1,180 @@
+#include "trigramindex.h"
+
+#include <QFile>
+#include <QDataStream>
+#include <QSet>
+#include <QtMath>
+#include <QtAlgorithms>
+
+static constexpr quint32 magic = 0x4D545249;           // "MTRI"
+static constexpr qint32 formatVersion = 1;
+
+quint32 TrigramIndex::bit(quint32 trigram, int log2Bits)
+{
+    // multiplicative hash, the top bits are the best mixed
+    return (trigram * 0x9E3779B1u) >> (32 - log2Bits);
+}
+
+QList<quint32> TrigramIndex::trigrams(QByteArrayView needle)
+{
+    QList<quint32> result;
+    const uchar *p = reinterpret_cast<const uchar *>(needle.data());
+    for (qsizetype i = 0; i + 3 <= needle.size(); ++i)
+        result.append(quint32(p[i]) << 16 | quint32(p[i + 1]) << 8 | p[i + 2]);
+    return result;
+}
+
+bool TrigramIndex::isValid(qint64 fileSize) const
+{
+    return !columns.isEmpty() && bytes == fileSize;
+}
+
+bool TrigramIndex::isEmpty() const
+{
+    return columns.isEmpty();
+}
+
+bool TrigramIndex::hasColumn(int position) const
+{
+    return column(position) != nullptr;
+}
+
+qint64 TrigramIndex::getBlockCount() const
+{
+    return blocks;
+}
+
+const TrigramIndex::Column *TrigramIndex::column(int position) const
+{
+    for (const auto& c : columns)
+        if (c.position == position)
+            return &c;
+    return nullptr;
+}
+
+void TrigramIndex::build(TableFile &file, const QList<int> &positions)
+{
+    columns.clear();
+    blocks = 0;
+    for (int p : positions) {
+        Column c;
+        c.position = p;
+        columns.append(c);
+    }
+    scan(file, 0);
+}
+
+void TrigramIndex::extend(TableFile &file, qsizetype firstBlock, qint64 from)
+{
+    blocks = qMin(blocks, qint64(firstBlock));
+    for (auto& c : columns)
+        c.words.resize(blocks * ((qsizetype(1) << c.log2Bits) / 64));
+    scan(file, from);
+}
+
+void TrigramIndex::scan(TableFile &file, qint64 from)
+{
+    // trigrams of the current block, per column
+    QList<QSet<quint32>> found(columns.size());
+    auto flush = [&]() {
+        for (qsizetype i = 0; i < columns.size(); ++i) {
+            Column &c = columns[i];
+            if (c.log2Bits == 0) {
+                // ~8 bits per distinct trigram of the first block
+                quint32 wanted = qBound(quint32(minBits), qNextPowerOfTwo(quint32(found.at(i).size() * 8)),
+                                        quint32(maxBits));
+                c.log2Bits = qCountTrailingZeroBits(wanted);
+            }
+            qsizetype words = (qsizetype(1) << c.log2Bits) / 64;
+            qsizetype first = c.words.size();
+            c.words.resize(first + words);
+            for (quint32 t : std::as_const(found.at(i))) {
+                quint32 b = bit(t, c.log2Bits);
+                c.words[first + b / 64] |= quint64(1) << (b % 64);
+            }
+            found[i].clear();
+        }
+        blocks++;
+    };
+    file.seek(from);
+    QByteArrayView line;
+    Row fields;
+    qint64 rows = 0;
+    while (file.readLine(line)) {
+        TableFile::split(line, fields);
+        for (qsizetype i = 0; i < columns.size(); ++i) {
+            int p = columns.at(i).position;
+            if (p >= fields.size())
+                continue;
+            for (quint32 t : trigrams(fields.at(p)))
+                found[i].insert(t);
+        }
+        if (++rows % ZoneMap::rowsPerBlock == 0)
+            flush();
+    }
+    if (rows % ZoneMap::rowsPerBlock != 0)
+        flush();
+    bytes = file.pos();
+}
+
+bool TrigramIndex::mayContain(qsizetype block, int position, const QList<quint32> &trigrams) const
+{
+    const Column *c = column(position);
+    if (!c || block >= blocks)
+        return true;
+    const quint64 *signature = c->words.constData() + block * ((qsizetype(1) << c->log2Bits) / 64);
+    for (quint32 t : trigrams) {
+        quint32 b = bit(t, c->log2Bits);
+        if (!(signature[b / 64] >> (b % 64) & 1))
+            return false;
+    }
+    return true;
+}
+
+bool TrigramIndex::read(const QString &path)
+{
+    columns.clear();
+    blocks = 0;
+    bytes = -1;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    quint32 m;
+    qint32 version;
+    qint32 count;
+    in >> m >> version;
+    if (m != magic || version != formatVersion)
+        return false;
+    in >> bytes >> blocks >> count;
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        Column c;
+        qint32 position, log2Bits;
+        in >> position >> log2Bits >> c.words;
+        c.position = position;
+        c.log2Bits = log2Bits;
+        // a truncated file is no index
+        if (log2Bits <= 0 || c.words.size() != blocks * ((qsizetype(1) << log2Bits) / 64))
+            break;
+        columns.append(c);
+    }
+    if (in.status() != QDataStream::Ok || columns.size() != count) {
+        columns.clear();
+        bytes = -1;
+        return false;
+    }
+    return true;
+}
+
+bool TrigramIndex::write(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out << magic << formatVersion << bytes << blocks << qint32(columns.size());
+    for (const auto& c : columns)
+        out << qint32(c.position) << qint32(c.log2Bits) << c.words;
+    file.close();
+    return out.status() == QDataStream::Ok;
+}
@@ -0,0 +1,61 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include "tablefile.h"
+#include "zonemap.h"
+
+#include <QString>
+#include <QByteArrayView>
+#include <QList>
+
+// Per zone map block signature of the 3-byte sequences found in a column's
+// values: one bit per hashed trigram, sized from the first block. A
+// Contains needle whose trigrams aren't all set can't be in the block.
+// Built by the Loader for the plain varchar columns of large tables,
+// stored in <table>.tri.
+
+class TrigramIndex
+{
+public:
+    // smaller tables are cheap enough to scan
+    static constexpr qint64 minRows = 16 * ZoneMap::rowsPerBlock;
+
+    TrigramIndex() = default;
+    // Signatures of the columns at 'positions', every line of the file
+    void build(TableFile &file, const QList<int> &positions);
+    // Signatures again from block 'firstBlock', whose first line is at
+    // 'from', to the end of the file: appended rows fill up the last block
+    void extend(TableFile &file, qsizetype firstBlock, qint64 from);
+    // Only usable if it covers exactly the current table file
+    bool isValid(qint64 fileSize) const;
+    bool isEmpty() const;
+    bool hasColumn(int position) const;
+    qint64 getBlockCount() const;
+
+    // Trigrams of a needle, empty if shorter than 3 bytes
+    static QList<quint32> trigrams(QByteArrayView needle);
+    // false if no value of the column in the block can hold every trigram
+    bool mayContain(qsizetype block, int position, const QList<quint32> &trigrams) const;
+
+    // binary, QDataStream: header, then per column its position, size and bits
+    bool read(const QString &path);
+    bool write(const QString &path) const;
+
+private:
+    static constexpr int minBits = 1 << 10;
+    static constexpr int maxBits = 1 << 16;
+    struct Column {
+        int position = -1;
+        int log2Bits = 0;                   // bits per block signature, 0: not sized yet
+        QList<quint64> words;               // signatures of the blocks, one after the other
+    };
+    QList<Column> columns;
+    qint64 blocks = 0;
+    qint64 bytes = -1;                      // file size covered, -1: empty index
+
+    static quint32 bit(quint32 trigram, int log2Bits);
+    void scan(TableFile &file, qint64 from);
+    const Column *column(int position) const;
+};
+
+#endif // TRIGRAMINDEX_H
@@ -0,0 +1,229 @@
+#include "zonemap.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QtAlgorithms>
+
+static QString bitsToString(const QList<quint64> &words)
+{
+    QStringList hex;
+    for (quint64 w : words) hex.append(QString::number(w, 16));
+    return hex.join(':');
+}
+
+static QList<quint64> bitsFromString(const QString &text)
+{
+    QList<quint64> words;
+    if (text.isEmpty())
+        return words;
+    for (const auto& w : text.split(':')) words.append(w.toULongLong(nullptr, 16));
+    words.resize(ZoneMap::wordsPerBlock);
+    return words;
+}
+
+ZoneMap::ZoneMap(const QByteArray &types)
+    : types(types)
+{
+}
+
+bool ZoneMap::isNumeric(int position) const
+{
+    switch (position < types.size() ? types.at(position) : ' ') {
+    case 'i': case 'f': case 'd': case 't':
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool ZoneMap::isValid(qint64 fileSize) const
+{
+    return !types.isEmpty() && bytes == fileSize;
+}
+
+const QList<ZoneMap::Block> &ZoneMap::getBlocks() const
+{
+    return blocks;
+}
+
+qint64 ZoneMap::getRowCount() const
+{
+    qint64 rows = 0;
+    for (const auto& b : blocks) rows += b.rows;
+    return rows;
+}
+
+qint64 ZoneMap::select(qsizetype block, int position, int optor, QList<quint64> &rows) const
+{
+    const Block &b = blocks.at(block);
+    const Zone &zone = b.zones.at(position);
+    if (zone.nulls > 0 && zone.nullBits.isEmpty())
+        return -1;
+    rows.resize(wordsPerBlock);
+    qint64 selected = 0;
+    for (qsizetype w = 0; w < wordsPerBlock; ++w) {
+        // rows of the block present in this word
+        qint64 present = qBound(qint64(0), b.rows - w * 64, qint64(64));
+        quint64 valid = present == 64 ? ~quint64(0) : (quint64(1) << present) - 1;
+        quint64 empty = zone.nullBits.value(w);
+        quint64 null = empty & ~zone.blankBits.value(w);
+        quint64 word = 0;
+        switch (optor) {
+        case 12: word = null; break;                        // IsNull
+        case 13: word = valid & ~null; break;               // IsNotNull
+        case 14: word = empty; break;                       // IsEmpty
+        case 15: word = valid & ~empty; break;              // IsNotEmpty
+        }
+        rows[w] = word;
+        selected += qPopulationCount(word);
+    }
+    return selected;
+}
+
+void ZoneMap::markBlank(qint64 row, int position)
+{
+    qsizetype block = qsizetype(row / rowsPerBlock);
+    if (block >= blocks.size() || position >= blocks.at(block).zones.size())
+        return;
+    Zone &zone = blocks[block].zones[position];
+    qint64 r = row % rowsPerBlock;
+    quint64 bit = quint64(1) << (r % 64);
+    // only empty values can be ''
+    if (!(zone.nullBits.value(r / 64) & bit))
+        return;
+    if (zone.blankBits.isEmpty())
+        zone.blankBits.resize(wordsPerBlock);
+    zone.blankBits[r / 64] |= bit;
+}
+
+bool ZoneMap::isBlank(qint64 row, int position) const
+{
+    qsizetype block = qsizetype(row / rowsPerBlock);
+    if (block >= blocks.size() || position >= blocks.at(block).zones.size())
+        return false;
+    qint64 r = row % rowsPerBlock;
+    return blocks.at(block).zones.at(position).blankBits.value(r / 64) >> (r % 64) & 1;
+}
+
+bool ZoneMap::hasBlanks() const
+{
+    for (const auto& b : blocks)
+        for (const auto& z : b.zones)
+            if (!z.blankBits.isEmpty())
+                return true;
+    return false;
+}
+
+void ZoneMap::extend(TableFile &file, const TableCodec &codec, qint64 from)
+{
+    // Not contiguous with what is already covered: rebuild
+    if (from != bytes || from == 0) {
+        blocks.clear();
+        from = 0;
+    }
+    file.seek(from);
+    QByteArrayView line;
+    Row fields;
+    for (;;) {
+        qint64 offset = file.pos();
+        if (!file.readLine(line))
+            break;
+        if (blocks.isEmpty() || blocks.last().rows >= rowsPerBlock) {
+            Block block;
+            block.offset = offset;
+            block.zones.resize(types.size());
+            blocks.append(block);
+        }
+        Block &block = blocks.last();
+        block.rows++;
+        block.end = file.pos();
+        TableFile::split(line, fields);
+        for (qsizetype i = 0; i < types.size(); ++i) {
+            QByteArrayView v = i < fields.size() ? fields.at(i) : QByteArrayView();
+            Zone &zone = block.zones[i];
+            if (v.isEmpty()) {
+                if (zone.nullBits.isEmpty())
+                    zone.nullBits.resize(wordsPerBlock);
+                qint64 r = block.rows - 1;
+                zone.nullBits[r / 64] |= quint64(1) << (r % 64);
+                zone.nulls++;
+                continue;
+            }
+            if (!isNumeric(i))
+                continue;
+            // same conversion the WHERE operators apply
+            double d = v.toDouble();
+            if (codec.encoding(i) == TableCodec::FrameOfReference)
+                d += codec.column(i).base;
+            zone.min = qMin(zone.min, d);
+            zone.max = qMax(zone.max, d);
+        }
+    }
+    bytes = file.pos();
+}
+
+bool ZoneMap::read(const QString &path)
+{
+    blocks.clear();
+    bytes = -1;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QTextStream in(&file);
+    QStringList header = in.readLine().split('#');
+    if (header.size() < 2)
+        return false;
+    bytes = header.at(0).toLongLong();
+    types = header.at(1).toLatin1();
+    while (!in.atEnd()) {
+        QStringList parts = in.readLine().split('#');
+        if (parts.size() < 3)
+            continue;
+        Block block;
+        block.offset = parts.at(0).toLongLong();
+        block.end = parts.at(1).toLongLong();
+        block.rows = parts.at(2).toLongLong();
+        block.zones.resize(types.size());
+        for (qsizetype i = 0; i < types.size() && i + 3 < parts.size(); ++i) {
+            QStringList z = parts.at(i + 3).split(',');
+            Zone &zone = block.zones[i];
+            // min/max left empty when the block has no value
+            if (!z.value(0).isEmpty()) zone.min = z.value(0).toDouble();
+            if (!z.value(1).isEmpty()) zone.max = z.value(1).toDouble();
+            zone.nulls = z.value(2).toLongLong();
+            zone.nullBits = bitsFromString(z.value(3));
+            zone.blankBits = bitsFromString(z.value(4));
+        }
+        blocks.append(block);
+    }
+    file.close();
+    return true;
+}
+
+bool ZoneMap::write(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    out << bytes << "#" << QString::fromLatin1(types) << "\n";
+    for (const auto& b : blocks) {
+        out << b.offset << "#" << b.end << "#" << b.rows;
+        for (const auto& z : b.zones) {
+            out << "#";
+            if (z.min <= z.max)
+                out << QString::number(z.min, 'g', 17) << "," << QString::number(z.max, 'g', 17);
+            else
+                out << ",";
+            out << "," << z.nulls;
+            if (!z.nullBits.isEmpty())
+                out << "," << bitsToString(z.nullBits);
+            if (!z.blankBits.isEmpty())
+                out << "," << bitsToString(z.blankBits);
+        }
+        out << "\n";
+    }
+    file.close();
+    return true;
+}
@@ -0,0 +1,75 @@
+#ifndef ZONEMAP_H
+#define ZONEMAP_H
+
+#include "tablefile.h"
+#include "columncodec.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+
+#include <limits>
+
+// Per block (rowsPerBlock consecutive lines) summary of a table file:
+// byte range, min/max of numeric columns (decoded values, as the WHERE
+// operators see them), null (empty value) count and bitmap of every column.
+// Stored in <table>.zmp, lets range scans skip blocks that can't match.
+// An empty field is NULL unless the loader read it as a quoted "" string,
+// those rows are also flagged in a blank bitmap (char/varchar columns only).
+
+class ZoneMap
+{
+public:
+    static constexpr qint64 rowsPerBlock = 1024;
+    static constexpr qsizetype wordsPerBlock = rowsPerBlock / 64;
+    struct Zone {
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        qint64 nulls = 0;                   // empty values, NULL or ''
+        // bit r of word r / 64: row r of the block, wordsPerBlock words,
+        // left empty when no row has the flag
+        QList<quint64> nullBits;            // empty values
+        QList<quint64> blankBits;           // the ones that are '' rather than NULL
+    };
+    struct Block {
+        qint64 offset = 0;                  // first byte of the block's first line
+        qint64 end = 0;                     // one past the block's last '\n'
+        qint64 rows = 0;
+        QList<Zone> zones;                  // by column position
+    };
+
+    ZoneMap() = default;
+    // attrMeta types ordered by position
+    explicit ZoneMap(const QByteArray &types);
+
+    // Accounts the lines from 'from' to the end of the file (load, append,
+    // insert), filling up the last block before opening new ones
+    void extend(TableFile &file, const TableCodec &codec, qint64 from = 0);
+    // Only usable if it covers exactly the current table file
+    bool isValid(qint64 fileSize) const;
+    bool isNumeric(int position) const;
+    const QList<Block> &getBlocks() const;
+    qint64 getRowCount() const;
+
+    // Rows of a block satisfying IsNull/IsNotNull/IsEmpty/IsNotEmpty
+    // (operators 12-15) on column 'position', as a wordsPerBlock bitmap.
+    // Returns the number of rows selected, -1 if the block has no bitmap
+    // (map written before bitmaps were stored)
+    qint64 select(qsizetype block, int position, int optor, QList<quint64> &rows) const;
+    // Row's (counted from the file start) empty value is '' and not NULL
+    void markBlank(qint64 row, int position);
+    bool isBlank(qint64 row, int position) const;
+    bool hasBlanks() const;
+
+    // <bytes>#<types> then <offset>#<end>#<rows>#<min,max,nulls[,nullBits[,blankBits]]>...
+    // per line, bitmaps as ':' separated hex words
+    bool read(const QString &path);
+    bool write(const QString &path) const;
+
+private:
+    QByteArray types;
+    QList<Block> blocks;
+    qint64 bytes = -1;                      // file size covered, -1: empty map
+};
+
+#endif // ZONEMAP_H